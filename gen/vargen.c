@@ -0,0 +1,454 @@
+/*
+ * vargen: generate C accessors for a fixed `var_t` shape.
+ *
+ * usage: vargen <name> <schema>
+ *
+ * the schema uses the same notation as the format strings, e.g. `(u[si])`.
+ * the generated header is written to stdout and contains, for `name`:
+ *      name_check          validate shape of a `var_t*`, lists may be longer than the schema
+ *      name_new            construct from C values
+ *      name_get_<path>     read a field, e.g. `name_get_1_0`
+ *      name_set_<path>     write a field, e.g. `name_set_1_0`
+ *
+ * getters and setters do not check the shape, call `name_check` on untrusted input.
+ * setters copy shared containers on the way first, see `var_retain`.
+ * the header only includes `src/vargen.h` of the library, compile it with `-I src`.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+
+// error msgs, same as `varutil.h`
+#define ERRO(msg) \
+exit((fprintf(stderr, "[ERRO]: " msg "\n"), 1));
+
+// check if allocation returns `NULL`
+#define MEM_CHECK(ptr) \
+if (ptr == NULL) ERRO("out of memory");
+
+#define PATH_SIZE 256
+
+
+typedef struct node node_t;
+struct node {
+    char        code;
+    size_t      len;
+    node_t**    child;
+};
+
+
+static node_t* parse(const char** schema) {
+    while (**schema == ' ') (*schema)++;
+
+    node_t* res = calloc(1, sizeof (node_t));
+    MEM_CHECK(res);
+    res->code = **schema;
+
+    switch (res->code) {
+        case 'n':
+        case 'i':
+        case 'u':
+        case 'f':
+        case 's':
+        case 'a':
+        case 'l':
+        case 'd':
+        case 'v': {
+            (*schema)++;
+        }
+        break;
+
+        case '(':
+        case '[': {
+            char close = res->code == '(' ? ')' : ']';
+            size_t cap = 0;
+            (*schema)++;
+            for (;;) {
+                while (**schema == ' ') (*schema)++;
+                if (**schema == close) break;
+                if (**schema == '\0') ERRO("unbalanced brackets");
+                if (res->len == cap) {
+                    cap = cap == 0 ? 4 : cap * 2;
+                    res->child = realloc(res->child, sizeof (node_t*) * cap);
+                    MEM_CHECK(res->child);
+                }
+                res->child[res->len++] = parse(schema);
+            }
+            (*schema)++;
+        }
+        break;
+
+        case '\0': {
+            ERRO("empty schema");
+        }
+        break;
+
+        default: {
+            ERRO("unknown schema character, `_` is not allowed in schema");
+        }
+    }
+
+    return res;
+}
+
+
+static void node_delete(node_t* node) {
+    for (size_t i = 0; i < node->len; i++) {
+        node_delete(node->child[i]);
+    }
+    free(node->child);
+    free(node);
+}
+
+
+// C type of a leaf, `NULL` for nil
+static const char* c_type(char code) {
+    switch (code) {
+        case 'i': return "int64_t";
+        case 'u': return "uint64_t";
+        case 'f': return "double";
+        case 's': return "const char*";
+        case 'n': return NULL;
+        default: return "var_t*";
+    }
+}
+
+
+static const char* var_type(char code) {
+    switch (code) {
+        case 'n': return "VAR_NIL";
+        case 'i': return "VAR_INT";
+        case 'u': return "VAR_UINT";
+        case 'f': return "VAR_FLOAT";
+        case 's': return "VAR_STRING";
+        case 'a':
+        case '(': return "VAR_ARRAY";
+        case 'l':
+        case '[': return "VAR_LIST";
+        case 'd': return "VAR_DICT";
+        default: return NULL;
+    }
+}
+
+
+// expression of child `i` of the container expression `expr`
+static void child_expr(char* buf, const char* expr, size_t i) {
+    snprintf(buf, PATH_SIZE * 8, "var_gen_at(%s, %zu)", expr, i);
+}
+
+
+static void path_push(char* path, size_t i) {
+    size_t len = strlen(path);
+    if (len + 24 >= PATH_SIZE) ERRO("schema is nested too deep");
+    snprintf(path + len, PATH_SIZE - len, "_%zu", i);
+}
+
+
+// name_check
+
+// lists may be longer than the schema, only their first elements are checked, as `var_get` reads them
+static void emit_check(const node_t* node, const char* expr) {
+    const char* t = var_type(node->code);
+    if (t != NULL) {
+        printf("    if (var_gen_type(%s) != %s) return false;\n", expr, t);
+    }
+
+    if (node->code == '(') {
+        printf("    if (var_gen_len(%s) != %zu) return false;\n", expr, node->len);
+    } else if (node->code == '[') {
+        printf("    if (var_gen_len(%s) < %zu) return false;\n", expr, node->len);
+    } else {
+        return;
+    }
+
+    char sub[PATH_SIZE * 8];
+    for (size_t i = 0; i < node->len; i++) {
+        child_expr(sub, expr, i);
+        emit_check(node->child[i], sub);
+    }
+}
+
+
+// name_new
+
+static bool emit_params(const node_t* node, char* path, bool first) {
+    if (node->code == '(' || node->code == '[') {
+        size_t len = strlen(path);
+        for (size_t i = 0; i < node->len; i++) {
+            path_push(path, i);
+            first = emit_params(node->child[i], path, first);
+            path[len] = '\0';
+        }
+        return first;
+    }
+
+    const char* t = c_type(node->code);
+    if (t == NULL) return first;
+    printf("%s%s v%s", first ? "" : ", ", t, path);
+    return false;
+}
+
+
+// add the bytes of the new `var_t*` of `node` to `size`, same as `var_new_*` of it would check
+static void emit_size(const node_t* node, char* path) {
+    switch (node->code) {
+        case 'i': {
+            printf("        size += var_gen_size_int(v%s);\n", path);
+        }
+        break;
+        case 'u': {
+            printf("        size += var_gen_size_uint(v%s);\n", path);
+        }
+        break;
+        case 'f': {
+            printf("        size += var_gen_size_float(v%s);\n", path);
+        }
+        break;
+        case 's': {
+            printf("        size += var_gen_size_str(v%s);\n", path);
+        }
+        break;
+
+        case '(':
+        case '[': {
+            if (node->code == '(') {
+                printf("        size += var_gen_size_array(%zu);\n", node->len);
+            } else {
+                printf("        size += var_gen_size_list(%zu);\n", node->len);
+            }
+            size_t len = strlen(path);
+            for (size_t i = 0; i < node->len; i++) {
+                path_push(path, i);
+                emit_size(node->child[i], path);
+                path[len] = '\0';
+            }
+        }
+        break;
+    }
+}
+
+
+/*
+ * print `fmt` for every `var_t*` argument of `node`, with its path for each `%s`.
+ * they are `NULL` if their own `var_new_*` was over the budget, see `var_budget_use`
+ */
+static void emit_args(const node_t* node, char* path, const char* fmt) {
+    if (node->code == '(' || node->code == '[') {
+        size_t len = strlen(path);
+        for (size_t i = 0; i < node->len; i++) {
+            path_push(path, i);
+            emit_args(node->child[i], path, fmt);
+            path[len] = '\0';
+        }
+        return;
+    }
+    if (node->code == 'a' || node->code == 'l' || node->code == 'd' || node->code == 'v') {
+        printf(fmt, path, path);
+    }
+}
+
+
+// put the new `var_t*` of `node` into the container `parent` at `index`, or into `r` if `NULL`, the budget is checked before
+static void emit_new(const node_t* node, char* path, const char* parent, size_t index) {
+    char expr[PATH_SIZE * 2];
+    switch (node->code) {
+        case 'n': {
+            snprintf(expr, sizeof (expr), "var_new_nil()");
+        }
+        break;
+        case 'i': {
+            snprintf(expr, sizeof (expr), "var_gen_new_int(v%s)", path);
+        }
+        break;
+        case 'u': {
+            snprintf(expr, sizeof (expr), "var_gen_new_uint(v%s)", path);
+        }
+        break;
+        case 'f': {
+            snprintf(expr, sizeof (expr), "var_gen_new_float(v%s)", path);
+        }
+        break;
+        case 's': {
+            snprintf(expr, sizeof (expr), "var_gen_new_str(v%s)", path);
+        }
+        break;
+        case 'a':
+        case 'l':
+        case 'd':
+        case 'v': {
+            snprintf(expr, sizeof (expr), "v%s", path);
+        }
+        break;
+
+        case '(':
+        case '[': {
+            // container `r<path>` is filled before it is stored
+            snprintf(expr, sizeof (expr), "r%s", path);
+            printf("    var_t* %s = var_gen_new_%s(%zu);\n", expr, node->code == '(' ? "array" : "list", node->len);
+
+            size_t len = strlen(path);
+            for (size_t i = 0; i < node->len; i++) {
+                path_push(path, i);
+                emit_new(node->child[i], path, expr, i);
+                path[len] = '\0';
+            }
+        }
+        break;
+    }
+
+    if (parent != NULL) {
+        printf("    var_gen_put(%s, %zu, %s);\n", parent, index, expr);
+    } else if (strcmp(expr, "r") != 0) {
+        printf("    r = %s;\n", expr);
+    }
+}
+
+
+// name_get_<path> and name_set_<path>
+
+#define PRE_SIZE (PATH_SIZE * 64)
+
+/*
+ * `expr` reads the field from `var`, it is the element `index` of the container `owner`.
+ * `self` is the local `var_t*` of a container, `pre` the setter statements that define `owner`,
+ * every container on the way is unshared before it is changed, see `var_retain`.
+ */
+static void emit_access(const char* name, const node_t* node, char* path, const char* expr,
+                        const char* owner, size_t index, const char* pre) {
+    if (path[0] != '\0') {
+        const char* t = c_type(node->code);
+        if (t != NULL) {
+            // getter
+            printf("static inline %s %s_get%s(const var_t* var) {\n", t, name, path);
+            switch (node->code) {
+                case 'i': printf("    return var_gen_int(%s);\n", expr); break;
+                case 'u': printf("    return var_gen_uint(%s);\n", expr); break;
+                case 'f': printf("    return var_gen_float(%s);\n", expr); break;
+                case 's': printf("    return var_gen_str(%s);\n", expr); break;
+                default:  printf("    return %s;\n", expr); break;
+            }
+            printf("}\n\n");
+
+            // setter, immediate values are replaced in their slot
+            if (node->code != '(' && node->code != '[') {
+                printf("static inline void %s_set%s(var_t* var, %s v) {\n", name, path, t);
+                printf("%s", pre);
+                switch (node->code) {
+                    case 'i': printf("    var_gen_set_int(%s, %zu, v);\n", owner, index); break;
+                    case 'u': printf("    var_gen_set_uint(%s, %zu, v);\n", owner, index); break;
+                    case 'f': printf("    var_gen_set_float(%s, %zu, v);\n", owner, index); break;
+                    case 's': printf("    var_gen_set_str(%s, %zu, v);\n", owner, index); break;
+                    // the container takes `v` and frees the old one
+                    default:  printf("    var_gen_set(%s, %zu, v);\n", owner, index); break;
+                }
+                printf("}\n\n");
+            }
+        }
+    }
+
+    if (node->code != '(' && node->code != '[') return;
+
+    // local `var_t*` of this container in setters
+    char self[PATH_SIZE + 1];
+    char self_pre[PRE_SIZE];
+    if (path[0] == '\0') {
+        snprintf(self, sizeof (self), "var");
+        snprintf(self_pre, sizeof (self_pre), "    var_gen_unshare(var);\n");
+    } else {
+        snprintf(self, sizeof (self), "p%s", path);
+        snprintf(self_pre, sizeof (self_pre), "%s    var_t* %s = var_gen_at(%s, %zu);\n    var_gen_unshare(%s);\n",
+                 pre, self, owner, index, self);
+    }
+
+    char sub[PATH_SIZE * 8];
+    size_t len = strlen(path);
+    for (size_t i = 0; i < node->len; i++) {
+        child_expr(sub, expr, i);
+        path_push(path, i);
+        emit_access(name, node->child[i], path, sub, self, i, self_pre);
+        path[len] = '\0';
+    }
+}
+
+
+static void emit(const char* name, const char* schema, const node_t* root) {
+    char path[PATH_SIZE] = "";
+
+    char guard[PATH_SIZE];
+    size_t len = strlen(name);
+    for (size_t i = 0; i < len; i++) {
+        guard[i] = (char) toupper((unsigned char) name[i]);
+    }
+    guard[len] = '\0';
+
+    printf("// generated by vargen from `%s`, do not edit\n\n", schema);
+    printf("#ifndef __%s_H__\n", guard);
+    printf("#define __%s_H__\n\n", guard);
+    printf("#include \"vargen.h\"\n\n\n");
+
+    // check
+    printf("// if `var` has the shape `%s`%s\n", schema, strchr(schema, '[') != NULL ? ", lists may be longer" : "");
+    printf("static inline bool %s_check(const var_t* var) {\n", name);
+    emit_check(root, "var");
+    printf("    return true;\n");
+    printf("}\n\n");
+
+    // new
+    printf("// a new `var_t*` of shape `%s`, it takes the `var_t*` arguments, `NULL` over the budget in use\n", schema);
+    printf("static inline var_t* %s_new(", name);
+    if (emit_params(root, path, true)) printf("void");
+    printf(") {\n");
+    printf("    if (var_gen_budget()) {\n");
+    printf("        size_t size = 0;\n");
+    emit_size(root, path);
+    printf("        if (var_gen_over(size)");
+    emit_args(root, path, " || v%s == NULL");
+    printf(") {\n");
+    // the `var_t*` arguments are taken even if nothing is built
+    emit_args(root, path, "            if (v%s != NULL) var_delete(v%s);\n");
+    printf("            return NULL;\n");
+    printf("        }\n");
+    printf("    }\n");
+    if (root->code != '(' && root->code != '[') {
+        printf("    var_t* r;\n");
+    }
+    emit_new(root, path, NULL, 0);
+    printf("    return r;\n");
+    printf("}\n\n");
+
+    // fields
+    emit_access(name, root, path, "var", NULL, 0, "");
+
+    printf("\n#endif  // __%s_H__\n", guard);
+}
+
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <name> <schema>\n", argv[0]);
+        return 1;
+    }
+
+    const char* name = argv[1];
+    if (strlen(name) >= PATH_SIZE || !(isalpha((unsigned char) name[0]) || name[0] == '_')) {
+        ERRO("name should be a C identifier");
+    }
+    for (const char* c = name; *c != '\0'; c++) {
+        if (!(isalnum((unsigned char) *c) || *c == '_')) {
+            ERRO("name should be a C identifier");
+        }
+    }
+
+    const char* schema = argv[2];
+    node_t* root = parse(&schema);
+    while (*schema == ' ') schema++;
+    if (*schema != '\0') ERRO("schema should describe a single `var_t`");
+
+    emit(name, argv[2], root);
+    node_delete(root);
+    return 0;
+}
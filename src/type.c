@@ -2,6 +2,9 @@
 #include "varprivate.h"
 #include "varutil.h"
 
+#include <stdatomic.h>
+#include <time.h>
+
 // constructor
 
 /*
@@ -13,50 +16,58 @@
  *
  * @param   t   type of the `var_t`, can be char or enum 
  * @param   ... see above description
- * @return      pointer to a new `var_t`
+ * @return      pointer to a new `var_t`, `NULL` over the budget in use
  */
 var_t* var_new(var_type_t t, ...) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-
     // start varadic arguments
     va_list ap;
     va_start(ap, t);
-    
+
+    // types that are not allocated here, `NULL` over the budget in use as well
+    var_t* res = NULL;
+    bool done = true;
     switch (t) {
-        case VAR_NIL: break;
+        case VAR_NIL: {
+            res = var_new_nil();
+        }
+        break;
 
         case VAR_INT: {
-            res->data.i = va_arg(ap, int64_t);
+            res = var_new_int(va_arg(ap, int64_t));
         }
         break;
 
         case VAR_UINT: {
-            res->data.u = va_arg(ap, uint64_t);
+            res = var_new_uint(va_arg(ap, uint64_t));
         }
         break;
 
         case VAR_FLOAT: {
-            res->data.f = va_arg(ap, double);
+            res = var_new_float(va_arg(ap, double));
         }
         break;
 
         case VAR_STRING: {
-            char* str = va_arg(ap, char*);
-            int str_len = vsnprintf(NULL, 0, str, ap);
-            va_end(ap);
-            if (str_len < 0) ERRO("invalid format string");
-
-            res->data.s = malloc(sizeof (var_string_t) + str_len + 1);
-            MEM_CHECK(res->data.s);
+            const char* str = va_arg(ap, const char*);
+            res = var_new_vstring(str, ap);
+        }
+        break;
 
-            res->data.s->len = str_len;
-            va_start(ap, t);
-            va_arg(ap, char*);
-            vsprintf(res->data.s->str, str, ap);
+        case VAR_DICT: {
+            var_t* key = va_arg(ap, var_t*);
+            var_t* val = va_arg(ap, var_t*);
+            res = var_new_dict(key, val);
         }
         break;
 
+        default: done = false; break;
+    }
+    if (done) {
+        va_end(ap);
+        return res;
+    }
+
+    switch (t) {
         case VAR_ARRAY: {
             // get argument length 
             size_t arr_len = 0;
@@ -64,13 +75,22 @@ var_t* var_new(var_type_t t, ...) {
                 temp != NULL; 
                 temp = (arr_len++, va_arg(ap, var_t*)));
             va_end(ap);
+            va_start(ap, t);
+            if (var_budget_over(var_array_size(arr_len))) {
+                for (size_t i = 0; i < arr_len; i++) var_delete(va_arg(ap, var_t*));
+                break;
+            }
 
             // allocate struct memory
-            res->data.a = malloc(sizeof (var_array_t) + sizeof (var_t*) * arr_len);
+            res = var_box(t);
+            res->data.a = var_alloc(sizeof (var_array_t) + sizeof (var_t*) * arr_len);
             MEM_CHECK(res->data.a);
+            var_ref_init(&res->data.a->ref);
+            var_hash_cache_init(&res->data.a->hash);
+            var_hash_cache_init(&res->data.a->seen);
+            res->data.a->len = arr_len;
             
             // assign values
-            va_start(ap, t);
             for (size_t i = 0; i < res->data.a->len; i++) {
                 res->data.a->av[i] = va_arg(ap, var_t*);
             }
@@ -78,51 +98,28 @@ var_t* var_new(var_type_t t, ...) {
         break;
 
         case VAR_LIST: {
-            // allocate struct memory 
-            res->data.l = malloc(sizeof (var_list_t));
-            MEM_CHECK(res->data.l);
-            
             // get argument length
-            res->data.l->len = 0;
+            size_t len = 0;
             for (var_t* temp = va_arg(ap, var_t*); 
                 temp != NULL; 
-                temp = (res->data.l->len++, va_arg(ap, var_t*)));
+                temp = (len++, va_arg(ap, var_t*)));
             va_end(ap);    
             va_start(ap, t);
-
-            // early return if len is 0 
-            if (res->data.l->len == 0) return res;
-
-            // calculate total needed nodes
-            size_t node_count = (res->data.l->len + LIST_SIZE - 1) / LIST_SIZE;
-            
-            // allocate memory
-            var_node_t* curr = &(res->data.l->lv);
-            for (size_t i = 1; i < node_count; i++) {
-                curr->next = malloc(sizeof (var_node_t));
-                MEM_CHECK(curr->next);
-                curr = curr->next;
+            if (var_budget_over(sizeof (var_t) + sizeof (var_list_t) + sizeof (var_t*) * len)) {
+                for (size_t i = 0; i < len; i++) var_delete(va_arg(ap, var_t*));
+                break;
             }
-            curr->next = NULL;
 
             // assign values 
-            curr = &(res->data.l->lv);
-            for (size_t i = 0; i < res->data.l->len; i += LIST_SIZE) {
-                for (size_t j = 0; j < LIST_SIZE && i + j < res->data.l->len; j++) {
-                    curr->vars[j] = va_arg(ap, var_t*);
-                }
-                curr = curr->next;
+            res = var_box(t);
+            var_list_init(res, len);
+            for (size_t i = 0; i < len; i++) {
+                res->data.l->lv[i] = va_arg(ap, var_t*);
             }
+            res->data.l->len = len;
         }
         break;
 
-        case VAR_DICT: {
-            var_t* key = va_arg(ap, var_t*);
-            var_t* val = va_arg(ap, var_t*);
-            res = var_new_dict(key, val);
-        }
-        break;
-        
         default: {
             va_end(ap);
             ERRO("unknown type");
@@ -132,9 +129,6 @@ var_t* var_new(var_type_t t, ...) {
     // cleanup varadic arguments
     va_end(ap);
 
-    // set type and ref
-    res->type   = t;
-
     return res;
 }
 
@@ -154,76 +148,8 @@ var_t* var_vnews(const char** format, va_list ap) {
     var_t* res;
 
     switch (**format) {
-        // var_t, any `var_t*` will be acceptable
-        case 'v': {
-            res = va_arg(ap, var_t*);
-        }
-        break;
-
-        // nil
-        case 'n': {
-            res = malloc(sizeof (var_t));
-            MEM_CHECK(res);
-            res->type = VAR_NIL;
-        }
-        break;
-
-        // int
-        case 'i': {
-            res = malloc(sizeof (var_t));
-            MEM_CHECK(res);
-            res->type = VAR_INT;
-            res->data.i = va_arg(ap, int64_t);
-        }
-        break;
-
-        // uint
-        case 'u': {
-            res = malloc(sizeof (var_t));
-            MEM_CHECK(res);
-            res->type = VAR_UINT;
-            res->data.u = va_arg(ap, uint64_t); 
-        }
-        break;
-
-        // float 
-        case 'f': {
-            res = malloc(sizeof (var_t));
-            MEM_CHECK(res);
-            res->type = VAR_FLOAT;
-            res->data.f = va_arg(ap, double);
-        }
-        break;
-
-        // string
-        case 's': {
-            res = malloc(sizeof (var_t));
-            MEM_CHECK(res);
-            res->type = VAR_STRING;
-            char* str = va_arg(ap, char*);
-            size_t str_len = strlen(str);
-            res->data.s = malloc(sizeof (var_string_t) + sizeof (char) * (str_len + 1));
-            MEM_CHECK(res->data.s);
-            res->data.s->len = str_len;
-            strcpy(res->data.s->str, str);
-        }
-        break;
-
-        // array 
-        case 'a': {
-            res = va_arg(ap, var_t*);
-            if (res->type != VAR_ARRAY) {
-                ERRO("parsing failed");
-            }
-        }
-        break;
-
         // array with initialization 
         case '(': {
-            res = malloc(sizeof (var_t));
-            MEM_CHECK(res);
-            res->type = VAR_ARRAY;
-
             // get array length 
             size_t          a       = 1;            // nested array
             size_t          l       = 0;            // nested list
@@ -255,32 +181,19 @@ var_t* var_vnews(const char** format, va_list ap) {
             }
 
             // allocate memory 
-            res->data.a = malloc(sizeof (var_array_t) + sizeof (var_t*) * len);
-            MEM_CHECK(res->data.a);
+            res = var_box_array(len);
 
             // assign value
             (*format)++;
-            res->data.a->len = len;
             for (size_t i = 0; i < len; i++) {
                 res->data.a->av[i] = var_vnews(format, ap);
             }
         }
         break;
 
-        // list 
-        case 'l': {
-            res = va_arg(ap, var_t*);
-            if (res->type != VAR_LIST) {
-                ERRO("parsing failed");
-            }
-        }
-        break;
-
         // list with initalization
         case '[': {
-            res = malloc(sizeof (var_t));
-            MEM_CHECK(res);
-            res->type = VAR_LIST;
+            res = var_box(VAR_LIST);
             
             // get array length 
             size_t          a   = 0;            // nested array
@@ -313,30 +226,88 @@ var_t* var_vnews(const char** format, va_list ap) {
             }
 
             // allocate memory 
-            res->data.l         = malloc(sizeof (var_list_t));
-            res->data.l->len    = len;
-            
-            // total node count 
-            size_t node_count   = (len + LIST_SIZE - 1) / LIST_SIZE;
-            
-            // allocate node memory 
-            var_node_t* curr = &(res->data.l->lv);
-            for (size_t i = 1; i < node_count; i++) {
-                curr->next = malloc(sizeof (var_node_t));
-                MEM_CHECK(curr->next);
-                curr = curr->next;
-            }
-            curr->next = NULL;
-
+            var_list_init(res, len);
 
             // assign values
             (*format)++;
-            curr = &(res->data.l->lv);
-            for (size_t i = 0; i < len; i += LIST_SIZE) {
-                for (size_t j = 0; j < LIST_SIZE && i + j < len; j++) {
-                    curr->vars[j] = var_vnews(format, ap);
-                }
-                curr = curr->next;
+            for (size_t i = 0; i < len; i++) {
+                res->data.l->lv[i] = var_vnews(format, ap);
+            }
+            res->data.l->len = len;
+        }
+        break;
+
+        default: {
+            res = var_new_op(**format, ap);
+        }
+    }
+
+    (*format)++;
+
+    return res;
+}
+
+
+/*
+ * a `var_t*` of a single format character that is not `(` or `[`
+ */
+var_t* var_new_op(char op, va_list ap) {
+    var_t* res = NULL;
+
+    switch (op) {
+        // var_t, any `var_t*` will be acceptable
+        case 'v': {
+            res = va_arg(ap, var_t*);
+        }
+        break;
+
+        // nil
+        case 'n': {
+            res = var_new_nil();
+        }
+        break;
+
+        // int
+        case 'i': {
+            res = var_box_int(va_arg(ap, int64_t));
+        }
+        break;
+
+        // uint
+        case 'u': {
+            res = var_box_uint(va_arg(ap, uint64_t)); 
+        }
+        break;
+
+        // float 
+        case 'f': {
+            res = var_box_float(va_arg(ap, double));
+        }
+        break;
+
+        // string
+        case 's': {
+            char* str = va_arg(ap, char*);
+            size_t str_len = strlen(str);
+            res = var_box_string(str_len);
+            memcpy(var_str(res), str, str_len);
+        }
+        break;
+
+        // array 
+        case 'a': {
+            res = va_arg(ap, var_t*);
+            if (var_typeof(res) != VAR_ARRAY) {
+                ERRO("parsing failed");
+            }
+        }
+        break;
+
+        // list 
+        case 'l': {
+            res = va_arg(ap, var_t*);
+            if (var_typeof(res) != VAR_LIST) {
+                ERRO("parsing failed");
             }
         }
         break;
@@ -344,7 +315,7 @@ var_t* var_vnews(const char** format, va_list ap) {
         // dict 
         case 'd': {
             res = va_arg(ap, var_t*);
-            if (res->type != VAR_DICT) {
+            if (var_typeof(res) != VAR_DICT) {
                 ERRO("parsing failed");
             }
         }
@@ -355,86 +326,88 @@ var_t* var_vnews(const char** format, va_list ap) {
         }
     }
 
-    (*format)++;
-
     return res;
 }
 
 
+/*
+ * nil is always an immediate value, it is never allocated
+ */
 var_t* var_new_nil(void) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_NIL;
-    return res;
+    return VAR_IMM_NIL;
 }
 
 
+/*
+ * scalars are immediate values if they fit in the pointer, see `varprivate.h`.
+ * the others are `NULL` once the budget in use is spent, see `var_budget_use`
+ */
 var_t* var_new_int(int64_t i) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_INT;
-    res->data.i = i;
-    return res;
+    var_t* res = var_imm_int(i);
+    if (res != NULL) return res;
+    if (var_budget_over(sizeof (var_t))) return NULL;
+    return var_box_int(i);
 }
 
 
 var_t* var_new_uint(uint64_t u) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_UINT;
-    res->data.u = u;
-    return res;
+    var_t* res = var_imm_uint(u);
+    if (res != NULL) return res;
+    if (var_budget_over(sizeof (var_t))) return NULL;
+    return var_box_uint(u);
 }
 
 
 var_t* var_new_float(double f) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_FLOAT;
-    res->data.f = f;
-    return res;
+    var_t* res = var_imm_float(f);
+    if (res != NULL) return res;
+    if (var_budget_over(sizeof (var_t))) return NULL;
+    return var_box_float(f);
 }
 
 
 /*
  * @param   s   format string 
  * @param   ... see `printf`
- * @return      a sized string 
+ * @return      a sized string, `NULL` over the budget in use
  */
 var_t* var_new_string(const char* s, ...) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_STRING;
-
     va_list ap;
     va_start(ap, s);
-    int str_len = vsnprintf(NULL, 0, s, ap);
+    var_t* res = var_new_vstring(s, ap);
     va_end(ap);
-    if (str_len < 0) ERRO("invalid format string");
 
-    res->data.s = malloc(sizeof (var_string_t) + str_len + 1);
-    MEM_CHECK(res->data.s);
+    return res;
+}
 
-    res->data.s->len = str_len;
-    va_start(ap, s);
-    vsprintf(res->data.s->str, s, ap);
-    va_end(ap);
+
+/*
+ * strings shorter than `SSO_SIZE` are stored inside of `var_t`
+ *
+ * @param   s   format string 
+ * @param   ap  see `vprintf`
+ * @return      a sized string, `NULL` over the budget in use
+ */
+var_t* var_new_vstring(const char* s, va_list ap) {
+    va_list cp;
+    va_copy(cp, ap);
+    int str_len = vsnprintf(NULL, 0, s, cp);
+    va_end(cp);
+    if (str_len < 0) ERRO("invalid format string");
+    if (var_budget_over(var_string_size(str_len))) return NULL;
+
+    var_t* res = var_box_string(str_len);
+    vsnprintf(var_str(res), str_len + 1, s, ap);
 
     return res;
 }
 
 
 var_t* var_new_array(var_t* var, ...) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_ARRAY;
-
     // return if len is 0
     if (var == NULL) {
-        res->data.a = malloc(sizeof (var_array_t));
-        MEM_CHECK(res->data.a);
-        res->data.a->len = 0;
-        return res;
+        if (var_budget_over(var_array_size(0))) return NULL;
+        return var_box_array(0);
     }
 
     va_list ap;
@@ -448,10 +421,16 @@ var_t* var_new_array(var_t* var, ...) {
     va_end(ap);    
     va_start(ap, var);
 
+    // elements are taken even if the budget is spent
+    if (var_budget_over(var_array_size(len))) {
+        var_delete(var);
+        for (size_t i = 1; i < len; i++) var_delete(va_arg(ap, var_t*));
+        va_end(ap);
+        return NULL;
+    }
+
     // alocate memory
-    res->data.a = malloc(sizeof (var_array_t) + sizeof (var_t*) * len);
-    MEM_CHECK(res->data.a);
-    res->data.a->len = len;
+    var_t* res = var_box_array(len);
 
     // assign values 
     res->data.a->av[0] = var;
@@ -467,37 +446,25 @@ var_t* var_new_array(var_t* var, ...) {
 
 /*
  * @param   size    size of the array/struct/tuple 
- * @return          an empty array/struct/tuple with size `size`
+ * @return          an empty array/struct/tuple with size `size`, `NULL` over the budget in use
  */
 var_t* var_new_array_size(size_t size) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_ARRAY;
-    res->data.a = malloc(sizeof (var_array_t) + sizeof (var_t*) * size);
-    MEM_CHECK(res->data.a);
-    res->data.a->len = size;
-    return res;
+    if (var_budget_over(var_array_size(size))) return NULL;
+    return var_box_array(size);
 }
 
 
 /*
  * @param   var first element of the list, `NULL` if empty list
  * @param   ... the rest of the elements, should end with `NULL`
- * @return      a new `var_t*` of type `VAR_LIST`
+ * @return      a new `var_t*` of type `VAR_LIST`, `NULL` over the budget in use
  */
 var_t* var_new_list(var_t* var, ...) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_LIST;
-
-    // allocate struct memory 
-    res->data.l = malloc(sizeof (var_list_t));
-    MEM_CHECK(res->data.l);
-    
     // return if len is 0
     if (var == NULL) {
-        res->data.l->len = 0;
-        res->data.l->lv.next = NULL;
+        if (var_budget_over(sizeof (var_t) + sizeof (var_list_t))) return NULL;
+        var_t* res = var_box(VAR_LIST);
+        var_list_init(res, 0);
         return res;
     }
 
@@ -505,38 +472,30 @@ var_t* var_new_list(var_t* var, ...) {
     va_start(ap, var);
 
     // get argument length
-    res->data.l->len = 1;
+    size_t len = 1;
     for (var_t* temp = va_arg(ap, var_t*); 
         temp != NULL; 
-        temp = (res->data.l->len++, va_arg(ap, var_t*)));
+        temp = (len++, va_arg(ap, var_t*)));
     va_end(ap);    
     va_start(ap, var);
 
-    // calculate total needed nodes
-    size_t node_count = (res->data.l->len + LIST_SIZE - 1) / LIST_SIZE;
-    
-    // allocate memory
-    var_node_t* curr = &(res->data.l->lv);
-    for (size_t i = 1; i < node_count; i++) {
-        curr->next = malloc(sizeof (var_node_t));
-        MEM_CHECK(curr->next);
-        curr = curr->next;
+    // elements are taken even if the budget is spent
+    if (var_budget_over(sizeof (var_t) + sizeof (var_list_t) + sizeof (var_t*) * len)) {
+        var_delete(var);
+        for (size_t i = 1; i < len; i++) var_delete(va_arg(ap, var_t*));
+        va_end(ap);
+        return NULL;
     }
-    curr->next = NULL;
 
     // assign values 
-    curr = &(res->data.l->lv);
-    curr->vars[0] = var;
-    for (size_t i = 1; i < LIST_SIZE && i < res->data.l->len; i++) {
-        curr->vars[i] = va_arg(ap, var_t*);
-    }
-    curr = curr->next;
-    for (size_t i = LIST_SIZE; i < res->data.l->len; i += LIST_SIZE) {
-        for (size_t j = 0; j < LIST_SIZE && i + j < res->data.l->len; j++) {
-            curr->vars[j] = va_arg(ap, var_t*);
-        }
-        curr = curr->next;
+    var_t* res = var_box(VAR_LIST);
+    var_list_init(res, len);
+    var_list_t* list = res->data.l;
+    list->lv[0] = var;
+    for (size_t i = 1; i < len; i++) {
+        list->lv[i] = va_arg(ap, var_t*);
     }
+    list->len = len;
 
     va_end(ap);
 
@@ -546,6 +505,8 @@ var_t* var_new_list(var_t* var, ...) {
 
 /*
  * the length of key_arr should be the same with val_arr
+ * the dict takes both keys and vals, but not key_arr and val_arr themselves
+ * keys are compared by value, a later duplicated key replaces the earlier one
  *
  * NOTE!
  * since list and dict are not hashable, they cannot be dict key
@@ -553,71 +514,53 @@ var_t* var_new_list(var_t* var, ...) {
  * 
  * @param   key_arr array of keys
  * @param   val_arr array of vals
- * @return          a new `var_t*` of type `VAR_DICT`
+ * @return          a new `var_t*` of type `VAR_DICT`, `NULL` over the budget in use
  */
 var_t* var_new_dict(var_t* key_arr, var_t* val_arr) {
-    var_t* res = malloc(sizeof (var_t));
-    MEM_CHECK(res);
-    res->type = VAR_DICT;
-
-    res->data.d = malloc(sizeof (var_dict_t));
-    MEM_CHECK(res->data.d);
-    res->data.d->mod = DICT_SIZE;
-    
     // len = 0 if NULL 
-    // get len
-    size_t len;
-    if (key_arr == NULL) {
-        len = 0;
-    } else {
-        size_t len = key_arr->data.a->len;
+    size_t len = 0;
+    if (key_arr != NULL) {
+        if (var_typeof(key_arr) != VAR_ARRAY || val_arr == NULL || var_typeof(val_arr) != VAR_ARRAY) {
+            ERRO("keys and vals of dict must be arrays");
+        }
+        len = key_arr->data.a->len;
         if (len != val_arr->data.a->len) {
             ERRO("key size must be exactly equal to val size");
         }
     }
 
-    // alloate memory 
-    res->data.d->list = malloc(sizeof (var_dict_list_t) * DICT_SIZE);
-    MEM_CHECK(res->data.d->list);
-    memset(res->data.d->list, 0, sizeof (var_dict_list_t) * DICT_SIZE);
+    // keys and vals are taken even if the budget is spent
+    if (var_budget_over(sizeof (var_t) + sizeof (var_dict_t) + var_dict_table_size(len))) {
+        for (size_t i = 0; i < len; i++) {
+            var_delete(key_arr->data.a->av[i]);
+            var_delete(val_arr->data.a->av[i]);
+        }
+        return NULL;
+    }
+
+    var_t* res = var_box(VAR_DICT);
+    var_dict_init(res, len);
 
     // assign values 
-    size_t index;
+    bool found;
     uint64_t hash;
-    var_dict_elem_t* elem;
+    var_dict_slot_t* slot;
     for (size_t i = 0; i < len; i++) {
-        elem = malloc(sizeof (var_dict_elem_t));
-        MEM_CHECK(elem);
-        elem->key = key_arr->data.a->av[i];
-        elem->val = val_arr->data.a->av[i];
-        if (var_hash(elem->key, &hash) == false) {
-            ERRO("failed to hash")
-        }
-        elem->hash = hash;
-        index = hash % DICT_SIZE;
-        elem->prev = res->data.d->list[index].tail;
-        elem->next = NULL;
-        if (res->data.d->list[index].size++ == 0) {
-            res->data.d->list[index].head = elem;
-            res->data.d->list[index].tail = elem;
+        var_t* key = key_arr->data.a->av[i];
+        var_t* val = val_arr->data.a->av[i];
+        if (var_hash(key, &hash) == false) {
+            ERRO("failed to hash");
+        }
+        slot = var_dict_emplace(res, key, hash, &found);
+        if (found) {
+            if (slot->key != key) var_delete(key);
+            if (slot->val != val) var_delete(slot->val);
         } else {
-            res->data.d->list[index].tail->next = elem;
-            res->data.d->list[index].tail = elem;
-        }
-    }
-
-    size_t max = 0;
-    for (size_t i = 0; i < DICT_SIZE; i++) {
-        if (res->data.d->list[i].size > max) {
-            max = res->data.d->list[i].size;
+            slot->key = key;
         }
+        slot->val = val;
     }
 
-    if (max <= DICT_SIZE) return res;
-    max /= DICT_SIZE;
-
-    var_dict_reshape(res->data.d, max);
-
     return res;
 }
 
@@ -628,75 +571,38 @@ var_t* var_new_dict(var_t* key_arr, var_t* val_arr) {
  * @param   var the var you want to free 
  */
 void var_delete(var_t* var) {
-    (void) var;
-    switch (var->type) {
-        case VAR_INT: {
-            free(var);
-        }
-        break;
-
-        case VAR_UINT: {
-            free(var);
-        }
-        break;
-
-        case VAR_FLOAT: {
-            free(var);
-        }
-        break;
+    // an element taken out of its array is a change of the array, see `var_hash_fresh`
+    if (var_is_imm(var) == false && (var->flag & VAR_FLAG_HASHED)) var_hash_changed();
+    var_delete_elem(var);
+}
 
-        case VAR_STRING: {
-            free(var->data.s);
-            free(var);
-        }
-        break;
 
-        case VAR_ARRAY: {
-            var_array_t* arr = var->data.a;
-            for (size_t i = 0; i < arr->len; i++) {
-                var_delete(arr->av[i]);
-            }
-            free(var->data.a);
-            free(var);
-        }
-        break;
+/*
+ * same as `var_delete` for an element freed with its container, which has no cached hash to keep
+ */
+void var_delete_elem(var_t* var) {
+    // immediate values are not allocated
+    if (var_is_imm(var)) return;
 
-        case VAR_LIST: {
-            var_node_t* curr = &var->data.l->lv;
-            var_node_t* next;
-            for (size_t i = 0; i < LIST_SIZE && i < var->data.l->len; i++) {
-                var_delete(curr->vars[i]);
-            }
-            for (size_t i = LIST_SIZE; i < var->data.l->len; i += LIST_SIZE) {
-                for (size_t j = 0; j < LIST_SIZE && i + j < var->data.l->len; j++) {
-                    var_delete(curr->vars[i]);
-                }
-                next = curr->next;
-                free(curr);
-                curr = next;
-            }
-            free(var->data.l);
-            free(var);
-        }
-        break;
+    // arena memory is released with the arena
+    if (var->flag & VAR_FLAG_ARENA) return;
 
+    switch (var->type) {
+        case VAR_NIL:
+        case VAR_INT:
+        case VAR_UINT:
+        case VAR_FLOAT:
+        case VAR_STRING:
+        case VAR_ARRAY:
+        case VAR_LIST:
         case VAR_DICT: {
-            var_dict_t* dict = var->data.d;
-            var_dict_elem_t* curr;
-            var_dict_elem_t* next;
-            for (size_t i = 0; i < dict->mod; i++) {
-                curr = dict->list[i].head;
-                for (size_t j = 0; j < dict->list[i].size; j++) {
-                    var_delete(curr->key);
-                    var_delete(curr->val);
-                    next = curr->next;
-                    free(curr);
-                    curr = next;
-                }
+            // shared payloads are freed with their last owner
+            var_drop(var);
+            if (var->flag & VAR_FLAG_NODE) {
+                var_block_free(var);
+            } else {
+                free(var);
             }
-            free(dict->list);
-            free(dict);
-            free(var);
         }
         break;
 
@@ -707,54 +613,226 @@ void var_delete(var_t* var) {
 }
 
 
+// hash
+
+// 0 until the first hash, all threads agree on the first key that is stored
+static atomic_uint_fast64_t var_hash_seed_key;
+
+
+// bits that differ between processes
+static uint64_t var_hash_entropy(void) {
+    uint64_t res = 0;
+#ifndef _WIN32
+    FILE* fp = fopen("/dev/urandom", "rb");
+    if (fp != NULL) {
+        if (fread(&res, sizeof (uint64_t), 1, fp) != 1) res = 0;
+        fclose(fp);
+    }
+#endif  // _WIN32
+
+    // addresses are randomized by ASLR, the clock differs between runs
+    uint64_t local = 0;
+    res ^= var_hash_word((uint64_t) (uintptr_t) &local, (uint64_t) time(NULL));
+    res ^= var_hash_word((uint64_t) (uintptr_t) &var_hash_seed_key, (uint64_t) clock());
+    return res;
+}
+
+
+uint64_t var_hash_key(void) {
+    uint_fast64_t key = atomic_load_explicit(&var_hash_seed_key, memory_order_relaxed);
+    if (key != 0) return key;
+
+    uint_fast64_t fresh = var_hash_entropy() | 1;
+    if (atomic_compare_exchange_strong(&var_hash_seed_key, &key, fresh)) return fresh;
+    return key;
+}
+
+
+/*
+ * set the seed of `var_hash`, which is random per process by default,
+ * so the same input does not collide the same way in every process.
+ * a fixed seed makes hashes reproducible between runs.
+ * it must be called before any `var_t` is hashed, dicts built with another seed are corrupted.
+ *
+ * @param   seed    the seed
+ */
+void var_hash_seed(uint64_t seed) {
+    atomic_store(&var_hash_seed_key, var_hash_word(seed, HASH_P2) | 1);
+}
+
+
+// changes of marked `var_t` so far, above the 0 stamp of arrays that never checked their elements
+atomic_uint_fast64_t var_hash_epoch = 1;
+
+
+// if no element of `arr` is unmarked, nested arrays included, this walks the `var_t` of the array without hashing
+static bool var_hash_clean(const var_array_t* arr) {
+    for (size_t i = 0; i < arr->len; i++) {
+        const var_t* elem = arr->av[i];
+        if (var_is_imm(elem)) continue;
+        if ((elem->flag & VAR_FLAG_HASHED) == 0) return false;
+        if (elem->type == VAR_ARRAY && var_hash_clean(elem->data.a) == false) return false;
+    }
+    return true;
+}
+
+
 /*
- * list and dict will not be hashable. 
+ * if no element of `arr` changed since its hash was cached.
+ * elements are marked as they are hashed by the array and unmarked by every change, see `var_hash_touch`.
+ * a `var_t` has no room to point to the array that holds it, so a change cannot reach the cached hashes above it.
+ * instead every unmarking bumps `var_hash_epoch`, and an array stamped with the current epoch is fresh in O(1).
+ * the trade-off is that after a change of any marked `var_t`, every cached array walks its elements once
+ * on its next hit before it is stamped again, which is O(nodes) but does not hash.
+ */
+bool var_hash_fresh(var_array_t* arr) {
+    uint64_t epoch = atomic_load_explicit(&var_hash_epoch, memory_order_relaxed);
+    if (var_hash_cache_load(&arr->seen) == epoch) return true;
+    if (var_hash_clean(arr) == false) return false;
+    var_hash_cache_store(&arr->seen, epoch);
+    return true;
+}
+
+
+static bool var_hash_of(const var_t* var, uint64_t* hash, bool cache);
+
+// hash of an element of an array, marked until it changes if the array caches its hash
+static bool var_hash_elem(var_t* elem, uint64_t* hash, bool cache) {
+    if (var_is_imm(elem) || cache == false) return var_hash_of(elem, hash, cache);
+
+    // a marked array is only cached by the array that marked it, which is this one
+    if (elem->flag & VAR_FLAG_HASHED) elem->flag &= ~VAR_FLAG_HASHED;
+    if (var_hash_of(elem, hash, true) == false) return false;
+    elem->flag |= VAR_FLAG_HASHED;
+    return true;
+}
+
+
+typedef struct var_hash_task {
+    var_t**     elem;
+    uint64_t*   hash;   // of each element
+    bool        cache;
+    atomic_bool failed;
+} var_hash_task_t;
+
+
+static void var_hash_range(void* arg, size_t begin, size_t end) {
+    var_hash_task_t* task = arg;
+    for (size_t i = begin; i < end && atomic_load_explicit(&task->failed, memory_order_relaxed) == false; i++) {
+        if (var_hash_elem(task->elem[i], &task->hash[i], task->cache) == false) {
+            atomic_store_explicit(&task->failed, true, memory_order_relaxed);
+        }
+    }
+}
+
+
+// elements are hashed by the pool, then combined in order, same as one by one
+static bool var_hash_parallel(var_array_t* arr, uint64_t* hash, bool cache) {
+    var_hash_task_t task = { .elem = arr->av, .hash = malloc(sizeof (uint64_t) * arr->len), .cache = cache };
+    MEM_CHECK(task.hash);
+    atomic_init(&task.failed, false);
+    var_pool_for(var_hash_range, &task, arr->len);
+
+    bool res = atomic_load(&task.failed) == false;
+    for (size_t i = 0; res && i < arr->len; i++) {
+        *hash ^= task.hash[i] + DICT_RATIO + (*hash << 6) + (*hash >> 2);
+    }
+    free(task.hash);
+    return res;
+}
+
+
+/*
+ * nil, list and dict will not be hashable. 
  * int, uint, float, string, and array are hashable types. 
+ * hashes are seeded, see `var_hash_seed`, they differ between processes.
+ * hashes of long strings and arrays are cached in their payload until they are changed,
+ * hashing the same key again does not hash its bytes again.
+ * a cached array is O(1) unless some element of any array changed since, see `var_hash_fresh`.
  *
  * @param   var     the `var_t*` that you want to get the hash code from
  * @param   hash    a pointer to a `uint64_t` that will be used to store the result
  * @return          if the `var_t*` is hashable or not, if hash succeeded
  */
 bool var_hash(const var_t* var, uint64_t* hash) {
-    switch (var->type) {
+    return var_hash_of(var, hash, true);
+}
+
+
+// hash of `var`, arrays are cached and mark their elements if `cache`
+static bool var_hash_of(const var_t* var, uint64_t* hash, bool cache) {
+    switch (var_typeof(var)) {
+        case VAR_NIL: {
+            return false;
+        }
+
         case VAR_INT: {
-            memcpy(hash, &var->data.i, sizeof (int64_t));
+            *hash = var_hash_word((uint64_t) var_int_of(var), var_hash_key());
             return true;
         }
 
         case VAR_UINT: {
-            memcpy(hash, &var->data.u, sizeof (uint64_t));
+            *hash = var_hash_word(var_uint_of(var), var_hash_key());
             return true;
         }
 
         case VAR_FLOAT: {
-            memcpy(hash, &var->data.f, sizeof (double));
+            // bits, same as `var_key_equal`
+            double f = var_float_of(var);
+            uint64_t bits;
+            memcpy(&bits, &f, sizeof (double));
+            *hash = var_hash_word(bits, var_hash_key());
             return true;
         }
 
         case VAR_STRING: {
-            // FNV-1a algorithm for string hashing
-            *hash = (uint64_t) DICT_HASH;
-            const unsigned char* ptr = (const unsigned char*) var->data.s->str;
-
-            for (size_t i = 0; i < var->data.s->len; i++) {
-                *hash ^= (uint64_t) (ptr[i]);
-                *hash *= DICT_PRIME;
+            // short strings are not worth a cache
+            if (var->flag & VAR_FLAG_SHORT) {
+                *hash = var_hash_bytes(var->data.ss, var_str_len(var), var_hash_key());
+                return true;
             }
-
+            var_string_t* str = var->data.s;
+            uint64_t cached = var_hash_cache_load(&str->hash);
+            if (cached != 0) {
+                *hash = cached;
+                return true;
+            }
+            *hash = var_hash_bytes(str->str, str->len, var_hash_key());
+            var_hash_cache_store(&str->hash, *hash);
             return true;
         }
 
         case VAR_ARRAY: {
+            // elements may be changed without their array, their marks tell if they were
+            var_array_t* arr = var->data.a;
+            uint64_t cached = var_hash_cache_load(&arr->hash);
+            if (cached != 0 && var_hash_fresh(arr)) {
+                *hash = cached;
+                return true;
+            }
+            // every element is marked once hashed, changes since are seen by the epoch
+            uint64_t epoch = atomic_load_explicit(&var_hash_epoch, memory_order_relaxed);
+
+            // a marked array is part of the cached hash of another array, that array caches it again
+            if (var->flag & VAR_FLAG_HASHED) cache = false;
+
             // combining hashes of all vars inside
             // old_hash ^= new_hash + 0x9e3779b97f4a7c15 + (old_hash << 6) + (old_hash >> 2);
             *hash = 0;
-            uint64_t new_hash;
-            for (size_t i = 0; i < var->data.a->len; i++) {
-                if (var_hash(var->data.a->av[i], &new_hash) == false) {
-                    return false;
+            if (var_pool_split(arr->len)) {
+                if (var_hash_parallel(arr, hash, cache) == false) return false;
+            } else {
+                uint64_t new_hash;
+                for (size_t i = 0; i < arr->len; i++) {
+                    if (var_hash_elem(arr->av[i], &new_hash, cache) == false) {
+                        return false;
+                    }
+                    *hash ^= new_hash + DICT_RATIO + (*hash << 6) + (*hash >> 2);
                 }
-                *hash ^= new_hash + DICT_RATIO + (*hash << 6) + (*hash >> 2);
+            }
+            if (cache) {
+                var_hash_cache_store(&arr->seen, epoch);
+                var_hash_cache_store(&arr->hash, *hash);
             }
             return true;
         }
@@ -795,9 +873,38 @@ void var_get(const var_t* var, const char* format, ...) {
 void var_vget(const var_t* var, const char** format, va_list ap) {
     while (**format == ' ') (*format)++;
     const char* ptr = *format;
-    switch (var->type) {
+    var_type_t t = var_typeof(var);
+
+    if (*ptr == '(' && t == VAR_ARRAY) {
+        for (size_t i = (ptr++, 0); 
+            i < var->data.a->len && *ptr != '\0' && *ptr != ')'; 
+            i++) {
+            var_vget(var->data.a->av[i], &ptr, ap);
+        }
+        *format = ptr;
+    } else if (*ptr == '[' && t == VAR_LIST) {
+        var_list_t* list = var->data.l;
+        for (size_t i = (ptr++, 0);
+            i < list->len && *ptr != '\0' && *ptr != ']';
+            i++) {
+            var_vget(list->lv[i], &ptr, ap);
+        }
+        *format = ptr;
+    } else {
+        var_get_op(var, *ptr, ap);
+    }
+
+    (*format)++;
+}
+
+
+/*
+ * get through a single format character that is not `(` or `[`
+ */
+void var_get_op(const var_t* var, char op, va_list ap) {
+    switch (var_typeof(var)) {
         case VAR_NIL: {
-            switch(*ptr) {
+            switch (op) {
                 case 'n':
                 case 'v': {
                     memcpy(va_arg(ap, var_t**), &var, sizeof (var_t*));
@@ -812,9 +919,9 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_INT: {
-            switch (*ptr) {
+            switch (op) {
                 case 'i': {
-                    memcpy(va_arg(ap, int64_t*), &var->data.i, sizeof (int64_t));
+                    *va_arg(ap, int64_t*) = var_int_of(var);
                 }
                 break;
                 case 'v': {
@@ -831,9 +938,9 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_UINT: {
-            switch (*ptr) {
+            switch (op) {
                 case 'u': {
-                    memcpy(va_arg(ap, uint64_t*), &var->data.u, sizeof (uint64_t));
+                    *va_arg(ap, uint64_t*) = var_uint_of(var);
                 }
                 break;
                 case 'v': {
@@ -850,9 +957,9 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_FLOAT: {
-            switch (*ptr) {
+            switch (op) {
                 case 'f': {
-                    memcpy(va_arg(ap, double*), &var->data.f, sizeof (double));
+                    *va_arg(ap, double*) = var_float_of(var);
                 }
                 break;
                 case 'v': {
@@ -869,10 +976,10 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_STRING: {
-            switch (*ptr) {
+            switch (op) {
                 case 's': {
                     char** str_ptr = va_arg(ap, char**);
-                    *str_ptr = var->data.s->str;
+                    *str_ptr = var_str(var);
                 }
                 break;
                 case 'v': {
@@ -889,7 +996,7 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_ARRAY: {
-            switch (*ptr) {
+            switch (op) {
                 case 'a': {
                     memcpy(va_arg(ap, var_t**), &var, sizeof (var_t*));
                 }
@@ -900,15 +1007,6 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
                 break;
                 case '_': break;
 
-                case '(': {
-                    for (size_t i = (ptr++, 0); 
-                        i < var->data.a->len && *ptr != '\0' && *ptr != ')'; 
-                        i++) {
-                        var_vget(var->data.a->av[i], &ptr, ap);
-                    }
-                }
-                break;
-
                 default: {
                     ERRO("parsing failed, expected type `VAR_ARRAY`");
                 }
@@ -917,7 +1015,7 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_LIST: {
-            switch (*ptr) {
+            switch (op) {
                 case 'l': {
                     memcpy(va_arg(ap, var_t**), &var, sizeof (var_t*));
                 }
@@ -928,20 +1026,6 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
                 break;
                 case '_': break;
 
-                case '[': {
-                    var_list_t* list = var->data.l;
-                    var_node_t* curr = &list->lv;
-                    for (size_t i = (ptr++, 0);
-                        i < list->len && *ptr != '\0' && *ptr != ']';
-                        i++) {
-                        var_vget(curr->vars[i % LIST_SIZE], &ptr, ap);
-                        if (i % LIST_SIZE == 0 && i != 0) {
-                            curr = curr->next;
-                        }
-                    }
-                }
-                break;
-
                 default: {
                     ERRO("parsing failed, expected type `VAR_LIST`");
                 }
@@ -950,7 +1034,7 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_DICT: {
-            switch (*ptr) {
+            switch (op) {
                 case 'd': {
                     memcpy(va_arg(ap, var_t**), &var, sizeof (var_t*));
                 }
@@ -973,8 +1057,6 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
         }
         break;
     }
-
-    (*format)++;
 }
 
 
@@ -989,10 +1071,13 @@ void var_vget(const var_t* var, const char** format, va_list ap) {
  * 
  * other valid input: 
  *      _: ignored
- *      v: `var_t*`, it must be of the same type as before, it is passed by value, u need to destroy the original `var_t*` manually
+ *      v: `var_t*`, it must be of the same type as before, its value is shared (see `var_retain`), u need to destroy the original `var_t*` manually
  *      (): setting fields of array 
  *      []: setting fields of list 
  *
+ * nil, int, uint, and float may be immediate values (see `varprivate.h`), 
+ * they can only be set through the array or list that contains them.
+ *
  *
  * @param   var     the `var_t*` that you want to change
  * @param   format  the format of the `var_t*`, see above
@@ -1008,16 +1093,134 @@ void var_set(var_t* var, const char* format, ...) {
 }
 
 
+/*
+ * set the `var_t*` stored in `slot` of the array or list `owner`.
+ * immediate values cannot be changed in place, they are replaced in `slot`.
+ */
+static void var_vset_slot(const var_t* owner, var_t** slot, const char** format, va_list ap) {
+    if (var_is_imm(*slot) == false) {
+        var_vset(*slot, format, ap);
+        return;
+    }
+
+    while (**format == ' ') (*format)++;
+    var_set_slot_op(owner, slot, **format, ap);
+    (*format)++;
+}
+
+
+/*
+ * set the `var_t*` stored in `slot` of the array or list `owner` through a single format character that is not `(` or `[`.
+ * a replaced immediate value is boxed for `owner`, from the heap or its own arena, see `var_box_for`
+ */
+void var_set_slot_op(const var_t* owner, var_t** slot, char op, va_list ap) {
+    var_t* var = *slot;
+    if (var_is_imm(var) == false) {
+        var_set_op(var, op, ap);
+        return;
+    }
+
+    var_type_t t = var_typeof(var);
+    switch (op) {
+        case 'n': {
+            if (t == VAR_NIL) {
+                ERRO("parsing failed, expected type `var_t*`");
+            }
+            *slot = var_new_nil();
+        }
+        break;
+        case 'i': {
+            if (t != VAR_INT) {
+                ERRO("parsing failed, expected type `VAR_INT`");
+            }
+            *slot = var_box_int_for(owner, va_arg(ap, int64_t));
+        }
+        break;
+        case 'u': {
+            if (t != VAR_UINT) {
+                ERRO("parsing failed, expected type `VAR_UINT`");
+            }
+            *slot = var_box_uint_for(owner, va_arg(ap, uint64_t));
+        }
+        break;
+        case 'f': {
+            if (t != VAR_FLOAT) {
+                ERRO("parsing failed, expected type `VAR_FLOAT`");
+            }
+            *slot = var_box_float_for(owner, va_arg(ap, double));
+        }
+        break;
+        case 'v': {
+            var_t* temp = va_arg(ap, var_t*);
+            if (t != VAR_NIL && var_typeof(temp) != t) {
+                ERRO("parsing failed, `var_t*` of different type");
+            }
+            if (var_is_imm(temp)) {
+                *slot = temp;
+                break;
+            }
+            // a `var_t` of `owner` shares the value, see `var_share`
+            *slot = var_box_for(owner, VAR_NIL);
+            var_share(*slot, temp);
+        }
+        break;
+        case '_': break;
+
+        default: {
+            ERRO("parsing failed, unexpected type for immediate value");
+        }
+    }
+}
+
+
 void var_vset(var_t* var, const char** format, va_list ap) {
     while (**format == ' ') (*format)++;
     const char* ptr = *format;
+    var_type_t t = var_typeof(var);
+
+    if (*ptr == '(' && t == VAR_ARRAY) {
+        var_unshare(var);
+        for (size_t i = (ptr++, 0); 
+            i < var->data.a->len && *ptr != '\0' && *ptr != ')'; 
+            i++) {
+            var_vset_slot(var, &var->data.a->av[i], &ptr, ap);
+        }
+        *format = ptr;
+    } else if (*ptr == '[' && t == VAR_LIST) {
+        var_unshare(var);
+        var_list_t* list = var->data.l;
+        for (size_t i = (ptr++, 0);
+            i < list->len && *ptr != '\0' && *ptr != ']';
+            i++) {
+            var_vset_slot(var, &list->lv[i], &ptr, ap);
+        }
+        *format = ptr;
+    } else {
+        var_set_op(var, *ptr, ap);
+    }
+
+    (*format)++;
+}
+
+
+/*
+ * set through a single format character that is not `(` or `[`
+ */
+void var_set_op(var_t* var, char op, va_list ap) {
+    // immediate values are passed by value, only their container can change them
+    if (var_is_imm(var)) {
+        if (op != '_') {
+            ERRO("immediate `var_t` cannot be set in place, set it through its array or list");
+        }
+        return;
+    }
+    if (op != '_') var_hash_touch(var);
+
     switch (var->type) {
         case VAR_NIL: {
-            switch (*ptr) {
+            switch (op) {
                 case 'v': {
-                    var_t* temp = va_arg(ap, var_t*);
-                    *var = *temp;
-                    // TODO: require `var_copy`
+                    var_share(var, va_arg(ap, var_t*));
                 }
                 break;
                 case '_': break;
@@ -1030,7 +1233,7 @@ void var_vset(var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_INT: {
-            switch (*ptr) {
+            switch (op) {
                 case 'i': {
                     var->data.i = va_arg(ap, int64_t);
                 }
@@ -1041,10 +1244,10 @@ void var_vset(var_t* var, const char** format, va_list ap) {
                 break;
                 case 'v': {
                     var_t* temp = va_arg(ap, var_t*);
-                    if (temp->type != VAR_INT) {
+                    if (var_typeof(temp) != VAR_INT) {
                         ERRO("parsing failed, expected type `VAR_INT`");
                     }
-                    var->data = temp->data;
+                    var->data.i = var_int_of(temp);
                 }
                 break;
                 case '_': break;
@@ -1057,7 +1260,7 @@ void var_vset(var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_UINT: {
-            switch (*ptr) {
+            switch (op) {
                 case 'u': {
                     var->data.u = va_arg(ap, uint64_t);
                 }
@@ -1068,10 +1271,10 @@ void var_vset(var_t* var, const char** format, va_list ap) {
                 break;
                 case 'v': {
                     var_t* temp = va_arg(ap, var_t*);
-                    if (temp->type != VAR_UINT) {
+                    if (var_typeof(temp) != VAR_UINT) {
                         ERRO("parsing failed, expected type `VAR_UINT`");
                     }
-                    var->data = temp->data;
+                    var->data.u = var_uint_of(temp);
                 }
                 break;
                 case '_': break;
@@ -1084,7 +1287,7 @@ void var_vset(var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_FLOAT: {
-            switch (*ptr) {
+            switch (op) {
                 case 'f': {
                     var->data.f = va_arg(ap, double);
                 }
@@ -1095,10 +1298,10 @@ void var_vset(var_t* var, const char** format, va_list ap) {
                 break;
                 case 'v': {
                     var_t* temp = va_arg(ap, var_t*);
-                    if (temp->type != VAR_FLOAT) {
+                    if (var_typeof(temp) != VAR_FLOAT) {
                         ERRO("parsing failed, expected type `VAR_FLOAT`");
                     }
-                    var->data = temp->data;
+                    var->data.f = var_float_of(temp);
 
                 }
                 break;
@@ -1112,26 +1315,24 @@ void var_vset(var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_STRING: {
-            switch (*ptr) {
+            switch (op) {
                 case 's': {
                     char* str = va_arg(ap, char*);
-                    size_t str_len = strlen(str);
-                    var->data.s = realloc(var->data.s, sizeof (var_string_t) + sizeof (char) * (str_len + 1));
-                    var->data.s->len = str_len;
-                    strcpy(var->data.s->str, str);
+                    var_str_assign(var, str, strlen(str));
                 }
                 break;
                 case 'n': {
+                    var_drop(var);
                     var->type = VAR_NIL;
-                    free(var->data.s);
+                    var->flag &= ~VAR_FLAG_SHORT;
                 }
                 break;
                 case 'v': {
                     var_t* temp = va_arg(ap, var_t*);
-                    if (temp->type != VAR_STRING) {
+                    if (var_typeof(temp) != VAR_STRING) {
                         ERRO("parsing failed, expected type `VAR_STRING`");
                     }
-                    // TODO: require `var_copy`
+                    var_share(var, temp);
                 }
                 break;
                 case '_': break;
@@ -1144,31 +1345,23 @@ void var_vset(var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_ARRAY: {
-            switch (*ptr) {
-                case 'a': {
-                    *var = *va_arg(ap, var_t*);
+            switch (op) {
+                case 'a':
+                case 'v': {
+                    var_t* temp = va_arg(ap, var_t*);
+                    if (var_typeof(temp) != VAR_ARRAY) {
+                        ERRO("parsing failed, expected type `VAR_ARRAY`");
+                    }
+                    var_share(var, temp);
                 }
                 break;
                 case 'n': {
+                    var_drop(var);
                     var->type = VAR_NIL;
-                    free(var->data.a);
-                }
-                break;
-                case 'v': {
-                    *var = *va_arg(ap, var_t*);
                 }
                 break;
                 case '_': break;
 
-                case '(': {
-                    for (size_t i = (ptr++, 0); 
-                        i < var->data.a->len && *ptr != '\0' && *ptr != ')'; 
-                        i++) {
-                        var_vset(var->data.a->av[i], &ptr, ap);
-                    }
-                }
-                break;
-
                 default: {
                     ERRO("parsing failed, expected type `VAR_ARRAY`");
                 }
@@ -1177,50 +1370,23 @@ void var_vset(var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_LIST: {
-            switch (*ptr) {
-                case 'l': {
-                    *var = *va_arg(ap, var_t*);
+            switch (op) {
+                case 'l':
+                case 'v': {
+                    var_t* temp = va_arg(ap, var_t*);
+                    if (var_typeof(temp) != VAR_LIST) {
+                        ERRO("parsing failed, expected type `VAR_LIST`");
+                    }
+                    var_share(var, temp);
                 }
                 break;
                 case 'n': {
+                    var_drop(var);
                     var->type = VAR_NIL;
-                    var_node_t* curr = &var->data.l->lv;
-                    var_node_t* next;
-                    for (size_t i = 0; i < LIST_SIZE && i < var->data.l->len; i++) {
-                        var_delete(curr->vars[i]);
-                    }
-                    for (size_t i = LIST_SIZE; i < var->data.l->len; i += LIST_SIZE) {
-                        for (size_t j = 0; j < LIST_SIZE && i + j < var->data.l->len; j++) {
-                            var_delete(curr->vars[i]);
-                        }
-                        next = curr->next;
-                        free(curr);
-                        curr = next;
-                    }
-                    free(var->data.l);
-                    free(var);
-                }
-                break;
-                case 'v': {
-                    *var = *va_arg(ap, var_t*);
                 }
                 break;
                 case '_': break;
 
-                case '[': {
-                    var_list_t* list = var->data.l;
-                    var_node_t* curr = &list->lv;
-                    for (size_t i = (ptr++, 0);
-                        i < list->len && *ptr != '\0' && *ptr != ']';
-                        i++) {
-                        var_vset(curr->vars[i % LIST_SIZE], &ptr, ap);
-                        if (i % LIST_SIZE == 0 && i != 0) {
-                            curr = curr->next;
-                        }
-                    }
-                }
-                break;
-
                 default: {
                     ERRO("parsing failed, expected type `VAR_LIST`");
                 }
@@ -1229,33 +1395,19 @@ void var_vset(var_t* var, const char** format, va_list ap) {
         break;
 
         case VAR_DICT: {
-            switch (*ptr) {
-                case 'd': {
-                    *var = *va_arg(ap, var_t*);
+            switch (op) {
+                case 'd':
+                case 'v': {
+                    var_t* temp = va_arg(ap, var_t*);
+                    if (var_typeof(temp) != VAR_DICT) {
+                        ERRO("parsing failed, expected type `VAR_DICT`");
+                    }
+                    var_share(var, temp);
                 }
                 break;
                 case 'n': {
+                    var_drop(var);
                     var->type = VAR_NIL;
-                    var_dict_t* dict = var->data.d;
-                    var_dict_elem_t* curr;
-                    var_dict_elem_t* next;
-                    for (size_t i = 0; i < dict->mod; i++) {
-                        curr = dict->list[i].head;
-                        for (size_t j = 0; j < dict->list[i].size; j++) {
-                            var_delete(curr->key);
-                            var_delete(curr->val);
-                            next = curr->next;
-                            free(curr);
-                            curr = next;
-                        }
-                    }
-                    free(dict->list);
-                    free(dict);
-                    free(var);
-                }
-                break;
-                case 'v': {
-                    *var = *va_arg(ap, var_t*);
                 }
                 break;
                 case '_': break;
@@ -1272,12 +1424,10 @@ void var_vset(var_t* var, const char** format, va_list ap) {
         }
         break;
     }
-
-    (*format)++;
 }
 
 size_t var_len(const var_t* var) {
-    switch (var->type) {
+    switch (var_typeof(var)) {
         case VAR_NIL: {
             ERRO("type `VAR_NIL` does not have len");
         }
@@ -1299,7 +1449,7 @@ size_t var_len(const var_t* var) {
         break;
 
         case VAR_STRING: {
-            return var->data.s->len;
+            return var_str_len(var);
         }
         break;
 
@@ -1314,11 +1464,7 @@ size_t var_len(const var_t* var) {
         break;
 
         case VAR_DICT: {
-            size_t len = 0;
-            for (size_t i = 0; i < var->data.d->mod; i++) {
-                len += var->data.d->list->size;
-            }
-            return len;
+            return var_dict_len(var->data.d);
         }
         break;
 
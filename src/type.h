@@ -16,12 +16,74 @@ typedef enum var_type {
     VAR_FLOAT   = 'f',  // 64 bits double precision floating points
     VAR_STRING  = 's',  // sized string with NULL terminator. Can be used to represent binary data. 
     VAR_ARRAY   = 'a',  // fix sized array, struct will be implemented as array, random access: O(1)
-    VAR_LIST    = 'l',  // dynamic array, random access time would be O(n)
+    VAR_LIST    = 'l',  // dynamic array, random access: O(1), append: amortized O(1)
     VAR_DICT    = 'd',  // dict
 } var_type_t;
 
 typedef struct var var_t;
+typedef struct var_arena var_arena_t;
+typedef struct var_plan var_plan_t;
+typedef void (*var_dict_scan_fn)(var_t* key, var_t* val, void* arg);
+typedef bool (*var_json_fn)(const char* data, size_t len, void* arg);
+typedef struct var_json_reader var_json_reader_t;
 
+// events of `var_json_reader_new`
+typedef enum var_json_event {
+    VAR_JSON_ARRAY_BEGIN,
+    VAR_JSON_ARRAY_END,
+    VAR_JSON_OBJECT_BEGIN,
+    VAR_JSON_OBJECT_END,
+    VAR_JSON_KEY,       // a key of an object, always a `VAR_STRING`
+    VAR_JSON_VALUE,     // a string, number or literal
+} var_json_event_t;
+
+typedef bool (*var_json_event_fn)(var_json_event_t event, const var_t* val, void* arg);
+typedef bool (*var_json_record_fn)(var_t* record, void* arg);
+
+// what `var_delete_deferred` does while the queue is full, see `var_defer_config`
+typedef enum var_defer_full {
+    VAR_DEFER_WAIT,     // wait until the reclaimer frees a batch
+    VAR_DEFER_INLINE,   // free the tree on the calling thread
+} var_defer_full_t;
+
+// flags of `var_to_json`
+#define VAR_JSON_PRETTY 0x1u    // new lines and indentation of 4 spaces
+
+// iterator of `VAR_ARRAY`, `VAR_LIST` and `VAR_DICT`, fields are private
+typedef struct var_iter {
+    const var_t*    var;
+    size_t          pos;    // index of the next element, or dict slot
+    size_t          table;  // dict table of `pos`
+    var_t*          val;    // dict val of the last key
+} var_iter_t;
+
+// growable byte buffer
+typedef struct var_buf {
+    unsigned char*  data;
+    size_t          len;
+    size_t          cap;
+} var_buf_t;
+
+// allocation budget of a thread, see `var_budget_use`
+typedef struct var_budget {
+    size_t  limit;  // bytes
+    size_t  used;   // bytes allocated while in use, freeing does not give them back
+} var_budget_t;
+
+// bytes of a tree by kind, see `var_memory_usage`
+typedef struct var_memory {
+    size_t  nodes;      // `var_t`, short strings included
+    size_t  strings;    // payloads of longer strings
+    size_t  slots;      // payloads of arrays and lists, with their element slots
+    size_t  buckets;    // payloads of dicts and their shards, with the control byte of each bucket
+    size_t  elements;   // hash, key and val of each bucket of dicts, empty or not
+} var_memory_t;
+
+// read-only view of a `var_t` inside of a buffer from `var_serialize_indexed`, fields are private
+typedef struct var_view {
+    const unsigned char*    p;      // tag of the value
+    const unsigned char*    end;    // end of the enclosing container, or of the buffer
+} var_view_t;
 
 
 // functions: 
@@ -34,17 +96,122 @@ var_t*  var_new_int(int64_t i);
 var_t*  var_new_uint(uint64_t u);
 var_t*  var_new_float(double f);
 var_t*  var_new_string(const char* s, ...);
+var_t*  var_new_vstring(const char* s, va_list ap);
 var_t*  var_new_array(var_t* var, ...);
 var_t*  var_new_array_size(size_t size);
 var_t*  var_new_list(var_t* var, ...);
 var_t*  var_new_list_empty(void);
 var_t*  var_new_dict(var_t* key_arr, var_t* val_arr);
+var_t*  var_new_dict_sharded(size_t shards);
 void    var_delete(var_t* var);
 bool    var_hash(const var_t* var, uint64_t* hash);
+void    var_hash_seed(uint64_t seed);
 void    var_get(const var_t* var, const char* format, ...);
 void    var_vget(const var_t* var, const char** format, va_list ap);
 void    var_set(var_t* var, const char* format, ...);
 void    var_vset(var_t* var, const char** format, va_list ap);
+size_t  var_len(const var_t* var);
+var_t*  var_copy(const var_t* var);
+bool    var_equal(const var_t* a, const var_t* b);
+int     var_compare(const var_t* a, const var_t* b);
+var_t*  var_retain(const var_t* var);
+void    var_release(var_t* var);
+
+// list
+var_t*      var_list_at(const var_t* var, size_t index);
+void        var_list_push(var_t* var, var_t* elem);
+var_t*      var_list_pop(var_t* var);
+void        var_list_insert(var_t* var, size_t index, var_t* elem);
+void        var_list_sort(var_t* var);
+void        var_array_sort(var_t* var);
+
+// iterator
+void        var_iter_init(var_iter_t* iter, const var_t* var);
+var_t*      var_iter_next(var_iter_t* iter);
+var_t*      var_iter_peek(const var_iter_t* iter);
+var_t*      var_iter_val(const var_iter_t* iter);
+size_t      var_iter_next_n(var_iter_t* iter, var_t** buf, var_t** vals, size_t n);
+
+// dict
+var_t*      var_dict_get(const var_t* var, const var_t* key);
+var_t*      var_dict_get_hashed(const var_t* var, const var_t* key, uint64_t hash);
+var_t*      var_dict_get_retain(const var_t* var, const var_t* key);
+bool        var_dict_contains(const var_t* var, const var_t* key);
+bool        var_dict_contains_hashed(const var_t* var, const var_t* key, uint64_t hash);
+void        var_dict_put(var_t* var, var_t* key, var_t* val);
+void        var_dict_put_hashed(var_t* var, var_t* key, var_t* val, uint64_t hash);
+bool        var_dict_remove(var_t* var, const var_t* key);
+bool        var_dict_remove_hashed(var_t* var, const var_t* key, uint64_t hash);
+void        var_dict_incremental(var_t* var, bool enable);
+uint64_t    var_dict_scan(const var_t* var, uint64_t cursor, var_dict_scan_fn fn, void* arg);
+
+// intern
+var_t*      var_intern(const char* str, size_t len);
+void        var_intern_clear(void);
+
+// pool
+void        var_pool_start(size_t threads);
+void        var_pool_stop(void);
+
+// memory
+size_t          var_memory_usage(const var_t* var, var_memory_t* usage);
+var_budget_t*   var_budget_use(var_budget_t* budget);
+
+// deferred delete
+void        var_delete_deferred(var_t* var);
+void        var_defer_config(size_t depth, size_t batch, var_defer_full_t full);
+void        var_defer_drain(void);
+
+// serialization
+void            var_buf_init(var_buf_t* buf);
+void            var_buf_free(var_buf_t* buf);
+void            var_serialize(const var_t* var, var_buf_t* buf);
+bool            var_serialize_file(const var_t* var, FILE* fp);
+var_t*          var_deserialize(const void* data, size_t len, size_t* used);
+var_t*          var_deserialize_file(FILE* fp);
+
+// view
+void            var_serialize_indexed(const var_t* var, var_buf_t* buf);
+bool            var_view_init(var_view_t* view, const void* data, size_t len);
+var_type_t      var_view_type(const var_view_t* view);
+size_t          var_view_len(const var_view_t* view);
+bool            var_view_int(const var_view_t* view, int64_t* i);
+bool            var_view_uint(const var_view_t* view, uint64_t* u);
+bool            var_view_float(const var_view_t* view, double* f);
+bool            var_view_str(const var_view_t* view, const char** str, size_t* len);
+bool            var_view_at(const var_view_t* view, size_t index, var_view_t* elem);
+bool            var_view_dict_at(const var_view_t* view, size_t index, var_view_t* key, var_view_t* val);
+bool            var_view_dict_get(const var_view_t* view, const var_t* key, var_view_t* val);
+bool            var_view_dict_get_str(const var_view_t* view, const char* key, var_view_t* val);
+bool            var_view_get(const var_view_t* view, const char* format, ...);
+var_t*          var_view_materialize(const var_view_t* view);
+const void*     var_map_file(const char* path, size_t* len);
+void            var_unmap_file(const void* data, size_t len);
+
+// json
+var_t*          var_from_json(const char* json, size_t len);
+bool            var_to_json(const var_t* var, var_buf_t* buf, uint32_t flag);
+bool            var_to_json_stream(const var_t* var, var_json_fn fn, void* arg, uint32_t flag);
+bool            var_to_json_file(const var_t* var, FILE* fp, uint32_t flag);
+var_json_reader_t*  var_json_reader_new(var_json_event_fn fn, void* arg);
+var_json_reader_t*  var_json_reader_new_record(var_json_record_fn fn, void* arg);
+void            var_json_reader_delete(var_json_reader_t* reader);
+bool            var_json_reader_feed(var_json_reader_t* reader, const char* data, size_t len);
+bool            var_json_reader_end(var_json_reader_t* reader);
+bool            var_json_read_file(FILE* fp, var_json_record_fn fn, void* arg);
+
+// format plan
+var_plan_t*     var_format_compile(const char* format);
+void            var_plan_delete(var_plan_t* plan);
+var_t*          var_news_plan(const var_plan_t* plan, ...);
+void            var_get_plan(const var_t* var, const var_plan_t* plan, ...);
+void            var_set_plan(var_t* var, const var_plan_t* plan, ...);
+
+// arena
+var_arena_t*    var_arena_new(size_t block_size);
+void            var_arena_reset(var_arena_t* arena);
+void            var_arena_delete(var_arena_t* arena);
+var_arena_t*    var_arena_use(var_arena_t* arena);
 
 #endif  // __TYPE_H__
 
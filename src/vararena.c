@@ -0,0 +1,118 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+_Thread_local var_arena_t* var_arena_curr = NULL;
+
+// id of the last arena, see `var_arena_of`
+static atomic_uint_least32_t var_arena_last = 0;
+
+
+// round `size` up to arena alignment
+static inline size_t var_arena_align(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+
+static var_arena_block_t* var_arena_block_new(size_t size) {
+    var_arena_block_t* res = malloc(sizeof (var_arena_block_t) + size);
+    MEM_CHECK(res);
+    res->next = NULL;
+    res->size = size;
+    return res;
+}
+
+
+/*
+ * an arena hands out memory for whole `var_t` trees.
+ * every `var_t` created while the arena is in use (see `var_arena_use`) lives inside of it,
+ * and is released all at once by `var_arena_reset` or `var_arena_delete`.
+ * `var_delete` on these `var_t` does nothing.
+ * they can only grow, or take boxed scalars into their slots, while their own arena is in use, see `var_arena_of`.
+ *
+ * @param   block_size  size of each memory block, 0 for default
+ * @return              a new arena
+ */
+var_arena_t* var_arena_new(size_t block_size) {
+    if (block_size == 0) block_size = ARENA_SIZE;
+    block_size = var_arena_align(block_size);
+
+    var_arena_t* res = malloc(sizeof (var_arena_t));
+    MEM_CHECK(res);
+    res->id         = (atomic_fetch_add_explicit(&var_arena_last, 1, memory_order_relaxed) + 1) & VAR_ARENA_IDS;
+    res->block_size = block_size;
+    res->used       = 0;
+    res->head       = var_arena_block_new(block_size);
+    res->curr       = res->head;
+    return res;
+}
+
+
+/*
+ * invalidate every `var_t` inside of the arena in O(1).
+ * blocks are kept and reused by later allocations.
+ *
+ * @param   arena   the arena to reset
+ */
+void var_arena_reset(var_arena_t* arena) {
+    arena->curr = arena->head;
+    arena->used = 0;
+}
+
+
+/*
+ * free the arena and every `var_t` inside of it
+ *
+ * @param   arena   the arena to free
+ */
+void var_arena_delete(var_arena_t* arena) {
+    if (var_arena_curr == arena) var_arena_curr = NULL;
+
+    var_arena_block_t* curr = arena->head;
+    var_arena_block_t* next;
+    while (curr != NULL) {
+        next = curr->next;
+        free(curr);
+        curr = next;
+    }
+    free(arena);
+}
+
+
+/*
+ * make constructors of the calling thread allocate from `arena`.
+ *
+ * @param   arena   the arena to use, `NULL` to go back to heap allocation
+ * @return          the arena that was in use before
+ */
+var_arena_t* var_arena_use(var_arena_t* arena) {
+    var_arena_t* prev = var_arena_curr;
+    var_arena_curr = arena;
+    return prev;
+}
+
+
+void* var_arena_alloc(var_arena_t* arena, size_t size) {
+    size = var_arena_align(size);
+
+    // fast path, bump the pointer
+    if (arena->used + size <= arena->curr->size) {
+        void* res = arena->curr->mem + arena->used;
+        arena->used += size;
+        return res;
+    }
+
+    // reuse the next block kept by `var_arena_reset` if it is large enough
+    var_arena_block_t* next = arena->curr->next;
+    if (next == NULL || next->size < size) {
+        var_arena_block_t* block = var_arena_block_new(size > arena->block_size ? size : arena->block_size);
+        block->next = next;
+        arena->curr->next = block;
+        next = block;
+    }
+
+    arena->curr = next;
+    arena->used = size;
+    return next->mem;
+}
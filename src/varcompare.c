@@ -0,0 +1,495 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * values of different types are ordered nil < numbers < string < array < list < dict.
+ * numbers of any type are ordered by value, nan after all of them,
+ * equal values by type, int < uint < float, and -0.0 < 0.0.
+ * strings are ordered by bytes, arrays and lists by elements, then by length,
+ * dicts by length, then by their pairs in the order of keys.
+ * `var_compare` is 0 only for values that `var_equal`, floats are equal only if their bits are.
+ */
+
+
+#define VAR_CMP(a, b) (((a) > (b)) - ((a) < (b)))
+
+
+// equality
+
+static bool var_equal_seq(var_t* const* a, var_t* const* b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (var_equal(a[i], b[i]) == false) return false;
+    }
+    return true;
+}
+
+
+/*
+ * deep equality, values of different types are never equal, not even numbers.
+ * cached hashes, shared payloads and lengths are checked before elements.
+ *
+ * @param   a       a `var_t*`
+ * @param   b       a `var_t*`
+ * @return          if `a` and `b` are equal
+ */
+bool var_equal(const var_t* a, const var_t* b) {
+    if (a == b) return true;
+
+    var_type_t t = var_typeof(a);
+    if (t != var_typeof(b)) return false;
+
+    uint64_t ha, hb;
+    switch (t) {
+        case VAR_NIL: return true;
+        case VAR_INT: return var_int_of(a) == var_int_of(b);
+        case VAR_UINT: return var_uint_of(a) == var_uint_of(b);
+        case VAR_FLOAT: {
+            double fa = var_float_of(a);
+            double fb = var_float_of(b);
+            return memcmp(&fa, &fb, sizeof (double)) == 0;
+        }
+
+        case VAR_STRING: {
+            size_t len = var_str_len(a);
+            if (len != var_str_len(b)) return false;
+            if (len < SSO_SIZE) return memcmp(a->data.ss, b->data.ss, len) == 0;
+            if (a->data.s == b->data.s) return true;
+            if (var_hash_cached(a, &ha) && var_hash_cached(b, &hb) && ha != hb) return false;
+            return memcmp(a->data.s->str, b->data.s->str, len) == 0;
+        }
+
+        case VAR_ARRAY: {
+            var_array_t* x = a->data.a;
+            var_array_t* y = b->data.a;
+            if (x == y) return true;
+            if (x->len != y->len) return false;
+            if (var_hash_cached(a, &ha) && var_hash_cached(b, &hb) && ha != hb) return false;
+            return var_equal_seq(x->av, y->av, x->len);
+        }
+
+        case VAR_LIST: {
+            var_list_t* x = a->data.l;
+            var_list_t* y = b->data.l;
+            if (x == y) return true;
+            if (x->len != y->len) return false;
+            return var_equal_seq(x->lv, y->lv, x->len);
+        }
+
+        case VAR_DICT: {
+            var_dict_t* x = a->data.d;
+            var_dict_t* y = b->data.d;
+            if (x == y) return true;
+            if (var_dict_len(x) != var_dict_len(y)) return false;
+
+            // keys of both are hashed by `var_hash`, the hash in the slot of `a` finds the key in `b`
+            size_t table = 0, pos = 0;
+            for (var_dict_slot_t* slot; (slot = var_dict_next(x, &table, &pos)) != NULL;) {
+                var_dict_slot_t* other = var_dict_find(y, slot->key, slot->hash);
+                if (other == NULL || var_equal(slot->val, other->val) == false) return false;
+            }
+            return true;
+        }
+
+        default: {
+            ERRO("corrupted var");
+        }
+    }
+}
+
+
+// ordering
+
+static inline int var_compare_rank(var_type_t t) {
+    switch (t) {
+        case VAR_NIL: return 0;
+        case VAR_INT: return 1;
+        case VAR_UINT: return 2;
+        case VAR_FLOAT: return 3;
+        case VAR_STRING: return 4;
+        case VAR_ARRAY: return 5;
+        case VAR_LIST: return 6;
+        case VAR_DICT: return 7;
+        default: {
+            ERRO("corrupted var");
+        }
+    }
+}
+
+
+static inline bool var_compare_is_number(var_type_t t) {
+    return t == VAR_INT || t == VAR_UINT || t == VAR_FLOAT;
+}
+
+
+// sign of `i - f`, `f` is not nan
+static inline int var_compare_int_float(int64_t i, double f) {
+    if (f < -9223372036854775808.0) return 1;
+    if (f >= 9223372036854775808.0) return -1;
+
+    // `f` truncated is exact in this range, so is its fraction
+    int64_t t = (int64_t) f;
+    if (i != t) return i < t ? -1 : 1;
+    double frac = f - (double) t;
+    return frac > 0 ? -1 : frac < 0 ? 1 : 0;
+}
+
+
+// sign of `u - f`, `f` is not nan
+static inline int var_compare_uint_float(uint64_t u, double f) {
+    if (f < 0) return 1;
+    if (f >= 18446744073709551616.0) return -1;
+
+    uint64_t t = (uint64_t) f;
+    if (u != t) return u < t ? -1 : 1;
+    double frac = f - (double) t;
+    return frac > 0 ? -1 : 0;
+}
+
+
+static int var_compare_float(double a, double b) {
+    uint64_t ba, bb;
+    memcpy(&ba, &a, sizeof (double));
+    memcpy(&bb, &b, sizeof (double));
+
+    bool na = a != a, nb = b != b;
+    if (na || nb) {
+        if (na && nb) return VAR_CMP(ba, bb);
+        return na ? 1 : -1;
+    }
+    if (a != b) return a < b ? -1 : 1;
+
+    // 0.0 and -0.0
+    return VAR_CMP(bb >> 63, ba >> 63);
+}
+
+
+// `a` and `b` are numbers of different types, the rank of `a` is the lower one
+static int var_compare_mixed(const var_t* a, const var_t* b) {
+    var_type_t ta = var_typeof(a);
+    var_type_t tb = var_typeof(b);
+    int res;
+    if (tb == VAR_FLOAT) {
+        double f = var_float_of(b);
+        if (f != f) return -1;
+        res = ta == VAR_INT
+            ? var_compare_int_float(var_int_of(a), f)
+            : var_compare_uint_float(var_uint_of(a), f);
+    } else {
+        int64_t i = var_int_of(a);
+        res = i < 0 ? -1 : VAR_CMP((uint64_t) i, var_uint_of(b));
+    }
+    return res != 0 ? res : -1;
+}
+
+
+static int var_compare_seq(var_t* const* a, size_t la, var_t* const* b, size_t lb) {
+    size_t len = la < lb ? la : lb;
+    for (size_t i = 0; i < len; i++) {
+        int res = var_compare(a[i], b[i]);
+        if (res != 0) return res;
+    }
+    return VAR_CMP(la, lb);
+}
+
+
+static int var_compare_slot(const void* a, const void* b) {
+    const var_dict_slot_t* x = *(const var_dict_slot_t* const*) a;
+    const var_dict_slot_t* y = *(const var_dict_slot_t* const*) b;
+    return var_compare(x->key, y->key);
+}
+
+
+// slots of `dict` in the order of keys, `buf` is used if it has room for them
+static var_dict_slot_t** var_compare_sorted(const var_dict_t* dict, var_dict_slot_t** buf, size_t cap) {
+    size_t len = var_dict_len(dict);
+    var_dict_slot_t** res = len <= cap ? buf : malloc(sizeof (var_dict_slot_t*) * len);
+    MEM_CHECK(res);
+
+    size_t n = 0, table = 0, pos = 0;
+    for (var_dict_slot_t* slot; (slot = var_dict_next(dict, &table, &pos)) != NULL;) {
+        res[n++] = slot;
+    }
+    qsort(res, n, sizeof (var_dict_slot_t*), var_compare_slot);
+    return res;
+}
+
+
+static int var_compare_dict(const var_dict_t* x, const var_dict_t* y) {
+    if (x == y) return 0;
+    size_t len = var_dict_len(x);
+    if (len != var_dict_len(y)) return VAR_CMP(len, var_dict_len(y));
+
+    var_dict_slot_t* buf_x[DICT_SIZE];
+    var_dict_slot_t* buf_y[DICT_SIZE];
+    var_dict_slot_t** sx = var_compare_sorted(x, buf_x, DICT_SIZE);
+    var_dict_slot_t** sy = var_compare_sorted(y, buf_y, DICT_SIZE);
+
+    int res = 0;
+    for (size_t i = 0; i < len && res == 0; i++) {
+        res = var_compare(sx[i]->key, sy[i]->key);
+        if (res == 0) res = var_compare(sx[i]->val, sy[i]->val);
+    }
+
+    if (sx != buf_x) free(sx);
+    if (sy != buf_y) free(sy);
+    return res;
+}
+
+
+/*
+ * total order of all `var_t`, see the top of `varcompare.c`.
+ * dicts are compared by sorting their keys, which is O(n log n).
+ *
+ * @param   a       a `var_t*`
+ * @param   b       a `var_t*`
+ * @return          negative if `a` is before `b`, positive if after, 0 if they are equal
+ */
+int var_compare(const var_t* a, const var_t* b) {
+    if (a == b) return 0;
+
+    var_type_t ta = var_typeof(a);
+    var_type_t tb = var_typeof(b);
+    if (ta != tb) {
+        if (var_compare_is_number(ta) && var_compare_is_number(tb)) {
+            return var_compare_rank(ta) < var_compare_rank(tb)
+                ? var_compare_mixed(a, b)
+                : -var_compare_mixed(b, a);
+        }
+        return VAR_CMP(var_compare_rank(ta), var_compare_rank(tb));
+    }
+
+    switch (ta) {
+        case VAR_NIL: return 0;
+        case VAR_INT: return VAR_CMP(var_int_of(a), var_int_of(b));
+        case VAR_UINT: return VAR_CMP(var_uint_of(a), var_uint_of(b));
+        case VAR_FLOAT: return var_compare_float(var_float_of(a), var_float_of(b));
+
+        case VAR_STRING: {
+            size_t la = var_str_len(a);
+            size_t lb = var_str_len(b);
+            int res = memcmp(var_str(a), var_str(b), la < lb ? la : lb);
+            return res != 0 ? VAR_CMP(res, 0) : VAR_CMP(la, lb);
+        }
+
+        case VAR_ARRAY: {
+            var_array_t* x = a->data.a;
+            var_array_t* y = b->data.a;
+            return x == y ? 0 : var_compare_seq(x->av, x->len, y->av, y->len);
+        }
+
+        case VAR_LIST: {
+            var_list_t* x = a->data.l;
+            var_list_t* y = b->data.l;
+            return x == y ? 0 : var_compare_seq(x->lv, x->len, y->lv, y->len);
+        }
+
+        case VAR_DICT: return var_compare_dict(a->data.d, b->data.d);
+
+        default: {
+            ERRO("corrupted var");
+        }
+    }
+}
+
+
+/*
+ * sort is a stable merge sort of runs sorted by insertion.
+ * large inputs are split in halves that are sorted on the pool, see `var_pool_fork`,
+ * and merged in parallel too: the middle of the longer half is found in the other one by binary search,
+ * which splits the merge into two independent ones.
+ */
+
+
+// `var_compare` with immediate integers inline, their encoding keeps the order of the values
+static inline int var_sort_compare(const var_t* a, const var_t* b) {
+    if ((uintptr_t) a & (uintptr_t) b & 0x1) return VAR_CMP((intptr_t) a, (intptr_t) b);
+    return var_compare(a, b);
+}
+
+
+static void var_sort_insertion(var_t** a, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        var_t* x = a[i];
+        size_t j = i;
+        for (; j > 0 && var_sort_compare(a[j - 1], x) > 0; j--) a[j] = a[j - 1];
+        a[j] = x;
+    }
+}
+
+
+// stable, ties are taken from `l`
+static void var_sort_merge(var_t* const* l, size_t nl, var_t* const* r, size_t nr, var_t** out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < nl && j < nr) {
+        out[k++] = var_sort_compare(r[j], l[i]) < 0 ? r[j++] : l[i++];
+    }
+    memcpy(out + k, l + i, sizeof (var_t*) * (nl - i));
+    memcpy(out + k + nl - i, r + j, sizeof (var_t*) * (nr - j));
+}
+
+
+// bottom up, passes go back and forth between `a` and `tmp`
+static void var_sort_serial(var_t** a, var_t** tmp, size_t n) {
+    for (size_t i = 0; i < n; i += SORT_RUN) {
+        var_sort_insertion(a + i, n - i < SORT_RUN ? n - i : SORT_RUN);
+    }
+
+    var_t** src = a;
+    var_t** dst = tmp;
+    for (size_t width = SORT_RUN; width < n; width *= 2) {
+        for (size_t i = 0; i < n; i += 2 * width) {
+            size_t mid = i + width < n ? i + width : n;
+            size_t end = i + 2 * width < n ? i + 2 * width : n;
+            var_sort_merge(src + i, mid - i, src + mid, end - mid, dst + i);
+        }
+        var_t** swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != a) memcpy(a, src, sizeof (var_t*) * n);
+}
+
+
+// first of `n` at `a` that is not before `x`, or after `x` if `upper`
+static size_t var_sort_search(var_t* const* a, size_t n, const var_t* x, bool upper) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int res = var_sort_compare(a[mid], x);
+        if (res < 0 || (upper && res == 0)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+
+typedef struct var_sort_task {
+    var_t**     a;      // sort: the input, merge: left half
+    var_t**     b;      // sort: the buffer, merge: right half
+    var_t**     out;    // merge only
+    size_t      na;
+    size_t      nb;
+    size_t      threads;
+} var_sort_task_t;
+
+
+static void var_sort_parallel(var_sort_task_t* task);
+static void var_merge_parallel(var_sort_task_t* task);
+
+
+static void var_sort_run(void* arg, size_t begin, size_t end) {
+    (void) begin;
+    (void) end;
+    var_sort_parallel(arg);
+}
+
+
+static void var_merge_run(void* arg, size_t begin, size_t end) {
+    (void) begin;
+    (void) end;
+    var_merge_parallel(arg);
+}
+
+
+static void var_merge_parallel(var_sort_task_t* task) {
+    var_t** l = task->a;
+    var_t** r = task->b;
+    size_t nl = task->na, nr = task->nb;
+    if (task->threads < 2 || nl + nr < SORT_PARALLEL) {
+        var_sort_merge(l, nl, r, nr, task->out);
+        return;
+    }
+
+    // everything before the split is before everything after it, ties stay in order
+    size_t ml, mr;
+    if (nl >= nr) {
+        ml = nl / 2;
+        mr = var_sort_search(r, nr, l[ml], false);
+    } else {
+        mr = nr / 2;
+        ml = var_sort_search(l, nl, r[mr], true);
+    }
+
+    size_t half = task->threads / 2;
+    var_sort_task_t left = { .a = l, .b = r, .out = task->out, .na = ml, .nb = mr, .threads = half };
+    var_sort_task_t right = {
+        .a = l + ml, .b = r + mr, .out = task->out + ml + mr,
+        .na = nl - ml, .nb = nr - mr, .threads = task->threads - half,
+    };
+    var_pool_fork(var_merge_run, &left, &right);
+}
+
+
+static void var_sort_parallel(var_sort_task_t* task) {
+    var_t** a = task->a;
+    var_t** tmp = task->b;
+    size_t n = task->na;
+    if (task->threads < 2 || n < SORT_PARALLEL) {
+        var_sort_serial(a, tmp, n);
+        return;
+    }
+
+    size_t h = n / 2;
+    size_t half = task->threads / 2;
+    var_sort_task_t left = { .a = a, .b = tmp, .na = h, .threads = half };
+    var_sort_task_t right = { .a = a + h, .b = tmp + h, .na = n - h, .threads = task->threads - half };
+    var_pool_fork(var_sort_run, &left, &right);
+
+    var_sort_task_t merge = { .a = a, .b = a + h, .out = tmp, .na = h, .nb = n - h, .threads = task->threads };
+    var_merge_parallel(&merge);
+    memcpy(a, tmp, sizeof (var_t*) * n);
+}
+
+
+// threads of the pool and the calling one, 1 without a running pool
+static size_t var_sort_threads(void) {
+    size_t n = atomic_load_explicit(&var_pool_threads, memory_order_relaxed) + 1;
+    return n < SORT_THREADS ? n : SORT_THREADS;
+}
+
+
+static void var_sort(var_t** elem, size_t n) {
+    if (n < 2) return;
+    if (n <= SORT_RUN) {
+        var_sort_insertion(elem, n);
+        return;
+    }
+
+    var_t** tmp = malloc(sizeof (var_t*) * n);
+    MEM_CHECK(tmp);
+    var_sort_task_t task = { .a = elem, .b = tmp, .na = n, .threads = n < SORT_PARALLEL ? 1 : var_sort_threads() };
+    var_sort_parallel(&task);
+    free(tmp);
+}
+
+
+/*
+ * sort the list in place by `var_compare`, equal elements keep their order.
+ * lists of `SORT_PARALLEL` elements or more are sorted by the pool if it runs, see `var_pool_start`,
+ * elements must not be changed by other threads meanwhile.
+ *
+ * @param   var     a `var_t*` of type `VAR_LIST`
+ */
+void var_list_sort(var_t* var) {
+    if (var_typeof(var) != VAR_LIST) {
+        ERRO("expected type `VAR_LIST`");
+    }
+    var_unshare(var);
+    var_sort(var->data.l->lv, var->data.l->len);
+}
+
+
+/*
+ * sort the array in place by `var_compare`, see `var_list_sort`
+ *
+ * @param   var     a `var_t*` of type `VAR_ARRAY`
+ */
+void var_array_sort(var_t* var) {
+    if (var_typeof(var) != VAR_ARRAY) {
+        ERRO("expected type `VAR_ARRAY`");
+    }
+    var_unshare(var);
+    var_sort(var->data.a->av, var->data.a->len);
+}
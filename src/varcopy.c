@@ -0,0 +1,331 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * `var_copy` measures the whole tree first, then builds the copy inside of one block.
+ * every allocation in the block follows a header that points to the block,
+ * the block counts them and is freed with the last one, so nodes of a copy are deleted one by one
+ * like any other `var_t`, and children taken out of a copy outlive its root.
+ * memory that a copy allocates later, as it grows or is unshared, is on the heap with a `NULL` header.
+ */
+
+
+static _Thread_local var_block_t* var_block_curr = NULL;  // block of the copy being built
+
+
+// memory of a `var_t` with `VAR_FLAG_BLOCK`, from the block being built if it has room
+void* var_block_alloc(size_t size) {
+    var_block_t* block = var_block_curr;
+    unsigned char* res;
+    size_t need = (BLOCK_HEAD + size + BLOCK_ALIGN - 1) & ~(size_t) (BLOCK_ALIGN - 1);
+    if (block != NULL && need <= block->size - block->used) {
+        res = block->mem + block->used;
+        block->used += need;
+        var_ref_inc(&block->ref);
+    } else {
+        block = NULL;
+        res = malloc(BLOCK_HEAD + size);
+        if (res == NULL) return NULL;
+    }
+    memcpy(res, &block, sizeof (var_block_t*));
+    return res + BLOCK_HEAD;
+}
+
+
+static var_block_t* var_block_of(void* ptr) {
+    var_block_t* res;
+    memcpy(&res, (unsigned char*) ptr - BLOCK_HEAD, sizeof (var_block_t*));
+    return res;
+}
+
+
+void var_block_free(void* ptr) {
+    var_block_t* block = var_block_of(ptr);
+    if (block == NULL) {
+        free((unsigned char*) ptr - BLOCK_HEAD);
+    } else if (var_ref_dec(&block->ref)) {
+        free(block);
+    }
+}
+
+
+// memory inside of a block never grows in place, it moves to the heap
+void* var_block_realloc(void* ptr, size_t old_size, size_t new_size) {
+    if (var_block_of(ptr) == NULL) {
+        unsigned char* res = realloc((unsigned char*) ptr - BLOCK_HEAD, BLOCK_HEAD + new_size);
+        return res == NULL ? NULL : res + BLOCK_HEAD;
+    }
+    if (new_size <= old_size) return ptr;
+
+    void* res = var_block_alloc(new_size);
+    if (res == NULL) return NULL;
+    memcpy(res, ptr, old_size);
+    var_block_free(ptr);
+    return res;
+}
+
+
+// bytes of block memory of one allocation
+static inline size_t var_copy_align(size_t size) {
+    return (BLOCK_HEAD + size + BLOCK_ALIGN - 1) & ~(size_t) (BLOCK_ALIGN - 1);
+}
+
+
+// bytes taken by the allocation `ptr` of `size` bytes with its header and padding,
+// the first allocation of a block also takes the `var_block_t` of it, see `var_memory_usage`
+size_t var_block_usage(const void* ptr, size_t size) {
+    var_block_t* block = var_block_of((void*) ptr);
+    if (block == NULL) return BLOCK_HEAD + size;
+
+    size_t res = var_copy_align(size);
+    if ((const unsigned char*) ptr - BLOCK_HEAD == block->mem) res += sizeof (var_block_t);
+    return res;
+}
+
+
+// a sharded dict keeps its shards, unless it is copied into an arena, see `var_new_dict_sharded`
+static inline bool var_copy_sharded(const var_dict_t* dict) {
+    return dict->shard != NULL && var_arena_curr == NULL;
+}
+
+
+static size_t var_copy_size(const var_t* var);
+
+// bytes of block memory the copy of `dict` allocates as a dict that is not sharded
+static size_t var_copy_dict_size(const var_dict_t* dict) {
+    size_t res = var_copy_align(sizeof (var_dict_t));
+    size_t table = var_dict_table_size(var_dict_len(dict));
+    if (table > 0) res += var_copy_align(table);
+
+    size_t t = 0, pos = 0;
+    for (var_dict_slot_t* slot; (slot = var_dict_next(dict, &t, &pos)) != NULL;) {
+        res += var_copy_size(slot->key);
+        res += var_copy_size(slot->val);
+    }
+    return res;
+}
+
+
+// bytes of block memory the copy of `var` allocates
+static size_t var_copy_size(const var_t* var) {
+    if (var_is_imm(var)) return 0;
+
+    size_t res = var_copy_align(sizeof (var_t));
+    switch (var->type) {
+        case VAR_STRING: {
+            size_t len = var_str_len(var);
+            if (len >= SSO_SIZE) {
+                res += var_copy_align(sizeof (var_string_t) + sizeof (char) * (len + 1));
+            }
+        }
+        break;
+
+        case VAR_ARRAY: {
+            var_array_t* arr = var->data.a;
+            res += var_copy_align(sizeof (var_array_t) + sizeof (var_t*) * arr->len);
+            for (size_t i = 0; i < arr->len; i++) {
+                res += var_copy_size(arr->av[i]);
+            }
+        }
+        break;
+
+        case VAR_LIST: {
+            var_list_t* list = var->data.l;
+            res += var_copy_align(sizeof (var_list_t));
+            if (list->len > 0) {
+                res += var_copy_align(sizeof (var_t*) * list->len);
+            }
+            for (size_t i = 0; i < list->len; i++) {
+                res += var_copy_size(list->lv[i]);
+            }
+        }
+        break;
+
+        case VAR_DICT: {
+            var_dict_t* dict = var->data.d;
+            if (var_copy_sharded(dict) == false) {
+                res += var_copy_dict_size(dict);
+                break;
+            }
+            res += var_copy_align(sizeof (var_dict_t) + DICT_LINE + sizeof (var_dict_shard_t) * dict->shards);
+            for (size_t i = 0; i < dict->shards; i++) {
+                res += var_copy_dict_size(dict->shard[i].var.data.d);
+            }
+        }
+        break;
+
+        default: break;
+    }
+    return res;
+}
+
+
+// a new `var_t` of the copy, inside of the block being built if there is one
+static var_t* var_copy_box(var_type_t t) {
+    if (var_block_curr == NULL) return var_box(t);
+
+    var_budget_charge(sizeof (var_t));
+    var_t* res = var_block_alloc(sizeof (var_t));
+    MEM_CHECK(res);
+    res->type = t;
+    res->flag = VAR_FLAG_BLOCK | VAR_FLAG_NODE;
+    return res;
+}
+
+
+static var_t* var_copy_build(const var_t* var);
+
+// copy the elements of `dict` into a new dict of `var` that is not sharded
+static void var_copy_dict(var_t* var, const var_dict_t* dict) {
+    var_dict_init(var, var_dict_len(dict));
+
+    // presized, keys are already unique
+    bool found;
+    size_t t = 0, pos = 0;
+    for (var_dict_slot_t* slot; (slot = var_dict_next(dict, &t, &pos)) != NULL;) {
+        var_dict_slot_t* dst = var_dict_emplace(var, slot->key, slot->hash, &found);
+        dst->key = var_copy_build(slot->key);
+        dst->val = var_copy_build(slot->val);
+    }
+    var->data.d->incremental = dict->incremental;
+}
+
+
+// deep copy, allocations go to the block being built, or else to the arena in use
+static var_t* var_copy_build(const var_t* var) {
+    if (var_is_imm(var)) return (var_t*) var;
+
+    var_t* res = var_copy_box(var->type);
+    switch (var->type) {
+        case VAR_NIL: break;
+
+        case VAR_INT:
+        case VAR_UINT:
+        case VAR_FLOAT: {
+            memcpy(&res->data, &var->data, sizeof (res->data));
+        }
+        break;
+
+        case VAR_STRING: {
+            size_t len = var_str_len(var);
+            if (len < SSO_SIZE) {
+                var_str_short(res, len);
+            } else {
+                res->data.s = var_alloc_for(res, sizeof (var_string_t) + sizeof (char) * (len + 1));
+                MEM_CHECK(res->data.s);
+                var_ref_init(&res->data.s->ref);
+                var_hash_cache_init(&res->data.s->hash);
+                res->data.s->len = len;
+                res->data.s->str[len] = '\0';
+            }
+            memcpy(var_str(res), var_str(var), len);
+        }
+        break;
+
+        case VAR_ARRAY: {
+            var_array_t* arr = var->data.a;
+            res->data.a = var_alloc_for(res, sizeof (var_array_t) + sizeof (var_t*) * arr->len);
+            MEM_CHECK(res->data.a);
+            var_ref_init(&res->data.a->ref);
+            var_hash_cache_init(&res->data.a->hash);
+            var_hash_cache_init(&res->data.a->seen);
+            res->data.a->len = arr->len;
+            for (size_t i = 0; i < arr->len; i++) {
+                res->data.a->av[i] = var_copy_build(arr->av[i]);
+            }
+        }
+        break;
+
+        case VAR_LIST: {
+            var_list_t* list = var->data.l;
+            var_list_init(res, list->len);
+            for (size_t i = 0; i < list->len; i++) {
+                res->data.l->lv[i] = var_copy_build(list->lv[i]);
+            }
+            res->data.l->len = list->len;
+        }
+        break;
+
+        case VAR_DICT: {
+            var_dict_t* dict = var->data.d;
+            if (var_copy_sharded(dict) == false) {
+                var_copy_dict(res, dict);
+                break;
+            }
+            // the shard of each element is the same as in `dict`
+            var_dict_shard_init(res, dict->shards);
+            res->data.d->incremental = dict->incremental;
+            for (size_t i = 0; i < dict->shards; i++) {
+                var_copy_dict(&res->data.d->shard[i].var, dict->shard[i].var.data.d);
+            }
+        }
+        break;
+
+        default: {
+            ERRO("corrupted var");
+        }
+    }
+    return res;
+}
+
+
+/*
+ * deep copy of `var` in a single allocation.
+ * the copy is an ordinary `var_t`, it is deleted, changed and retained as usual,
+ * its block is freed once nothing inside of it is left.
+ * if an arena is in use, the copy is made inside of that arena instead.
+ * a sharded dict is copied with as many shards, but inside of an arena it becomes a dict that is not sharded.
+ *
+ * @param   var     the `var_t*` to copy
+ * @return          a new `var_t*` equal to `var`, `NULL` over the budget in use
+ */
+var_t* var_copy(const var_t* var) {
+    if (var_is_imm(var)) return (var_t*) var;
+
+    // the size in a block is a little more than the copy takes in an arena
+    if (var_arena_curr != NULL) {
+        if (var_budget_curr != NULL && var_budget_over(var_copy_size(var))) return NULL;
+        return var_copy_build(var);
+    }
+
+    // scalars and short strings do not have anything to put in a block
+    switch (var->type) {
+        case VAR_STRING: {
+            if (var_str_len(var) >= SSO_SIZE) break;
+            if (var_budget_over(sizeof (var_t))) return NULL;
+            return var_copy_build(var);
+        }
+
+        case VAR_ARRAY:
+        case VAR_LIST:
+        case VAR_DICT: break;
+
+        default: {
+            if (var_budget_over(sizeof (var_t))) return NULL;
+            return var_copy_build(var);
+        }
+    }
+
+    size_t size = var_copy_size(var);
+    if (var_budget_over(sizeof (var_block_t) + size)) return NULL;
+    var_block_t* block = malloc(sizeof (var_block_t) + size);
+    MEM_CHECK(block);
+    var_ref_init(&block->ref);
+    block->size = size;
+    block->used = 0;
+
+    // the block is counted once, not each allocation inside of it
+    var_budget_t* budget = var_budget_curr;
+    var_budget_curr = NULL;
+    var_block_curr = block;
+    var_t* res = var_copy_build(var);
+    var_block_curr = NULL;
+    var_budget_curr = budget;
+    var_budget_charge(sizeof (var_block_t) + size);
+
+    // the reference held while building
+    if (var_ref_dec(&block->ref)) free(block);
+    return res;
+}
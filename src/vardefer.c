@@ -0,0 +1,166 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+#include <threads.h>
+
+
+/*
+ * `var_delete_deferred` pushes a tree onto a lock free stack, linked through the `var_t` itself,
+ * a background thread takes the whole stack at once and frees it in batches.
+ * the reclaimer sleeps while the stack is empty, only the push that finds it empty wakes it up.
+ * threads waiting for room or for `var_defer_drain` are woken after every batch.
+ */
+
+
+static _Atomic (var_t*) var_defer_head = NULL;  // pending trees, linked by `data.defer.next`
+static atomic_size_t    var_defer_pending;      // trees pushed and not yet freed
+static atomic_size_t    var_defer_waiting;      // threads waiting on `var_defer_room`
+static atomic_size_t    var_defer_depth = DEFER_DEPTH;
+static atomic_size_t    var_defer_batch = DEFER_BATCH;
+static atomic_int       var_defer_full  = VAR_DEFER_WAIT;
+
+static mtx_t            var_defer_lock;
+static cnd_t            var_defer_wake;         // the reclaimer waits for trees
+static cnd_t            var_defer_room;         // other threads wait for trees to be freed
+static once_flag        var_defer_once = ONCE_FLAG_INIT;
+
+
+static void var_defer_notify(void) {
+    if (atomic_load(&var_defer_waiting) == 0) return;
+    mtx_lock(&var_defer_lock);
+    cnd_broadcast(&var_defer_room);
+    mtx_unlock(&var_defer_lock);
+}
+
+
+// free the trees of `list`
+static void var_defer_free(var_t* list) {
+    size_t batch = atomic_load_explicit(&var_defer_batch, memory_order_relaxed);
+    size_t n = 0;
+    while (list != NULL) {
+        var_t* next = list->data.defer.next;
+        var_delete(list);
+        list = next;
+        if (++n == batch || list == NULL) {
+            atomic_fetch_sub(&var_defer_pending, n);
+            var_defer_notify();
+            n = 0;
+        }
+    }
+}
+
+
+static int var_defer_reclaim(void* arg) {
+    (void) arg;
+    for (;;) {
+        var_t* list = atomic_exchange_explicit(&var_defer_head, NULL, memory_order_acquire);
+        if (list != NULL) {
+            var_defer_free(list);
+            continue;
+        }
+
+        mtx_lock(&var_defer_lock);
+        while (atomic_load(&var_defer_head) == NULL) {
+            cnd_wait(&var_defer_wake, &var_defer_lock);
+        }
+        mtx_unlock(&var_defer_lock);
+    }
+    return 0;
+}
+
+
+static void var_defer_init(void) {
+    if (mtx_init(&var_defer_lock, mtx_plain) != thrd_success ||
+        cnd_init(&var_defer_wake) != thrd_success ||
+        cnd_init(&var_defer_room) != thrd_success) {
+        ERRO("failed to create mutex");
+    }
+    atomic_init(&var_defer_pending, 0);
+    atomic_init(&var_defer_waiting, 0);
+
+    thrd_t thread;
+    if (thrd_create(&thread, var_defer_reclaim, NULL) != thrd_success) {
+        ERRO("failed to create thread");
+    }
+    thrd_detach(thread);
+}
+
+
+// wait until fewer than `limit` trees are pending
+static void var_defer_wait(size_t limit) {
+    atomic_fetch_add(&var_defer_waiting, 1);
+    mtx_lock(&var_defer_lock);
+    while (atomic_load(&var_defer_pending) > limit) {
+        cnd_wait(&var_defer_room, &var_defer_lock);
+    }
+    mtx_unlock(&var_defer_lock);
+    atomic_fetch_sub(&var_defer_waiting, 1);
+}
+
+
+/*
+ * same as `var_delete`, but the tree is freed later by a background thread.
+ * the caller only links `var` into a queue, in O(1) and without locks, unless the queue is full,
+ * see `var_defer_config`. `var` must not be used afterwards.
+ * build with `TYPE_ATOMIC` if the tree shares payloads with other trees, see `var_retain`.
+ *
+ * @param   var     the `var_t*` to delete
+ */
+void var_delete_deferred(var_t* var) {
+    // nothing but the `var_t` to free, or nothing at all
+    if (var_is_imm(var)) return;
+    if ((var->flag & VAR_FLAG_ARENA) || var_ref_of(var) == NULL) {
+        var_delete(var);
+        return;
+    }
+    call_once(&var_defer_once, var_defer_init);
+
+    size_t depth = atomic_load_explicit(&var_defer_depth, memory_order_relaxed);
+    if (atomic_load_explicit(&var_defer_pending, memory_order_relaxed) >= depth) {
+        if (atomic_load_explicit(&var_defer_full, memory_order_relaxed) == VAR_DEFER_INLINE) {
+            var_delete(var);
+            return;
+        }
+        var_defer_wait(depth - 1);
+    }
+    atomic_fetch_add(&var_defer_pending, 1);
+
+    var_t* head = atomic_load_explicit(&var_defer_head, memory_order_relaxed);
+    do {
+        var->data.defer.next = head;
+    } while (atomic_compare_exchange_weak_explicit(&var_defer_head, &head, var, memory_order_release, memory_order_relaxed) == false);
+
+    if (head == NULL) {
+        mtx_lock(&var_defer_lock);
+        cnd_signal(&var_defer_wake);
+        mtx_unlock(&var_defer_lock);
+    }
+}
+
+
+/*
+ * @param   depth   trees pending at most, 0 for `DEFER_DEPTH`
+ * @param   batch   trees the reclaimer frees before it wakes up waiting threads, 0 for `DEFER_BATCH`
+ * @param   full    what `var_delete_deferred` does while `depth` trees are pending
+ */
+void var_defer_config(size_t depth, size_t batch, var_defer_full_t full) {
+    call_once(&var_defer_once, var_defer_init);
+    atomic_store(&var_defer_depth, depth == 0 ? DEFER_DEPTH : depth);
+    atomic_store(&var_defer_batch, batch == 0 ? DEFER_BATCH : batch);
+    atomic_store(&var_defer_full, full);
+    var_defer_notify();
+}
+
+
+/*
+ * free every pending tree before returning, on the calling thread as much as possible.
+ * for shutdown and tests, trees deferred meanwhile by other threads are waited for as well.
+ */
+void var_defer_drain(void) {
+    call_once(&var_defer_once, var_defer_init);
+    var_defer_free(atomic_exchange_explicit(&var_defer_head, NULL, memory_order_acquire));
+
+    // trees the reclaimer has taken already
+    var_defer_wait(0);
+}
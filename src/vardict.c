@@ -0,0 +1,826 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+#include <threads.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif  // __SSE2__
+
+
+/*
+ * `VAR_DICT` is an open addressing hash table.
+ * each slot has a control byte, slots are probed by groups of `DICT_GROUP`,
+ * control bytes of a group are compared against 7 bits of the hash at once.
+ * only slots whose control byte matches will have their key compared.
+ * the probe sequence visits groups in triangular steps, it stops at the first group with an empty slot.
+ *
+ * a sharded dict splits its elements into independent dicts by hash, each behind its own lock.
+ * the top level `var_dict_t` holds no element, functions below route a hash to its shard.
+ */
+
+
+// bits of the slots in the group at `ctrl` whose control byte is `c`
+static inline uint32_t var_dict_match(const int8_t* ctrl, int8_t c) {
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i*) ctrl);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(c)));
+#else
+    uint32_t res = 0;
+    for (uint32_t i = 0; i < DICT_GROUP; i++) {
+        res |= (uint32_t) (ctrl[i] == c) << i;
+    }
+    return res;
+#endif  // __SSE2__
+}
+
+
+// bits of the slots in the group at `ctrl` that are either `DICT_EMPTY` or `DICT_DELETED`
+static inline uint32_t var_dict_match_free(const int8_t* ctrl) {
+#ifdef __SSE2__
+    // only free slots have the sign bit set
+    __m128i group = _mm_loadu_si128((const __m128i*) ctrl);
+    return (uint32_t) _mm_movemask_epi8(group);
+#else
+    uint32_t res = 0;
+    for (uint32_t i = 0; i < DICT_GROUP; i++) {
+        res |= (uint32_t) (ctrl[i] < 0) << i;
+    }
+    return res;
+#endif  // __SSE2__
+}
+
+
+// spread the bits of `hash`, identity hashes of integers would otherwise share the same group
+static inline uint64_t var_dict_mix(uint64_t hash) {
+    hash *= DICT_RATIO;
+    return hash ^ (hash >> 32);
+}
+
+
+// smallest capacity that holds `size` elements
+static inline size_t var_dict_cap_for(size_t size) {
+    size_t cap = DICT_SIZE;
+    while (cap / 8 * 7 < size) cap *= 2;
+    return cap;
+}
+
+
+// home group of `mix` in a table of `cap` slots
+static inline size_t var_dict_home(uint64_t mix, size_t cap) {
+    return (mix >> 7) & (cap / DICT_GROUP - 1);
+}
+
+
+// index of the first free slot on the probe sequence of `mix`
+static inline size_t var_dict_probe_free(const var_dict_table_t* table, uint64_t mix) {
+    size_t gmask = table->cap / DICT_GROUP - 1;
+    size_t g = var_dict_home(mix, table->cap);
+    for (size_t step = 1; ; g = (g + step++) & gmask) {
+        uint32_t m = var_dict_match_free(table->ctrl + g * DICT_GROUP);
+        if (m != 0) return g * DICT_GROUP + __builtin_ctz(m);
+    }
+}
+
+
+// shard of `hash`, the top bits of the mix, home groups use the low ones
+static inline var_dict_shard_t* var_dict_shard_of(const var_dict_t* dict, uint64_t hash) {
+    return &dict->shard[(var_dict_mix(hash) >> 48) & (dict->shards - 1)];
+}
+
+
+/*
+ * reader writer lock of a shard, readers only take turns with writers.
+ * a writer sets `DICT_WRITER` first, new readers back off, then it waits for the readers inside.
+ */
+static inline void var_dict_read_lock(var_dict_shard_t* shard) {
+    for (;;) {
+        uint32_t s = atomic_fetch_add_explicit(&shard->lock, 1, memory_order_acquire);
+        if ((s & DICT_WRITER) == 0) return;
+        atomic_fetch_sub_explicit(&shard->lock, 1, memory_order_relaxed);
+        while (atomic_load_explicit(&shard->lock, memory_order_relaxed) & DICT_WRITER) thrd_yield();
+    }
+}
+
+
+static inline void var_dict_read_unlock(var_dict_shard_t* shard) {
+    atomic_fetch_sub_explicit(&shard->lock, 1, memory_order_release);
+}
+
+
+static inline void var_dict_write_lock(var_dict_shard_t* shard) {
+    uint32_t s = atomic_load_explicit(&shard->lock, memory_order_relaxed);
+    for (;;) {
+        if (s & DICT_WRITER) {
+            thrd_yield();
+            s = atomic_load_explicit(&shard->lock, memory_order_relaxed);
+        } else if (atomic_compare_exchange_weak_explicit(&shard->lock, &s, s | DICT_WRITER, memory_order_acquire, memory_order_relaxed)) {
+            break;
+        }
+    }
+    while (atomic_load_explicit(&shard->lock, memory_order_acquire) != DICT_WRITER) thrd_yield();
+}
+
+
+static inline void var_dict_write_unlock(var_dict_shard_t* shard) {
+    atomic_fetch_and_explicit(&shard->lock, ~DICT_WRITER, memory_order_release);
+}
+
+
+static var_dict_slot_t* var_dict_table_find(const var_dict_table_t* table, const var_t* key, uint64_t hash, uint64_t mix) {
+    if (table->cap == 0) return NULL;
+
+    int8_t h2       = (int8_t) (mix & 0x7f);
+    size_t gmask    = table->cap / DICT_GROUP - 1;
+    size_t g        = var_dict_home(mix, table->cap);
+
+    for (size_t step = 1; ; g = (g + step++) & gmask) {
+        const int8_t* ctrl = table->ctrl + g * DICT_GROUP;
+        for (uint32_t m = var_dict_match(ctrl, h2); m != 0; m &= m - 1) {
+            var_dict_slot_t* slot = &table->slot[g * DICT_GROUP + __builtin_ctz(m)];
+            if (slot->hash == hash && var_key_equal(slot->key, key)) return slot;
+        }
+        if (var_dict_match(ctrl, DICT_EMPTY) != 0) return NULL;
+    }
+}
+
+
+// allocate an empty table of `cap` slots for `var`
+static void var_dict_alloc(var_t* var, var_dict_table_t* table, size_t cap) {
+    table->ctrl = var_alloc_for(var, sizeof (int8_t) * cap + sizeof (var_dict_slot_t) * cap);
+    MEM_CHECK(table->ctrl);
+    table->slot = (var_dict_slot_t*) (table->ctrl + cap);
+    table->cap  = cap;
+    memset(table->ctrl, DICT_EMPTY, sizeof (int8_t) * cap);
+}
+
+
+// move at most `groups` groups of the old table into the new one
+static void var_dict_migrate(var_t* var, size_t groups) {
+    var_dict_t*         dict    = var->data.d;
+    var_dict_table_t*   old     = &dict->old;
+    if (old->cap == 0) return;
+
+    size_t total = old->cap / DICT_GROUP;
+    if (groups > total - dict->moved) groups = total - dict->moved;
+    size_t end = dict->moved + groups;
+
+    size_t index;
+    for (size_t i = dict->moved * DICT_GROUP; i < end * DICT_GROUP; i++) {
+        if (old->ctrl[i] < 0) continue;
+        index = var_dict_probe_free(&dict->table, var_dict_mix(old->slot[i].hash));
+        if (dict->table.ctrl[index] == DICT_EMPTY) dict->growth--;
+        dict->table.ctrl[index] = old->ctrl[i];
+        dict->table.slot[index] = old->slot[i];
+
+        // not `DICT_EMPTY`, the rest of `old` still needs its probe sequences
+        old->ctrl[i] = DICT_DELETED;
+    }
+    dict->moved = end;
+
+    if (end == total) {
+        var_free(var, old->ctrl);
+        old->cap    = 0;
+        old->ctrl   = NULL;
+        old->slot   = NULL;
+        dict->moved = 0;
+    }
+}
+
+
+// move every element into a new table of `cap` slots, this also drops `DICT_DELETED`
+static void var_dict_resize(var_t* var, size_t cap) {
+    var_dict_t* dict = var->data.d;
+
+    // only one resize at a time
+    var_dict_migrate(var, SIZE_MAX);
+
+    dict->old   = dict->table;
+    dict->moved = 0;
+    var_dict_alloc(var, &dict->table, cap);
+    dict->growth = cap / 8 * 7;
+
+    if (dict->incremental == false) var_dict_migrate(var, SIZE_MAX);
+}
+
+
+/*
+ * allocate the dict of `var`
+ *
+ * @param   var     a `var_t*` of type `VAR_DICT`
+ * @param   size    number of elements to reserve
+ */
+void var_dict_init(var_t* var, size_t size) {
+    var_dict_t* dict = var_alloc_for(var, sizeof (var_dict_t));
+    MEM_CHECK(dict);
+    memset(dict, 0, sizeof (var_dict_t));
+    var_ref_init(&dict->ref);
+    var->data.d = dict;
+
+    // empty dict does not allocate the table
+    if (size > 0) {
+        var_dict_alloc(var, &dict->table, var_dict_cap_for(size));
+        dict->growth = dict->table.cap / 8 * 7;
+    }
+}
+
+
+/*
+ * allocate the dict of `var` as `shards` shards, the dict of each shard is left to the caller.
+ * shards allocate the way `var` does, see `var_copy`
+ *
+ * @param   var     a `var_t*` of type `VAR_DICT` on the heap
+ * @param   shards  power of 2
+ */
+void var_dict_shard_init(var_t* var, size_t shards) {
+    // shards start at the first cache line after the dict
+    var_dict_t* dict = var_alloc_for(var, sizeof (var_dict_t) + DICT_LINE + sizeof (var_dict_shard_t) * shards);
+    MEM_CHECK(dict);
+    memset(dict, 0, sizeof (var_dict_t));
+    var_ref_init(&dict->ref);
+    var->data.d = dict;
+
+    uintptr_t mem = ((uintptr_t) (dict + 1) + DICT_LINE - 1) & ~(uintptr_t) (DICT_LINE - 1);
+    dict->shard  = (var_dict_shard_t*) mem;
+    dict->shards = shards;
+    for (size_t i = 0; i < shards; i++) {
+        dict->shard[i].var.type = VAR_DICT;
+        dict->shard[i].var.flag = var->flag & VAR_FLAG_BLOCK;
+        atomic_init(&dict->shard[i].lock, 0);
+    }
+}
+
+
+// bytes of the table allocated by `var_dict_init` for `size` elements
+size_t var_dict_table_size(size_t size) {
+    if (size == 0) return 0;
+    size_t cap = var_dict_cap_for(size);
+    return sizeof (int8_t) * cap + sizeof (var_dict_slot_t) * cap;
+}
+
+
+// delete keys and vals of slots [`begin`, `end`) of the table `arg`
+static void var_dict_free_range(void* arg, size_t begin, size_t end) {
+    var_dict_table_t* table = arg;
+    for (size_t i = begin; i < end; i++) {
+        if (table->ctrl[i] < 0) continue;
+        var_delete(table->slot[i].key);
+        var_delete(table->slot[i].val);
+    }
+}
+
+
+/*
+ * free the dict of `var` with all keys and values in it, large tables are split across the pool
+ */
+void var_dict_free(var_t* var) {
+    var_dict_t* dict = var->data.d;
+    for (size_t i = 0; i < dict->shards; i++) {
+        var_dict_free(&dict->shard[i].var);
+    }
+
+    var_dict_table_t* tables[] = { &dict->table, &dict->old };
+    for (size_t t = 0; t < 2; t++) {
+        if (var_pool_split(tables[t]->cap)) {
+            var_pool_for(var_dict_free_range, tables[t], tables[t]->cap);
+        } else {
+            var_dict_free_range(tables[t], 0, tables[t]->cap);
+        }
+        if (tables[t]->ctrl != NULL) var_free(var, tables[t]->ctrl);
+    }
+    var_free(var, dict);
+}
+
+
+/*
+ * @param   dict    the dict to search
+ * @param   key     the key
+ * @param   hash    `var_hash` of `key`
+ * @return          the slot of `key`, `NULL` if not found
+ */
+var_dict_slot_t* var_dict_find(const var_dict_t* dict, const var_t* key, uint64_t hash) {
+    if (dict->shard != NULL) dict = var_dict_shard_of(dict, hash)->var.data.d;
+    if (dict->len == 0) return NULL;
+
+    uint64_t mix = var_dict_mix(hash);
+    var_dict_slot_t* res = var_dict_table_find(&dict->table, key, hash, mix);
+    if (res == NULL && dict->old.cap != 0) {
+        res = var_dict_table_find(&dict->old, key, hash, mix);
+    }
+    return res;
+}
+
+
+/*
+ * find the slot of `key`, or take a new slot for it.
+ * a new slot has its hash set, key and val are left for the caller.
+ * during incremental resize, this also moves `DICT_STEP` groups into the new table.
+ *
+ * @param   var     a `var_t*` of type `VAR_DICT`
+ * @param   key     the key
+ * @param   hash    `var_hash` of `key`
+ * @param   found   set to if `key` was already in the dict
+ * @return          the slot of `key`
+ */
+var_dict_slot_t* var_dict_emplace(var_t* var, const var_t* key, uint64_t hash, bool* found) {
+    if (var->data.d->shard != NULL) {
+        return var_dict_emplace(&var_dict_shard_of(var->data.d, hash)->var, key, hash, found);
+    }
+
+    var_dict_t*         dict    = var->data.d;
+    var_dict_table_t*   table   = &dict->table;
+    uint64_t            mix     = var_dict_mix(hash);
+    int8_t              h2      = (int8_t) (mix & 0x7f);
+    size_t              target  = SIZE_MAX;
+
+    if (dict->old.cap != 0) {
+        var_dict_migrate(var, DICT_STEP);
+        var_dict_slot_t* slot = var_dict_table_find(&dict->old, key, hash, mix);
+        if (slot != NULL) {
+            *found = true;
+            return slot;
+        }
+    }
+
+    if (table->cap != 0) {
+        size_t gmask    = table->cap / DICT_GROUP - 1;
+        size_t g        = var_dict_home(mix, table->cap);
+        for (size_t step = 1; ; g = (g + step++) & gmask) {
+            const int8_t* ctrl = table->ctrl + g * DICT_GROUP;
+            for (uint32_t m = var_dict_match(ctrl, h2); m != 0; m &= m - 1) {
+                var_dict_slot_t* slot = &table->slot[g * DICT_GROUP + __builtin_ctz(m)];
+                if (slot->hash == hash && var_key_equal(slot->key, key)) {
+                    *found = true;
+                    return slot;
+                }
+            }
+
+            // first free slot on the probe sequence
+            if (target == SIZE_MAX) {
+                uint32_t m = var_dict_match_free(ctrl);
+                if (m != 0) target = g * DICT_GROUP + __builtin_ctz(m);
+            }
+            if (var_dict_match(ctrl, DICT_EMPTY) != 0) break;
+        }
+    }
+    *found = false;
+
+    // reusing a `DICT_DELETED` slot does not need to grow
+    if (table->cap == 0 || (table->ctrl[target] == DICT_EMPTY && dict->growth == 0)) {
+        if (table->cap == 0) {
+            var_dict_resize(var, DICT_SIZE);
+        } else if (dict->len <= table->cap / 16 * 7) {
+            var_dict_resize(var, table->cap);
+        } else {
+            var_dict_resize(var, table->cap * 2);
+        }
+        target = var_dict_probe_free(table, mix);
+    }
+
+    if (table->ctrl[target] == DICT_EMPTY) dict->growth--;
+    table->ctrl[target] = h2;
+    table->slot[target].hash = hash;
+    dict->len++;
+    return &table->slot[target];
+}
+
+
+// remove `slot` from the dict, key and val are left for the caller
+static void var_dict_erase(var_t* var, var_dict_slot_t* slot) {
+    var_dict_t*         dict    = var->data.d;
+    var_dict_table_t*   table   = &dict->table;
+    dict->len--;
+
+    if (slot < table->slot || slot >= table->slot + table->cap) {
+        dict->old.ctrl[slot - dict->old.slot] = DICT_DELETED;
+        return;
+    }
+
+    // a group that still has an empty slot never made any probe sequence go further
+    size_t index = slot - table->slot;
+    if (var_dict_match(table->ctrl + (index & ~(size_t) (DICT_GROUP - 1)), DICT_EMPTY) != 0) {
+        table->ctrl[index] = DICT_EMPTY;
+        dict->growth++;
+    } else {
+        table->ctrl[index] = DICT_DELETED;
+    }
+}
+
+
+static inline void var_dict_check(const var_t* var) {
+    if (var_typeof(var) != VAR_DICT) {
+        ERRO("expected type `VAR_DICT`");
+    }
+}
+
+
+/*
+ * an empty `VAR_DICT` whose elements are split into `shards` dicts by hash, each behind its own lock.
+ * `var_dict_get`, `var_dict_get_retain`, `var_dict_contains`, `var_dict_put`, `var_dict_remove`,
+ * their `_hashed` versions, `var_dict_scan` and `var_len` are then safe to call from many threads,
+ * writers only block readers and writers of the same shard.
+ * everything else reads the dict without locks, such as iterators, `var_equal` and `var_to_json`,
+ * they must not run alongside writers.
+ *
+ * keys and vals must be on the heap, the dict itself is always allocated on the heap.
+ * build with `TYPE_ATOMIC` if threads retain or delete vals taken from the dict.
+ * do not `var_retain` the dict itself while threads write to it, the first write would copy it.
+ *
+ * @param   shards  number of shards, rounded up to a power of 2, 0 for `DICT_SHARDS`
+ * @return          a new `var_t*` of type `VAR_DICT`, `NULL` over the budget in use
+ */
+var_t* var_new_dict_sharded(size_t shards) {
+    if (shards == 0) shards = DICT_SHARDS;
+    if (shards > DICT_SHARD_MAX) {
+        ERRO("too many shards");
+    }
+    size_t n = 1;
+    while (n < shards) n *= 2;
+    if (var_budget_over(sizeof (var_t) + sizeof (var_dict_t) * (n + 1) + DICT_LINE + sizeof (var_dict_shard_t) * n)) {
+        return NULL;
+    }
+
+    var_arena_t* arena = var_arena_use(NULL);
+    var_t* res = var_box(VAR_DICT);
+    var_dict_shard_init(res, n);
+    for (size_t i = 0; i < n; i++) {
+        var_dict_init(&res->data.d->shard[i].var, 0);
+    }
+    var_arena_use(arena);
+    return res;
+}
+
+
+// number of elements, a sharded dict counts them shard by shard
+size_t var_dict_len(const var_dict_t* dict) {
+    if (dict->shard == NULL) return dict->len;
+
+    size_t res = 0;
+    for (size_t i = 0; i < dict->shards; i++) {
+        var_dict_read_lock(&dict->shard[i]);
+        res += dict->shard[i].var.data.d->len;
+        var_dict_read_unlock(&dict->shard[i]);
+    }
+    return res;
+}
+
+
+// val of `key`, retained if `retain`, under the read lock of its shard
+static var_t* var_dict_lookup(const var_t* var, const var_t* key, uint64_t hash, bool retain) {
+    var_dict_t*         dict    = var->data.d;
+    var_dict_shard_t*   shard   = NULL;
+    if (dict->shard != NULL) {
+        shard = var_dict_shard_of(dict, hash);
+        var_dict_read_lock(shard);
+        dict = shard->var.data.d;
+    }
+
+    var_dict_slot_t* slot = var_dict_find(dict, key, hash);
+    var_t* res = slot == NULL ? NULL : slot->val;
+    if (res != NULL && retain) res = var_retain(res);
+
+    if (shard != NULL) var_dict_read_unlock(shard);
+    return res;
+}
+
+
+// sharded dicts can be written by other threads, elements allocated by one arena cannot
+static inline void var_dict_check_heap(const var_t* var, const var_t* key, const var_t* val) {
+    if (var->data.d->shard == NULL) return;
+    if ((var_is_imm(key) == false && (key->flag & VAR_FLAG_ARENA)) ||
+        (var_is_imm(val) == false && (val->flag & VAR_FLAG_ARENA))) {
+        ERRO("a sharded dict only takes heap `var_t`");
+    }
+}
+
+
+/*
+ * @param   var     a `var_t*` of type `VAR_DICT`
+ * @param   key     the key to look up, unhashable keys are never found
+ * @return          the val of `key` owned by the dict, `NULL` if not found.
+ *                  in a sharded dict, it is only valid until another thread replaces or removes it,
+ *                  see `var_dict_get_retain`
+ */
+var_t* var_dict_get(const var_t* var, const var_t* key) {
+    uint64_t hash;
+    var_dict_check(var);
+    if (var_hash(key, &hash) == false) return NULL;
+    return var_dict_get_hashed(var, key, hash);
+}
+
+
+/*
+ * same as `var_dict_get`, `hash` must be `var_hash` of `key`. 
+ * hash once, look up the same key in many dicts. 
+ */
+var_t* var_dict_get_hashed(const var_t* var, const var_t* key, uint64_t hash) {
+    var_dict_check(var);
+    return var_dict_lookup(var, key, hash, false);
+}
+
+
+/*
+ * same as `var_dict_get`, but the val is shared with `var_retain` before the lock is released.
+ * it stays valid whatever other threads write to the dict.
+ *
+ * @param   var     a `var_t*` of type `VAR_DICT`
+ * @param   key     the key to look up, unhashable keys are never found
+ * @return          a new `var_t*` sharing the val of `key`, free it with `var_delete`, `NULL` if not found
+ */
+var_t* var_dict_get_retain(const var_t* var, const var_t* key) {
+    uint64_t hash;
+    var_dict_check(var);
+    if (var_hash(key, &hash) == false) return NULL;
+    return var_dict_lookup(var, key, hash, true);
+}
+
+
+bool var_dict_contains(const var_t* var, const var_t* key) {
+    return var_dict_get(var, key) != NULL;
+}
+
+
+bool var_dict_contains_hashed(const var_t* var, const var_t* key, uint64_t hash) {
+    return var_dict_get_hashed(var, key, hash) != NULL;
+}
+
+
+/*
+ * the dict takes both `key` and `val`. 
+ * if `key` is already in the dict, the old val is replaced and deleted, 
+ * the dict keeps the old key and deletes `key`, nothing is allocated. 
+ *
+ * @param   var     a `var_t*` of type `VAR_DICT`
+ * @param   key     the key, must be hashable
+ * @param   val     the val
+ */
+void var_dict_put(var_t* var, var_t* key, var_t* val) {
+    uint64_t hash;
+    var_dict_check(var);
+    if (var_hash(key, &hash) == false) {
+        ERRO("failed to hash");
+    }
+    var_dict_put_hashed(var, key, val, hash);
+}
+
+
+void var_dict_put_hashed(var_t* var, var_t* key, var_t* val, uint64_t hash) {
+    bool found;
+    var_dict_check(var);
+    var_dict_check_heap(var, key, val);
+    var_unshare(var);
+
+    var_dict_shard_t* shard = NULL;
+    if (var->data.d->shard != NULL) {
+        shard = var_dict_shard_of(var->data.d, hash);
+        var_dict_write_lock(shard);
+        var = &shard->var;
+    }
+
+    // replaced elements are deleted after the lock is released
+    var_t* old_key = NULL;
+    var_t* old_val = NULL;
+    var_dict_slot_t* slot = var_dict_emplace(var, key, hash, &found);
+    if (found) {
+        if (slot->key != key) old_key = key;
+        if (slot->val != val) old_val = slot->val;
+    } else {
+        slot->key = key;
+    }
+    slot->val = val;
+
+    if (shard != NULL) var_dict_write_unlock(shard);
+    if (old_key != NULL) var_delete(old_key);
+    if (old_val != NULL) var_delete(old_val);
+}
+
+
+/*
+ * delete `key` and its val from the dict
+ *
+ * @param   var     a `var_t*` of type `VAR_DICT`
+ * @param   key     the key to remove, it is not taken by the dict
+ * @return          if `key` was in the dict
+ */
+bool var_dict_remove(var_t* var, const var_t* key) {
+    uint64_t hash;
+    var_dict_check(var);
+    if (var_hash(key, &hash) == false) return false;
+    return var_dict_remove_hashed(var, key, hash);
+}
+
+
+bool var_dict_remove_hashed(var_t* var, const var_t* key, uint64_t hash) {
+    var_dict_check(var);
+    var_unshare(var);
+
+    var_dict_shard_t* shard = NULL;
+    if (var->data.d->shard != NULL) {
+        shard = var_dict_shard_of(var->data.d, hash);
+        var_dict_write_lock(shard);
+        var = &shard->var;
+    }
+    var_dict_migrate(var, DICT_STEP);
+
+    var_dict_slot_t* slot = var_dict_find(var->data.d, key, hash);
+    var_t* old_key = NULL;
+    var_t* old_val = NULL;
+    if (slot != NULL) {
+        old_key = slot->key;
+        old_val = slot->val;
+        var_dict_erase(var, slot);
+    }
+
+    if (shard != NULL) var_dict_write_unlock(shard);
+    if (slot == NULL) return false;
+    var_delete(old_key);
+    var_delete(old_val);
+    return true;
+}
+
+
+/*
+ * replace the dict of `var` with a copy of `src` of the same layout, 
+ * keys and vals are shared with `var_retain`. 
+ */
+void var_dict_clone(var_t* var, const var_dict_t* src) {
+    if (src->shard != NULL) {
+        var_dict_shard_init(var, src->shards);
+        var->data.d->incremental = src->incremental;
+        for (size_t i = 0; i < src->shards; i++) {
+            var_dict_clone(&var->data.d->shard[i].var, src->shard[i].var.data.d);
+        }
+        return;
+    }
+
+    var_dict_t* dict = var_alloc_for(var, sizeof (var_dict_t));
+    MEM_CHECK(dict);
+    memcpy(dict, src, sizeof (var_dict_t));
+    var_ref_init(&dict->ref);
+    var->data.d = dict;
+
+    const var_dict_table_t* from[] = { &src->table, &src->old };
+    var_dict_table_t*       to[]   = { &dict->table, &dict->old };
+    for (size_t t = 0; t < 2; t++) {
+        size_t cap = from[t]->cap;
+        if (cap == 0) continue;
+
+        var_dict_alloc(var, to[t], cap);
+        memcpy(to[t]->ctrl, from[t]->ctrl, sizeof (int8_t) * cap + sizeof (var_dict_slot_t) * cap);
+        for (size_t i = 0; i < cap; i++) {
+            if (to[t]->ctrl[i] < 0) continue;
+            to[t]->slot[i].key = var_retain_elem(from[t]->slot[i].key);
+            to[t]->slot[i].val = var_retain_elem(from[t]->slot[i].val);
+        }
+    }
+}
+
+
+/*
+ * the first element at or after slot `*pos` of table `*table`, 0 for the current table, 1 for the old.
+ * both are moved past the returned slot. in a sharded dict, `*table / 2` is the shard.
+ *
+ * @return  the slot, `NULL` after the last element
+ */
+var_dict_slot_t* var_dict_next(const var_dict_t* dict, size_t* table, size_t* pos) {
+    if (dict->shard != NULL) {
+        for (; *table / 2 < dict->shards; *table = *table / 2 * 2 + 2, *pos = 0) {
+            size_t t = *table % 2;
+            var_dict_slot_t* slot = var_dict_next(dict->shard[*table / 2].var.data.d, &t, pos);
+            if (slot != NULL) {
+                *table = *table / 2 * 2 + t;
+                return slot;
+            }
+        }
+        return NULL;
+    }
+
+    for (; *table < 2; (*table)++, *pos = 0) {
+        const var_dict_table_t* t = *table == 0 ? &dict->table : &dict->old;
+        while (*pos < t->cap) {
+            // skip a whole group at once if it has no element
+            if ((*pos & (DICT_GROUP - 1)) == 0 && var_dict_match_free(t->ctrl + *pos) == 0xffff) {
+                *pos += DICT_GROUP;
+                continue;
+            }
+            size_t i = (*pos)++;
+            if (t->ctrl[i] >= 0) return &t->slot[i];
+        }
+    }
+    return NULL;
+}
+
+
+/*
+ * in incremental mode, growing the dict does not move all elements at once. 
+ * the old table is kept, each later write moves `DICT_STEP` groups into the new table. 
+ * this bounds the latency of every write, at the cost of looking up both tables meanwhile. 
+ *
+ * @param   var     a `var_t*` of type `VAR_DICT`
+ * @param   enable  turn incremental resize on or off, turning it off finishes the ongoing resize
+ */
+void var_dict_incremental(var_t* var, bool enable) {
+    var_dict_check(var);
+    var_unshare(var);
+    var->data.d->incremental = enable;
+    for (size_t i = 0; i < var->data.d->shards; i++) {
+        var_dict_shard_t* shard = &var->data.d->shard[i];
+        var_dict_write_lock(shard);
+        var_dict_incremental(&shard->var, enable);
+        var_dict_write_unlock(shard);
+    }
+    if (enable == false) var_dict_migrate(var, SIZE_MAX);
+}
+
+
+// reverse the bits of `v`
+static inline uint64_t var_dict_rev(uint64_t v) {
+    v = ((v >> 1)  & 0x5555555555555555LLU) | ((v & 0x5555555555555555LLU) << 1);
+    v = ((v >> 2)  & 0x3333333333333333LLU) | ((v & 0x3333333333333333LLU) << 2);
+    v = ((v >> 4)  & 0x0f0f0f0f0f0f0f0fLLU) | ((v & 0x0f0f0f0f0f0f0f0fLLU) << 4);
+    v = ((v >> 8)  & 0x00ff00ff00ff00ffLLU) | ((v & 0x00ff00ff00ff00ffLLU) << 8);
+    v = ((v >> 16) & 0x0000ffff0000ffffLLU) | ((v & 0x0000ffff0000ffffLLU) << 16);
+    return (v >> 32) | (v << 32);
+}
+
+
+// call `fn` on every element of `table` whose home group is `home`
+static void var_dict_scan_home(const var_dict_table_t* table, size_t home, var_dict_scan_fn fn, void* arg) {
+    size_t gmask    = table->cap / DICT_GROUP - 1;
+    size_t g        = home;
+    for (size_t step = 1; ; g = (g + step++) & gmask) {
+        const int8_t* ctrl = table->ctrl + g * DICT_GROUP;
+        for (size_t i = 0; i < DICT_GROUP; i++) {
+            if (ctrl[i] < 0) continue;
+            var_dict_slot_t* slot = &table->slot[g * DICT_GROUP + i];
+            if (var_dict_home(var_dict_mix(slot->hash), table->cap) == home) {
+                fn(slot->key, slot->val, arg);
+            }
+        }
+        if (var_dict_match(ctrl, DICT_EMPTY) != 0) return;
+    }
+}
+
+
+/*
+ * iterate the dict in small steps, each call visits the elements of one home group. 
+ * start with cursor 0, pass the returned cursor to the next call, until 0 is returned. 
+ * cursor counts with reversed bits, so elements present during the whole scan are visited 
+ * at least once even if the dict is resized between calls. some may be visited more than once. 
+ * the dict must not be changed inside of `fn`.
+ * a sharded dict is scanned shard by shard, each call holds the read lock of one shard,
+ * so other threads can write meanwhile.
+ *
+ * @param   var     a `var_t*` of type `VAR_DICT`
+ * @param   cursor  0 to start, or the return value of the last call
+ * @param   fn      called with key and val of each visited element
+ * @param   arg     passed to `fn`
+ * @return          the cursor for the next call, 0 if the scan is done
+ */
+uint64_t var_dict_scan(const var_t* var, uint64_t cursor, var_dict_scan_fn fn, void* arg) {
+    var_dict_check(var);
+    if (var->data.d->shard != NULL) {
+        // the cursor of a shard times the number of shards, plus the shard
+        var_dict_t*         dict    = var->data.d;
+        var_dict_shard_t*   shard   = &dict->shard[cursor % dict->shards];
+        var_dict_read_lock(shard);
+        uint64_t next = var_dict_scan(&shard->var, cursor / dict->shards, fn, arg);
+        var_dict_read_unlock(shard);
+
+        if (next != 0) return next * dict->shards + cursor % dict->shards;
+        return (cursor + 1) % dict->shards;
+    }
+
+    const var_dict_t*       dict    = var->data.d;
+    const var_dict_table_t* small   = &dict->table;
+    const var_dict_table_t* large   = &dict->old;
+    if (small->cap == 0) return 0;
+
+    if (large->cap == 0) {
+        uint64_t mask = small->cap / DICT_GROUP - 1;
+        var_dict_scan_home(small, cursor & mask, fn, arg);
+
+        cursor |= ~mask;
+        cursor = var_dict_rev(var_dict_rev(cursor) + 1);
+        return cursor;
+    }
+
+    // during resize, visit the group of the smaller table, then all its expansions in the larger one
+    if (small->cap > large->cap) {
+        const var_dict_table_t* temp = small;
+        small = large;
+        large = temp;
+    }
+    uint64_t m0 = small->cap / DICT_GROUP - 1;
+    uint64_t m1 = large->cap / DICT_GROUP - 1;
+
+    var_dict_scan_home(small, cursor & m0, fn, arg);
+    do {
+        var_dict_scan_home(large, cursor & m1, fn, arg);
+        cursor |= ~m1;
+        cursor = var_dict_rev(var_dict_rev(cursor) + 1);
+    } while (cursor & (m0 ^ m1));
+
+    return cursor;
+}
@@ -0,0 +1,192 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+#include "vargen.h"
+
+
+/*
+ * accessors of generated code, see `vargen.h`.
+ * they are what the generated code used to inline from the private headers,
+ * format strings and type dispatch stay resolved at compile time.
+ */
+
+
+static inline var_t** var_gen_slot(const var_t* var, size_t index) {
+    if (var->type == VAR_ARRAY) return &var->data.a->av[index];
+    return &var->data.l->lv[index];
+}
+
+
+var_type_t var_gen_type(const var_t* var) {
+    return var_typeof(var);
+}
+
+
+size_t var_gen_len(const var_t* var) {
+    if (var->type == VAR_ARRAY) return var->data.a->len;
+    return var->data.l->len;
+}
+
+
+var_t* var_gen_at(const var_t* var, size_t index) {
+    return *var_gen_slot(var, index);
+}
+
+
+int64_t var_gen_int(const var_t* var) {
+    return var_int_of(var);
+}
+
+
+uint64_t var_gen_uint(const var_t* var) {
+    return var_uint_of(var);
+}
+
+
+double var_gen_float(const var_t* var) {
+    return var_float_of(var);
+}
+
+
+const char* var_gen_str(const var_t* var) {
+    return var_str(var);
+}
+
+
+/*
+ * copy the payload of `var` if it is shared, before its elements are set
+ */
+void var_gen_unshare(var_t* var) {
+    var_unshare(var);
+}
+
+
+/*
+ * immediate values are replaced in their slot and boxed for `var`, see `var_box_for`,
+ * boxed ones are changed in place
+ */
+void var_gen_set_int(var_t* var, size_t index, int64_t i) {
+    var_t** slot = var_gen_slot(var, index);
+    if (var_is_imm(*slot)) {
+        *slot = var_box_int_for(var, i);
+        return;
+    }
+    var_hash_touch(*slot);
+    (*slot)->data.i = i;
+}
+
+
+void var_gen_set_uint(var_t* var, size_t index, uint64_t u) {
+    var_t** slot = var_gen_slot(var, index);
+    if (var_is_imm(*slot)) {
+        *slot = var_box_uint_for(var, u);
+        return;
+    }
+    var_hash_touch(*slot);
+    (*slot)->data.u = u;
+}
+
+
+void var_gen_set_float(var_t* var, size_t index, double f) {
+    var_t** slot = var_gen_slot(var, index);
+    if (var_is_imm(*slot)) {
+        *slot = var_box_float_for(var, f);
+        return;
+    }
+    var_hash_touch(*slot);
+    (*slot)->data.f = f;
+}
+
+
+void var_gen_set_str(var_t* var, size_t index, const char* str) {
+    var_str_assign(*var_gen_slot(var, index), str, strlen(str));
+}
+
+
+void var_gen_set(var_t* var, size_t index, var_t* elem) {
+    var_t** slot = var_gen_slot(var, index);
+    var_delete(*slot);
+    *slot = elem;
+}
+
+
+bool var_gen_budget(void) {
+    return var_budget_curr != NULL;
+}
+
+
+bool var_gen_over(size_t size) {
+    return var_budget_over(size);
+}
+
+
+// bytes of each constructor, same as `var_new_*` check
+size_t var_gen_size_int(int64_t i) {
+    return var_imm_int(i) == NULL ? sizeof (var_t) : 0;
+}
+
+
+size_t var_gen_size_uint(uint64_t u) {
+    return var_imm_uint(u) == NULL ? sizeof (var_t) : 0;
+}
+
+
+size_t var_gen_size_float(double f) {
+    return var_imm_float(f) == NULL ? sizeof (var_t) : 0;
+}
+
+
+size_t var_gen_size_str(const char* str) {
+    return var_string_size(strlen(str));
+}
+
+
+size_t var_gen_size_array(size_t len) {
+    return var_array_size(len);
+}
+
+
+size_t var_gen_size_list(size_t len) {
+    return sizeof (var_t) + sizeof (var_list_t) + sizeof (var_t*) * len;
+}
+
+
+var_t* var_gen_new_int(int64_t i) {
+    return var_box_int(i);
+}
+
+
+var_t* var_gen_new_uint(uint64_t u) {
+    return var_box_uint(u);
+}
+
+
+var_t* var_gen_new_float(double f) {
+    return var_box_float(f);
+}
+
+
+var_t* var_gen_new_str(const char* str) {
+    size_t len = strlen(str);
+    var_t* res = var_box_string(len);
+    memcpy(var_str(res), str, len);
+    return res;
+}
+
+
+var_t* var_gen_new_array(size_t len) {
+    return var_box_array(len);
+}
+
+
+var_t* var_gen_new_list(size_t len) {
+    var_t* res = var_box(VAR_LIST);
+    var_list_init(res, len);
+    res->data.l->len = len;
+    return res;
+}
+
+
+void var_gen_put(var_t* var, size_t index, var_t* elem) {
+    *var_gen_slot(var, index) = elem;
+}
@@ -0,0 +1,50 @@
+#ifndef __VARGEN_H__
+#define __VARGEN_H__
+
+#include "type.h"
+
+
+/*
+ * the only header included by code written by `vargen`, see `gen/vargen.c`.
+ * it stays the same as the layout of `var_t` changes, generated headers do not need to be written again.
+ * nothing is checked, generated code calls these on the shape of its schema only.
+ */
+
+// reads
+var_type_t      var_gen_type(const var_t* var);
+size_t          var_gen_len(const var_t* var);                  // elements of an array or list
+var_t*          var_gen_at(const var_t* var, size_t index);     // element of an array or list
+int64_t         var_gen_int(const var_t* var);
+uint64_t        var_gen_uint(const var_t* var);
+double          var_gen_float(const var_t* var);
+const char*     var_gen_str(const var_t* var);
+
+// writes into the element `index` of an array or list, which is unshared before
+void            var_gen_unshare(var_t* var);
+void            var_gen_set_int(var_t* var, size_t index, int64_t i);
+void            var_gen_set_uint(var_t* var, size_t index, uint64_t u);
+void            var_gen_set_float(var_t* var, size_t index, double f);
+void            var_gen_set_str(var_t* var, size_t index, const char* str);
+void            var_gen_set(var_t* var, size_t index, var_t* elem);     // takes `elem`, frees the old one
+
+// the budget in use, bytes of each constructor are added up and checked at once
+bool            var_gen_budget(void);       // if a budget is in use
+bool            var_gen_over(size_t size);
+size_t          var_gen_size_int(int64_t i);
+size_t          var_gen_size_uint(uint64_t u);
+size_t          var_gen_size_float(double f);
+size_t          var_gen_size_str(const char* str);
+size_t          var_gen_size_array(size_t len);
+size_t          var_gen_size_list(size_t len);
+
+// constructors, never `NULL`, containers are filled by `var_gen_put`
+var_t*          var_gen_new_int(int64_t i);
+var_t*          var_gen_new_uint(uint64_t u);
+var_t*          var_gen_new_float(double f);
+var_t*          var_gen_new_str(const char* str);
+var_t*          var_gen_new_array(size_t len);
+var_t*          var_gen_new_list(size_t len);
+void            var_gen_put(var_t* var, size_t index, var_t* elem);     // into a new container
+
+
+#endif  // __VARGEN_H__
@@ -0,0 +1,118 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+#include <threads.h>
+
+
+/*
+ * interned strings are kept in an open addressing table of canonical `var_t`, probed linearly.
+ * every `var_intern` of the same bytes shares the payload of the canonical one, see `var_retain`,
+ * so their hash is computed once, and `var_key_equal` finds them equal by pointer.
+ * the table is guarded by a mutex, changing an interned string copies it first.
+ */
+
+
+typedef struct var_intern_slot {
+    uint64_t    hash;
+    var_t*      var;    // `NULL` if empty
+} var_intern_slot_t;
+
+typedef struct var_intern_table {
+    var_intern_slot_t*  slot;
+    size_t              cap;    // power of 2, at most half full
+    size_t              len;
+} var_intern_table_t;
+
+static var_intern_table_t var_intern_table;
+static mtx_t var_intern_lock;
+static once_flag var_intern_once = ONCE_FLAG_INIT;
+
+
+static void var_intern_init(void) {
+    if (mtx_init(&var_intern_lock, mtx_plain) != thrd_success) {
+        ERRO("failed to create mutex");
+    }
+}
+
+
+static void var_intern_grow(var_intern_table_t* table) {
+    size_t cap = table->cap == 0 ? INTERN_SIZE : table->cap * 2;
+    var_intern_slot_t* slot = calloc(cap, sizeof (var_intern_slot_t));
+    MEM_CHECK(slot);
+
+    for (size_t i = 0; i < table->cap; i++) {
+        if (table->slot[i].var == NULL) continue;
+        size_t j = table->slot[i].hash & (cap - 1);
+        while (slot[j].var != NULL) j = (j + 1) & (cap - 1);
+        slot[j] = table->slot[i];
+    }
+    free(table->slot);
+    table->slot = slot;
+    table->cap = cap;
+}
+
+
+/*
+ * the canonical `VAR_STRING` of `len` bytes at `str`, shared by every call with the same bytes.
+ * strings of `SSO_SIZE` bytes or more share one payload, shorter ones are stored inside of `var_t` anyway.
+ * the result is always allocated on the heap, also if an arena is in use.
+ * thread safe, build with `TYPE_ATOMIC` if interned strings are freed by several threads.
+ *
+ * @param   str     the bytes of the string, it does not need a `\0` terminator
+ * @param   len     bytes of `str`
+ * @return          a new `var_t*` that shares the canonical string, free it with `var_delete`
+ */
+var_t* var_intern(const char* str, size_t len) {
+    call_once(&var_intern_once, var_intern_init);
+    uint64_t hash = var_hash_bytes(str, len, var_hash_key());
+
+    var_arena_t* arena = var_arena_use(NULL);
+    mtx_lock(&var_intern_lock);
+
+    var_intern_table_t* table = &var_intern_table;
+    if (table->len * 2 >= table->cap) var_intern_grow(table);
+
+    size_t i = hash & (table->cap - 1);
+    for (;; i = (i + 1) & (table->cap - 1)) {
+        var_intern_slot_t* slot = &table->slot[i];
+        if (slot->var == NULL) {
+            var_t* var = var_box_string(len);
+            memcpy(var_str(var), str, len);
+            if ((var->flag & VAR_FLAG_SHORT) == 0) var_hash_cache_store(&var->data.s->hash, hash);
+            slot->hash = hash;
+            slot->var = var;
+            table->len++;
+            break;
+        }
+        if (slot->hash == hash && var_str_len(slot->var) == len && memcmp(var_str(slot->var), str, len) == 0) {
+            break;
+        }
+    }
+    var_t* res = var_retain(table->slot[i].var);
+
+    mtx_unlock(&var_intern_lock);
+    var_arena_use(arena);
+    return res;
+}
+
+
+/*
+ * empty the table of `var_intern`, strings it returned stay valid but are no longer canonical.
+ * it must not run while other threads call `var_intern`.
+ */
+void var_intern_clear(void) {
+    call_once(&var_intern_once, var_intern_init);
+    mtx_lock(&var_intern_lock);
+
+    var_intern_table_t* table = &var_intern_table;
+    for (size_t i = 0; i < table->cap; i++) {
+        if (table->slot[i].var != NULL) var_delete(table->slot[i].var);
+    }
+    free(table->slot);
+    table->slot = NULL;
+    table->cap = 0;
+    table->len = 0;
+
+    mtx_unlock(&var_intern_lock);
+}
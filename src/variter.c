@@ -0,0 +1,137 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * an iterator walks `VAR_ARRAY` and `VAR_LIST` by index, and `VAR_DICT` by slot.
+ * a full iteration is O(n) with sequential memory access.
+ * changing the container invalidates the iterator.
+ */
+
+
+/*
+ * @param   iter    the iterator, usually on stack
+ * @param   var     a `var_t*` of type `VAR_ARRAY`, `VAR_LIST` or `VAR_DICT`
+ */
+void var_iter_init(var_iter_t* iter, const var_t* var) {
+    switch (var_typeof(var)) {
+        case VAR_ARRAY:
+        case VAR_LIST:
+        case VAR_DICT: break;
+
+        default: {
+            ERRO("only array, list and dict can be iterated");
+        }
+    }
+
+    iter->var   = var;
+    iter->pos   = 0;
+    iter->table = 0;
+    iter->val   = NULL;
+}
+
+
+/*
+ * @param   iter    the iterator
+ * @return          next element of array or list, next key of dict, `NULL` at the end
+ */
+var_t* var_iter_next(var_iter_t* iter) {
+    const var_t* var = iter->var;
+    switch (var->type) {
+        case VAR_ARRAY: {
+            if (iter->pos >= var->data.a->len) return NULL;
+            return var->data.a->av[iter->pos++];
+        }
+
+        case VAR_LIST: {
+            if (iter->pos >= var->data.l->len) return NULL;
+            return var->data.l->lv[iter->pos++];
+        }
+
+        case VAR_DICT: {
+            var_dict_slot_t* slot = var_dict_next(var->data.d, &iter->table, &iter->pos);
+            if (slot == NULL) {
+                iter->val = NULL;
+                return NULL;
+            }
+            iter->val = slot->val;
+            return slot->key;
+        }
+
+        default: {
+            ERRO("corrupted iterator");
+        }
+    }
+    return NULL;
+}
+
+
+/*
+ * @param   iter    the iterator
+ * @return          what the next `var_iter_next` returns, without moving the iterator
+ */
+var_t* var_iter_peek(const var_iter_t* iter) {
+    var_iter_t temp = *iter;
+    return var_iter_next(&temp);
+}
+
+
+/*
+ * @param   iter    the iterator of a dict
+ * @return          val of the key last returned by `var_iter_next`
+ */
+var_t* var_iter_val(const var_iter_t* iter) {
+    return iter->val;
+}
+
+
+/*
+ * move the iterator by at most `n` elements at once
+ *
+ * @param   iter    the iterator
+ * @param   buf     filled with elements of array or list, or keys of dict
+ * @param   vals    filled with vals of dict, can be `NULL`, not used for array or list
+ * @param   n       size of `buf` and `vals`
+ * @return          number of elements filled, less than `n` only at the end
+ */
+size_t var_iter_next_n(var_iter_t* iter, var_t** buf, var_t** vals, size_t n) {
+    const var_t* var = iter->var;
+    switch (var->type) {
+        case VAR_ARRAY:
+        case VAR_LIST: {
+            size_t len;
+            var_t* const* src;
+            if (var->type == VAR_ARRAY) {
+                len = var->data.a->len;
+                src = var->data.a->av;
+            } else {
+                len = var->data.l->len;
+                src = var->data.l->lv;
+            }
+            if (iter->pos >= len) return 0;
+            if (n > len - iter->pos) n = len - iter->pos;
+            memcpy(buf, src + iter->pos, sizeof (var_t*) * n);
+            iter->pos += n;
+            return n;
+        }
+
+        case VAR_DICT: {
+            size_t i = 0;
+            var_dict_slot_t* slot;
+            for (; i < n; i++) {
+                slot = var_dict_next(var->data.d, &iter->table, &iter->pos);
+                if (slot == NULL) break;
+                buf[i] = slot->key;
+                if (vals != NULL) vals[i] = slot->val;
+                iter->val = slot->val;
+            }
+            return i;
+        }
+
+        default: {
+            ERRO("corrupted iterator");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1774 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+#if defined(__AVX2__) || defined(__PCLMUL__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif  // __AVX2__
+
+
+/*
+ * JSON is parsed in two passes.
+ * the first pass classifies 64 bytes at a time with SIMD compares and bit operations,
+ * and records the position of every structural character outside of strings
+ * (`{}[]:,`, and the first byte of every string, number and literal).
+ * containers are then counted on those positions, so the second pass
+ * creates every list and dict with its final size while it walks them.
+ *
+ * SSE2 is used on x86-64, AVX2 and PCLMUL when the compiler targets them, scalar code otherwise.
+ */
+
+
+// first pass
+
+// bits of the 64 bytes at `p`
+typedef struct var_json_mask {
+    uint64_t    quote;
+    uint64_t    backslash;
+    uint64_t    op;     // `{}[]:,`
+    uint64_t    space;  // ` \t\n\r`
+} var_json_mask_t;
+
+
+static inline void var_json_classify(const unsigned char* p, var_json_mask_t* m) {
+#if defined(__AVX2__)
+    m->quote = m->backslash = m->op = m->space = 0;
+    for (size_t i = 0; i < 64; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (p + i));
+
+        // `{` and `[`, `}` and `]` differ in the bit 0x20 only
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+        __m256i space = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+
+        m->quote     |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << i;
+        m->backslash |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << i;
+        m->op        |= (uint64_t) (uint32_t) _mm256_movemask_epi8(op) << i;
+        m->space     |= (uint64_t) (uint32_t) _mm256_movemask_epi8(space) << i;
+    }
+#elif defined(__SSE2__)
+    m->quote = m->backslash = m->op = m->space = 0;
+    for (size_t i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (p + i));
+
+        // `{` and `[`, `}` and `]` differ in the bit 0x20 only
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+        __m128i space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+
+        m->quote     |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << i;
+        m->backslash |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << i;
+        m->op        |= (uint64_t) (uint16_t) _mm_movemask_epi8(op) << i;
+        m->space     |= (uint64_t) (uint16_t) _mm_movemask_epi8(space) << i;
+    }
+#else
+    m->quote = m->backslash = m->op = m->space = 0;
+    for (size_t i = 0; i < 64; i++) {
+        uint64_t bit = (uint64_t) 1 << i;
+        switch (p[i]) {
+            case '"': m->quote |= bit; break;
+            case '\\': m->backslash |= bit; break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',': m->op |= bit; break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r': m->space |= bit; break;
+            default: break;
+        }
+    }
+#endif  // __AVX2__
+}
+
+
+// bit i is the parity of bits 0 to i
+static inline uint64_t var_json_prefix_xor(uint64_t bits) {
+#ifdef __PCLMUL__
+    __m128i all = _mm_set1_epi8((char) 0xff);
+    return (uint64_t) _mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, (int64_t) bits), all, 0));
+#else
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+#endif  // __PCLMUL__
+}
+
+
+/*
+ * characters escaped by an odd run of backslashes.
+ * runs that start on an odd bit are carried over into an even one by the addition,
+ * `carry` is set if the last character of the block escapes the first one of the next.
+ */
+static inline uint64_t var_json_escaped(uint64_t backslash, uint64_t* carry) {
+    const uint64_t even = 0x5555555555555555LLU;
+
+    backslash &= ~*carry;
+    uint64_t follows = backslash << 1 | *carry;
+    uint64_t odd_starts = backslash & ~even & ~follows;
+    uint64_t sum = odd_starts + backslash;
+    *carry = sum < odd_starts;
+    return (even ^ (sum << 1)) & follows;
+}
+
+
+// parser state
+typedef struct var_json {
+    const unsigned char*    src;
+    size_t                  len;
+    uint32_t*               idx;        // positions of structural characters
+    size_t                  n;
+    size_t                  pos;        // next of `idx`
+    uint32_t*               count;      // elements of every container, in the order they are opened
+    size_t                  count_len;
+    size_t                  count_cap;
+    size_t                  cont;       // next of `count`
+    size_t                  depth;
+    char*                   scratch;    // unescaped strings
+    size_t                  scratch_cap;
+} var_json_t;
+
+
+static bool var_json_index(var_json_t* j) {
+    j->idx = malloc(sizeof (uint32_t) * (j->len + 8));
+    MEM_CHECK(j->idx);
+
+    uint64_t escape_carry = 0, in_string_carry = 0, scalar_carry = 0;
+    unsigned char tail[64];
+    size_t n = 0;
+    for (size_t base = 0; base < j->len; base += 64) {
+        const unsigned char* p = j->src + base;
+        if (j->len - base < 64) {
+            // the last block is padded with spaces
+            memset(tail, ' ', 64);
+            memcpy(tail, p, j->len - base);
+            p = tail;
+        }
+
+        var_json_mask_t m;
+        var_json_classify(p, &m);
+
+        uint64_t quote = m.quote & ~var_json_escaped(m.backslash, &escape_carry);
+        uint64_t in_string = var_json_prefix_xor(quote) ^ in_string_carry;
+        in_string_carry = (uint64_t) ((int64_t) in_string >> 63);
+
+        // the first byte of every scalar, a string is a scalar that starts with a quote
+        uint64_t scalar = ~(m.op | m.space);
+        uint64_t plain = scalar & ~quote;
+        uint64_t follows = plain << 1 | scalar_carry;
+        scalar_carry = plain >> 63;
+
+        // inside of strings and closing quotes are not structural
+        uint64_t bits = (m.op | (scalar & ~follows)) & ~(in_string ^ quote);
+        // 8 positions are written at once, `idx` has room for the extra ones
+        size_t cnt = (size_t) __builtin_popcountll(bits);
+        uint32_t* out = j->idx + n;
+        while (bits != 0) {
+            for (size_t i = 0; i < 8; i++) {
+                out[i] = (uint32_t) (base + (size_t) __builtin_ctzll(bits | ((uint64_t) 1 << 63)));
+                bits &= bits - 1;
+            }
+            out += 8;
+        }
+        n += cnt;
+    }
+    j->n = n;
+    return in_string_carry == 0;
+}
+
+
+// count elements of containers, brackets are matched on the way
+static bool var_json_count(var_json_t* j) {
+    uint32_t stack[JSON_DEPTH];
+    char close[JSON_DEPTH];
+    size_t top = 0;
+    char prev = '\0';
+
+    for (size_t i = 0; i < j->n; i++) {
+        char c = (char) j->src[j->idx[i]];
+        switch (c) {
+            case '{':
+            case '[': {
+                if (top == JSON_DEPTH) return false;
+                if (j->count_len == j->count_cap) {
+                    j->count_cap = j->count_cap == 0 ? LIST_SIZE : j->count_cap * 2;
+                    j->count = realloc(j->count, sizeof (uint32_t) * j->count_cap);
+                    MEM_CHECK(j->count);
+                }
+                j->count[j->count_len] = 0;
+                close[top] = c == '{' ? '}' : ']';
+                stack[top++] = (uint32_t) j->count_len++;
+            }
+            break;
+
+            case '}':
+            case ']': {
+                if (top == 0 || close[top - 1] != c) return false;
+                top--;
+                if (prev != '{' && prev != '[') j->count[stack[top]]++;
+            }
+            break;
+
+            case ',': {
+                if (top > 0) j->count[stack[top - 1]]++;
+            }
+            break;
+
+            default: break;
+        }
+        prev = c;
+    }
+    return top == 0;
+}
+
+
+// second pass
+
+static inline bool var_json_is_space(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+// if `c` can follow a number or literal
+static inline bool var_json_is_end(unsigned char c) {
+    return var_json_is_space(c) || c == ',' || c == ':' || c == '}' || c == ']' || c == '{' || c == '[' || c == '"';
+}
+
+
+// position of the next structural character, `len` at the end
+static inline uint32_t var_json_peek(const var_json_t* j) {
+    return j->pos < j->n ? j->idx[j->pos] : (uint32_t) j->len;
+}
+
+
+// next structural character, `\0` at the end
+static inline char var_json_take(var_json_t* j, uint32_t* at) {
+    *at = var_json_peek(j);
+    if (j->pos >= j->n) return '\0';
+    j->pos++;
+    return (char) j->src[*at];
+}
+
+
+// if `len` bytes at `p` have no backslashes, `control` is set if they have control characters
+static inline bool var_json_plain(const unsigned char* p, size_t len, bool* control) {
+    size_t i = 0;
+    bool res = true;
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (p + i));
+        __m128i bs = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+        // bytes no greater than 0x1f saturate to 0
+        __m128i ctl = _mm_cmpeq_epi8(_mm_subs_epu8(v, _mm_set1_epi8(0x1f)), _mm_setzero_si128());
+        if (_mm_movemask_epi8(ctl) != 0) {
+            *control = true;
+            return false;
+        }
+        if (_mm_movemask_epi8(bs) != 0) res = false;
+    }
+#endif  // __SSE2__
+    for (; i < len; i++) {
+        if (p[i] < 0x20) {
+            *control = true;
+            return false;
+        }
+        if (p[i] == '\\') res = false;
+    }
+    return res;
+}
+
+
+static inline int var_json_hex(const unsigned char* p) {
+    int res = 0;
+    for (size_t i = 0; i < 4; i++) {
+        unsigned char c = p[i];
+        int d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else return -1;
+        res = res * 16 + d;
+    }
+    return res;
+}
+
+
+// unescape `len` bytes at `p` into `scratch`, its length is returned through `res`
+static bool var_json_unescape(var_json_t* j, const unsigned char* p, size_t len, size_t* res) {
+    // never longer than the escaped form
+    if (j->scratch_cap < len) {
+        j->scratch = realloc(j->scratch, len);
+        MEM_CHECK(j->scratch);
+        j->scratch_cap = len;
+    }
+
+    char* out = j->scratch;
+    size_t n = 0;
+    for (size_t i = 0; i < len;) {
+        if (p[i] != '\\') {
+            out[n++] = (char) p[i++];
+            continue;
+        }
+        if (++i == len) return false;
+        switch (p[i++]) {
+            case '"': out[n++] = '"'; break;
+            case '\\': out[n++] = '\\'; break;
+            case '/': out[n++] = '/'; break;
+            case 'b': out[n++] = '\b'; break;
+            case 'f': out[n++] = '\f'; break;
+            case 'n': out[n++] = '\n'; break;
+            case 'r': out[n++] = '\r'; break;
+            case 't': out[n++] = '\t'; break;
+            case 'u': {
+                if (len - i < 4) return false;
+                int32_t cp = var_json_hex(p + i);
+                i += 4;
+                if (cp < 0 || (cp >= 0xdc00 && cp <= 0xdfff)) return false;
+                if (cp >= 0xd800 && cp <= 0xdbff) {
+                    // surrogate pair
+                    if (len - i < 6 || p[i] != '\\' || p[i + 1] != 'u') return false;
+                    int32_t low = var_json_hex(p + i + 2);
+                    if (low < 0xdc00 || low > 0xdfff) return false;
+                    i += 6;
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                }
+
+                // utf-8, at most 4 bytes for the 6 or 12 bytes of the escape
+                if (cp < 0x80) {
+                    out[n++] = (char) cp;
+                } else if (cp < 0x800) {
+                    out[n++] = (char) (0xc0 | (cp >> 6));
+                    out[n++] = (char) (0x80 | (cp & 0x3f));
+                } else if (cp < 0x10000) {
+                    out[n++] = (char) (0xe0 | (cp >> 12));
+                    out[n++] = (char) (0x80 | ((cp >> 6) & 0x3f));
+                    out[n++] = (char) (0x80 | (cp & 0x3f));
+                } else {
+                    out[n++] = (char) (0xf0 | (cp >> 18));
+                    out[n++] = (char) (0x80 | ((cp >> 12) & 0x3f));
+                    out[n++] = (char) (0x80 | ((cp >> 6) & 0x3f));
+                    out[n++] = (char) (0x80 | (cp & 0x3f));
+                }
+            }
+            break;
+
+            default: return false;
+        }
+    }
+    *res = n;
+    return true;
+}
+
+
+// string of the `len` bytes at `p`, which are between the quotes
+static var_t* var_json_string_raw(var_json_t* j, const unsigned char* p, size_t len) {
+    bool control = false;
+    if (var_json_plain(p, len, &control) == false) {
+        if (control || var_json_unescape(j, p, len, &len) == false) return NULL;
+        p = (const unsigned char*) j->scratch;
+    }
+    if (len > UINT32_MAX) return NULL;
+
+    var_t* res = var_box_string(len);
+    memcpy(var_str(res), p, len);
+    return res;
+}
+
+
+// string that starts with the quote at `at`
+static var_t* var_json_string(var_json_t* j, uint32_t at) {
+    // only spaces are between the closing quote and the next structural character
+    uint32_t end = var_json_peek(j);
+    while (end > at + 1 && var_json_is_space(j->src[end - 1])) end--;
+    if (end <= at + 1 || j->src[end - 1] != '"') return NULL;
+
+    return var_json_string_raw(j, j->src + at + 1, end - 1 - (at + 1));
+}
+
+
+static const double var_json_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 var_json_u128_t;
+
+// 5^i fits in 63 bits up to 5^27
+static const uint64_t var_json_pow5[] = {
+    1LLU, 5LLU, 25LLU, 125LLU, 625LLU, 3125LLU, 15625LLU, 78125LLU, 390625LLU, 1953125LLU,
+    9765625LLU, 48828125LLU, 244140625LLU, 1220703125LLU, 6103515625LLU, 30517578125LLU,
+    152587890625LLU, 762939453125LLU, 3814697265625LLU, 19073486328125LLU, 95367431640625LLU,
+    476837158203125LLU, 2384185791015625LLU, 11920928955078125LLU, 59604644775390625LLU,
+    298023223876953125LLU, 1490116119384765625LLU, 7450580596923828125LLU,
+};
+
+
+// `q * 2^e2` rounded to nearest even, `sticky` if `q` was truncated, `q` is not 0
+static double var_json_round(var_json_u128_t q, int e2, bool sticky) {
+    uint64_t hi = (uint64_t) (q >> 64);
+    int bits = hi != 0 ? 128 - __builtin_clzll(hi) : 64 - __builtin_clzll((uint64_t) q);
+
+    uint64_t m;
+    if (bits <= 53) {
+        m = (uint64_t) q << (53 - bits);
+        e2 -= 53 - bits;
+    } else {
+        int shift = bits - 53;
+        m = (uint64_t) (q >> shift);
+        var_json_u128_t rest = q & (((var_json_u128_t) 1 << shift) - 1);
+        var_json_u128_t half = (var_json_u128_t) 1 << (shift - 1);
+        if (rest > half || (rest == half && (sticky || (m & 1)))) m++;
+        e2 += shift;
+        if (m == (uint64_t) 1 << 53) {
+            m >>= 1;
+            e2++;
+        }
+    }
+
+    // always a normal double for the exponents of `var_json_exact`
+    uint64_t raw = ((uint64_t) (e2 + 52 + 1023) << 52) | (m & (((uint64_t) 1 << 52) - 1));
+    double res;
+    memcpy(&res, &raw, sizeof (double));
+    return res;
+}
+
+
+// `mant * 10^exp` correctly rounded, with `exp` within [-27, 27]
+static double var_json_exact(uint64_t mant, int exp) {
+    if (exp >= 0) {
+        return var_json_round((var_json_u128_t) mant * var_json_pow5[exp], exp, false);
+    }
+
+    // divide with at least 64 bits of quotient, the remainder decides ties
+    int shift = __builtin_clzll(mant);
+    var_json_u128_t num = (var_json_u128_t) (mant << shift) << 63;
+    uint64_t div = var_json_pow5[-exp];
+    var_json_u128_t q = num / div;
+    return var_json_round(q, exp - shift - 63, q * div != num);
+}
+#endif  // __SIZEOF_INT128__
+
+
+// number or literal that starts at `at`
+static var_t* var_json_scalar(var_json_t* j, uint32_t at) {
+    const unsigned char* p = j->src + at;
+    const unsigned char* end = j->src + j->len;
+
+    // literals
+    size_t left = (size_t) (end - p);
+    if (*p == 't' || *p == 'f' || *p == 'n') {
+        const char* lit = *p == 't' ? "true" : *p == 'f' ? "false" : "null";
+        size_t n = strlen(lit);
+        if (left < n || (left > n && var_json_is_end(p[n]) == false)) return NULL;
+        if (memcmp(p, lit, n) != 0) return NULL;
+        if (*p == 'n') return var_new_nil();
+        return var_new_int(*p == 't');
+    }
+
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    const unsigned char* q = p;
+    bool neg = *q == '-';
+    if (neg) q++;
+    if (q == end || *q < '0' || *q > '9') return NULL;
+
+    uint64_t mant = 0;
+    size_t digits = 0;      // significant digits in `mant`
+    bool exact = true;      // if all digits fit in `mant`
+    if (*q == '0') {
+        q++;
+    } else {
+        for (; q != end && *q >= '0' && *q <= '9'; q++) {
+            if (digits < 19) {
+                mant = mant * 10 + (uint64_t) (*q - '0');
+                digits++;
+            } else if (digits == 19 && mant <= (UINT64_MAX - (uint64_t) (*q - '0')) / 10) {
+                // the 20th digit may still fit in `uint64_t`
+                mant = mant * 10 + (uint64_t) (*q - '0');
+                digits++;
+            } else {
+                exact = false;
+            }
+        }
+    }
+
+    bool integer = true;
+    int64_t exp = 0;
+    if (q != end && *q == '.') {
+        integer = false;
+        q++;
+        if (q == end || *q < '0' || *q > '9') return NULL;
+        for (; q != end && *q >= '0' && *q <= '9'; q++) {
+            if (digits < 19) {
+                // leading zeros are not significant
+                mant = mant * 10 + (uint64_t) (*q - '0');
+                if (mant != 0) digits++;
+                exp--;
+            } else if (*q != '0') {
+                exact = false;
+            }
+        }
+    }
+    if (q != end && (*q == 'e' || *q == 'E')) {
+        integer = false;
+        q++;
+        bool exp_neg = false;
+        if (q != end && (*q == '+' || *q == '-')) exp_neg = *q++ == '-';
+        if (q == end || *q < '0' || *q > '9') return NULL;
+        int64_t e = 0;
+        for (; q != end && *q >= '0' && *q <= '9'; q++) {
+            if (e < 100000) e = e * 10 + (*q - '0');
+        }
+        exp += exp_neg ? -e : e;
+    }
+    if (q != end && var_json_is_end(*q) == false) return NULL;
+
+    if (integer && exact) {
+        if (neg == false) {
+            if (mant <= INT64_MAX) {
+                var_t* res = var_imm_int((int64_t) mant);
+                return res != NULL ? res : var_new_int((int64_t) mant);
+            }
+            return var_new_uint(mant);
+        }
+        if (mant <= (uint64_t) INT64_MAX + 1) {
+            int64_t i = mant == (uint64_t) INT64_MAX + 1 ? INT64_MIN : -(int64_t) mant;
+            var_t* res = var_imm_int(i);
+            return res != NULL ? res : var_new_int(i);
+        }
+    }
+
+    double f;
+    if (exact && mant <= ((uint64_t) 1 << 53) && exp >= -22 && exp <= 22) {
+        // both `mant` and the power of 10 are exact, so is a single rounding
+        f = (double) mant;
+        f = exp < 0 ? f / var_json_pow10[-exp] : f * var_json_pow10[exp];
+        if (neg) f = -f;
+#ifdef __SIZEOF_INT128__
+    } else if (exact && mant != 0 && exp >= -27 && exp <= 27) {
+        f = var_json_exact(mant, (int) exp);
+        if (neg) f = -f;
+#endif  // __SIZEOF_INT128__
+    } else {
+        // `strtod` needs a terminated copy
+        size_t n = (size_t) (q - p);
+        char small[64];
+        char* buf = n < sizeof (small) ? small : malloc(n + 1);
+        MEM_CHECK(buf);
+        memcpy(buf, p, n);
+        buf[n] = '\0';
+        f = strtod(buf, NULL);
+        if (buf != small) free(buf);
+    }
+    var_t* res = var_imm_float(f);
+    return res != NULL ? res : var_new_float(f);
+}
+
+
+static var_t* var_json_value(var_json_t* j);
+
+static var_t* var_json_list(var_json_t* j) {
+    var_t* res = var_box(VAR_LIST);
+    var_list_init(res, j->count[j->cont++]);
+    var_list_t* list = res->data.l;
+
+    uint32_t at;
+    if (j->pos < j->n && j->src[var_json_peek(j)] == ']') {
+        j->pos++;
+        return res;
+    }
+    for (;;) {
+        var_t* elem = var_json_value(j);
+        if (elem == NULL) break;
+
+        // counts are exact for valid input
+        if (list->len == list->cap) var_list_reserve(res, list->len + 1);
+        list->lv[list->len++] = elem;
+
+        char c = var_json_take(j, &at);
+        if (c == ']') return res;
+        if (c != ',') break;
+    }
+
+    var_delete(res);
+    return NULL;
+}
+
+
+// a duplicated key replaces the earlier one, same as `var_new_dict`
+static void var_json_insert(var_t* dict, var_t* key, var_t* val) {
+    uint64_t hash;
+    var_hash(key, &hash);
+    bool found;
+    var_dict_slot_t* slot = var_dict_emplace(dict, key, hash, &found);
+    if (found) {
+        var_delete(key);
+        var_delete(slot->val);
+    } else {
+        slot->key = key;
+    }
+    slot->val = val;
+}
+
+
+static var_t* var_json_dict(var_json_t* j) {
+    var_t* res = var_box(VAR_DICT);
+    var_dict_init(res, j->count[j->cont++]);
+
+    uint32_t at;
+    if (j->pos < j->n && j->src[var_json_peek(j)] == '}') {
+        j->pos++;
+        return res;
+    }
+    for (;;) {
+        if (var_json_take(j, &at) != '"') break;
+        var_t* key = var_json_string(j, at);
+        if (key == NULL) break;
+        if (var_json_take(j, &at) != ':') {
+            var_delete(key);
+            break;
+        }
+        var_t* val = var_json_value(j);
+        if (val == NULL) {
+            var_delete(key);
+            break;
+        }
+
+        var_json_insert(res, key, val);
+
+        char c = var_json_take(j, &at);
+        if (c == '}') return res;
+        if (c != ',') break;
+    }
+
+    var_delete(res);
+    return NULL;
+}
+
+
+static var_t* var_json_value(var_json_t* j) {
+    if (var_budget_over(0)) return NULL;
+
+    uint32_t at;
+    char c = var_json_take(j, &at);
+    switch (c) {
+        case '{': {
+            if (++j->depth > JSON_DEPTH) return NULL;
+            var_t* res = var_json_dict(j);
+            j->depth--;
+            return res;
+        }
+
+        case '[': {
+            if (++j->depth > JSON_DEPTH) return NULL;
+            var_t* res = var_json_list(j);
+            j->depth--;
+            return res;
+        }
+
+        case '"': return var_json_string(j, at);
+
+        case '\0':
+        case '}':
+        case ']':
+        case ':':
+        case ',': return NULL;
+
+        default: return var_json_scalar(j, at);
+    }
+}
+
+
+/*
+ * parse JSON into `var_t`, allocated from the arena in use if any.
+ * objects become `VAR_DICT` with string keys, arrays `VAR_LIST`, strings `VAR_STRING`.
+ * integers become `VAR_INT`, or `VAR_UINT` above `INT64_MAX`, other numbers `VAR_FLOAT`.
+ * `null` becomes `VAR_NIL`, `true` and `false` become `VAR_INT` 1 and 0.
+ * a duplicated key replaces the earlier one, strings are not checked to be valid UTF-8.
+ *
+ * @param   json    the JSON text, it does not need a `\0` terminator
+ * @param   len     bytes of `json`, less than 4 GB
+ * @return          a new `var_t*`, `NULL` if `json` is not a single valid JSON value
+ */
+var_t* var_from_json(const char* json, size_t len) {
+    if (len >= UINT32_MAX) return NULL;
+
+    var_json_t j = {
+        .src    = (const unsigned char*) json,
+        .len    = len,
+    };
+
+    var_t* res = NULL;
+    if (var_json_index(&j) && var_json_count(&j)) {
+        res = var_json_value(&j);
+        if (res != NULL && j.pos != j.n) {
+            var_delete(res);
+            res = NULL;
+        }
+    }
+
+    free(j.idx);
+    free(j.count);
+    free(j.scratch);
+    return res;
+}
+
+
+/*
+ * JSON is written through a buffer, which is handed to a callback whenever it is full.
+ * clean runs of string bytes are found with SIMD compares and copied at once,
+ * integers are written two digits at a time,
+ * and floats with Grisu2, the shortest digits in most cases and always read back to the same double.
+ */
+
+
+// writer
+
+typedef struct var_json_writer {
+    var_buf_t*      buf;
+    var_json_fn     fn;     // `NULL` to write into `buf` only
+    void*           arg;
+    uint32_t        flag;
+    size_t          depth;  // indentation of `VAR_JSON_PRETTY`
+    bool            ok;
+} var_json_writer_t;
+
+
+static void var_json_flush(var_json_writer_t* w) {
+    if (w->fn == NULL || w->buf->len == 0) return;
+    if (w->ok && w->fn((const char*) w->buf->data, w->buf->len, w->arg) == false) w->ok = false;
+    w->buf->len = 0;
+}
+
+
+static unsigned char* var_json_grow(var_json_writer_t* w, size_t size) {
+    if (w->fn != NULL && w->buf->len + size > JSON_BUF_SIZE) var_json_flush(w);
+    var_buf_reserve(w->buf, size);
+    return w->buf->data + w->buf->len;
+}
+
+
+// room for `size` more bytes, hands the buffer to the callback first if it is full
+static inline unsigned char* var_json_reserve(var_json_writer_t* w, size_t size) {
+    var_buf_t* buf = w->buf;
+    if (buf->cap - buf->len >= size && (w->fn == NULL || buf->len + size <= JSON_BUF_SIZE)) {
+        return buf->data + buf->len;
+    }
+    return var_json_grow(w, size);
+}
+
+
+static void var_json_put(var_json_writer_t* w, const char* str, size_t len) {
+    // large runs skip the buffer
+    if (w->fn != NULL && len > JSON_BUF_SIZE) {
+        var_json_flush(w);
+        if (w->ok && w->fn(str, len, w->arg) == false) w->ok = false;
+        return;
+    }
+    unsigned char* p = var_json_reserve(w, len);
+    memcpy(p, str, len);
+    w->buf->len += len;
+}
+
+
+static inline void var_json_putc(var_json_writer_t* w, char c) {
+    unsigned char* p = var_json_reserve(w, 1);
+    *p = (unsigned char) c;
+    w->buf->len++;
+}
+
+
+// new line and indentation of `VAR_JSON_PRETTY`
+static void var_json_indent(var_json_writer_t* w) {
+    size_t n = 1 + w->depth * 4;
+    unsigned char* p = var_json_reserve(w, n);
+    p[0] = '\n';
+    memset(p + 1, ' ', n - 1);
+    w->buf->len += n;
+}
+
+
+// integers
+
+static const char var_json_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t var_json_pow10_u64[] = {
+    1LLU, 10LLU, 100LLU, 1000LLU, 10000LLU, 100000LLU, 1000000LLU, 10000000LLU,
+    100000000LLU, 1000000000LLU, 10000000000LLU, 100000000000LLU, 1000000000000LLU,
+    10000000000000LLU, 100000000000000LLU, 1000000000000000LLU, 10000000000000000LLU,
+    100000000000000000LLU, 1000000000000000000LLU, 10000000000000000000LLU,
+};
+
+
+// decimal digits of `v`, from its bit length without a loop
+static inline size_t var_json_digits(uint64_t v) {
+    size_t t = ((size_t) (64 - __builtin_clzll(v | 1)) * 1233) >> 12;
+    return t + (v >= var_json_pow10_u64[t]) + (v == 0);
+}
+
+
+// write `v` at `p`, return the number of bytes
+static inline size_t var_json_u64(char* p, uint64_t v) {
+    size_t n = var_json_digits(v);
+    char* q = p + n;
+    while (v >= 100) {
+        q -= 2;
+        memcpy(q, var_json_pairs + (v % 100) * 2, 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        memcpy(q - 2, var_json_pairs + v * 2, 2);
+    } else {
+        q[-1] = (char) ('0' + v);
+    }
+    return n;
+}
+
+
+static inline size_t var_json_i64(char* p, int64_t i) {
+    if (i >= 0) return var_json_u64(p, (uint64_t) i);
+    *p = '-';
+    return 1 + var_json_u64(p + 1, (uint64_t) 0 - (uint64_t) i);
+}
+
+
+// floats, Grisu2 by Florian Loitsch
+
+// `f * 2^e`
+typedef struct var_json_fp {
+    uint64_t    f;
+    int         e;
+} var_json_fp_t;
+
+// 10^k of `k = -348 + 8 * i`, normalized to 64 bits
+static const uint64_t var_json_cached_f[] = {
+    0xfa8fd5a0081c0288LLU, 0xbaaee17fa23ebf76LLU, 0x8b16fb203055ac76LLU,
+    0xcf42894a5dce35eaLLU, 0x9a6bb0aa55653b2dLLU, 0xe61acf033d1a45dfLLU,
+    0xab70fe17c79ac6caLLU, 0xff77b1fcbebcdc4fLLU, 0xbe5691ef416bd60cLLU,
+    0x8dd01fad907ffc3cLLU, 0xd3515c2831559a83LLU, 0x9d71ac8fada6c9b5LLU,
+    0xea9c227723ee8bcbLLU, 0xaecc49914078536dLLU, 0x823c12795db6ce57LLU,
+    0xc21094364dfb5637LLU, 0x9096ea6f3848984fLLU, 0xd77485cb25823ac7LLU,
+    0xa086cfcd97bf97f4LLU, 0xef340a98172aace5LLU, 0xb23867fb2a35b28eLLU,
+    0x84c8d4dfd2c63f3bLLU, 0xc5dd44271ad3cdbaLLU, 0x936b9fcebb25c996LLU,
+    0xdbac6c247d62a584LLU, 0xa3ab66580d5fdaf6LLU, 0xf3e2f893dec3f126LLU,
+    0xb5b5ada8aaff80b8LLU, 0x87625f056c7c4a8bLLU, 0xc9bcff6034c13053LLU,
+    0x964e858c91ba2655LLU, 0xdff9772470297ebdLLU, 0xa6dfbd9fb8e5b88fLLU,
+    0xf8a95fcf88747d94LLU, 0xb94470938fa89bcfLLU, 0x8a08f0f8bf0f156bLLU,
+    0xcdb02555653131b6LLU, 0x993fe2c6d07b7facLLU, 0xe45c10c42a2b3b06LLU,
+    0xaa242499697392d3LLU, 0xfd87b5f28300ca0eLLU, 0xbce5086492111aebLLU,
+    0x8cbccc096f5088ccLLU, 0xd1b71758e219652cLLU, 0x9c40000000000000LLU,
+    0xe8d4a51000000000LLU, 0xad78ebc5ac620000LLU, 0x813f3978f8940984LLU,
+    0xc097ce7bc90715b3LLU, 0x8f7e32ce7bea5c70LLU, 0xd5d238a4abe98068LLU,
+    0x9f4f2726179a2245LLU, 0xed63a231d4c4fb27LLU, 0xb0de65388cc8ada8LLU,
+    0x83c7088e1aab65dbLLU, 0xc45d1df942711d9aLLU, 0x924d692ca61be758LLU,
+    0xda01ee641a708deaLLU, 0xa26da3999aef774aLLU, 0xf209787bb47d6b85LLU,
+    0xb454e4a179dd1877LLU, 0x865b86925b9bc5c2LLU, 0xc83553c5c8965d3dLLU,
+    0x952ab45cfa97a0b3LLU, 0xde469fbd99a05fe3LLU, 0xa59bc234db398c25LLU,
+    0xf6c69a72a3989f5cLLU, 0xb7dcbf5354e9beceLLU, 0x88fcf317f22241e2LLU,
+    0xcc20ce9bd35c78a5LLU, 0x98165af37b2153dfLLU, 0xe2a0b5dc971f303aLLU,
+    0xa8d9d1535ce3b396LLU, 0xfb9b7cd9a4a7443cLLU, 0xbb764c4ca7a44410LLU,
+    0x8bab8eefb6409c1aLLU, 0xd01fef10a657842cLLU, 0x9b10a4e5e9913129LLU,
+    0xe7109bfba19c0c9dLLU, 0xac2820d9623bf429LLU, 0x80444b5e7aa7cf85LLU,
+    0xbf21e44003acdd2dLLU, 0x8e679c2f5e44ff8fLLU, 0xd433179d9c8cb841LLU,
+    0x9e19db92b4e31ba9LLU, 0xeb96bf6ebadf77d9LLU, 0xaf87023b9bf0ee6bLLU,
+};
+
+static const int16_t var_json_cached_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066,
+};
+
+
+// product rounded to 64 bits
+static inline var_json_fp_t var_json_fp_mul(var_json_fp_t x, var_json_fp_t y) {
+    const uint64_t mask = 0xffffffffLLU;
+    uint64_t a = x.f >> 32, b = x.f & mask;
+    uint64_t c = y.f >> 32, d = y.f & mask;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t mid = (bd >> 32) + (ad & mask) + (bc & mask) + ((uint64_t) 1 << 31);
+    var_json_fp_t res = { ac + (ad >> 32) + (bc >> 32) + (mid >> 32), x.e + y.e + 64 };
+    return res;
+}
+
+
+static inline var_json_fp_t var_json_fp_normalize(var_json_fp_t x) {
+    int s = __builtin_clzll(x.f);
+    var_json_fp_t res = { x.f << s, x.e - s };
+    return res;
+}
+
+
+// move the last digit towards `w` while it stays inside of the interval
+static inline void var_json_grisu_round(char* buf, int len, uint64_t delta, uint64_t rest,
+                                        uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+
+static void var_json_grisu_digits(var_json_fp_t w, var_json_fp_t mp, uint64_t delta,
+                                  char* buf, int* len, int* k) {
+    var_json_fp_t one = { (uint64_t) 1 << -mp.e, mp.e };
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t) (mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = (int) var_json_digits(p1);
+    *len = 0;
+
+    // integral part
+    while (kappa > 0) {
+        // constant divisors become multiplications
+        uint32_t d;
+        switch (kappa) {
+            case 10: d = p1 / 1000000000; p1 %= 1000000000; break;
+            case 9: d = p1 / 100000000; p1 %= 100000000; break;
+            case 8: d = p1 / 10000000; p1 %= 10000000; break;
+            case 7: d = p1 / 1000000; p1 %= 1000000; break;
+            case 6: d = p1 / 100000; p1 %= 100000; break;
+            case 5: d = p1 / 10000; p1 %= 10000; break;
+            case 4: d = p1 / 1000; p1 %= 1000; break;
+            case 3: d = p1 / 100; p1 %= 100; break;
+            case 2: d = p1 / 10; p1 %= 10; break;
+            default: d = p1; p1 = 0; break;
+        }
+        if (d != 0 || *len != 0) buf[(*len)++] = (char) ('0' + d);
+        kappa--;
+        uint64_t rest = ((uint64_t) p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            var_json_grisu_round(buf, *len, delta, rest, var_json_pow10_u64[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    // fractional part
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char) (p2 >> -one.e);
+        if (d != 0 || *len != 0) buf[(*len)++] = (char) ('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            int index = -kappa;
+            var_json_grisu_round(buf, *len, delta, p2, one.f, wp_w * (index < 20 ? var_json_pow10_u64[index] : 0));
+            return;
+        }
+    }
+}
+
+
+// digits of a positive finite `f` into `buf`, `f = buf * 10^k`
+static void var_json_grisu(double f, char* buf, int* len, int* k) {
+    uint64_t raw;
+    memcpy(&raw, &f, sizeof (double));
+    int biased = (int) (raw >> 52);
+    var_json_fp_t v = { raw & (((uint64_t) 1 << 52) - 1), biased - 1075 };
+    if (biased != 0) {
+        v.f += (uint64_t) 1 << 52;
+    } else {
+        v.e = -1074;
+    }
+
+    // boundaries halfway to the neighbours, `plus` normalized and `minus` at the same exponent
+    var_json_fp_t plus = var_json_fp_normalize((var_json_fp_t) { (v.f << 1) + 1, v.e - 1 });
+    var_json_fp_t minus = v.f == (uint64_t) 1 << 52
+        ? (var_json_fp_t) { (v.f << 2) - 1, v.e - 2 }
+        : (var_json_fp_t) { (v.f << 1) - 1, v.e - 1 };
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    // cached power that brings the exponent into [-60, -32]
+    double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    int ik = (int) dk;
+    if (dk - ik > 0.0) ik++;
+    size_t index = (size_t) ((ik >> 3) + 1);
+    *k = -(-348 + (int) (index << 3));
+    var_json_fp_t c = { var_json_cached_f[index], var_json_cached_e[index] };
+
+    var_json_fp_t w = var_json_fp_mul(var_json_fp_normalize(v), c);
+    var_json_fp_t wp = var_json_fp_mul(plus, c);
+    var_json_fp_t wm = var_json_fp_mul(minus, c);
+    wm.f++;
+    wp.f--;
+    var_json_grisu_digits(w, wp, wp.f - wm.f, buf, len, k);
+}
+
+
+static inline size_t var_json_exponent(char* p, int e) {
+    size_t n = 0;
+    p[n++] = 'e';
+    if (e < 0) {
+        p[n++] = '-';
+        e = -e;
+    }
+    return n + var_json_u64(p + n, (uint64_t) e);
+}
+
+
+// place the decimal point in `len` digits of `buf * 10^k`, floats always have `.` or `e`
+static size_t var_json_point(char* buf, int len, int k) {
+    int kk = len + k;   // 10^(kk - 1) <= v < 10^kk
+
+    if (k >= 0 && kk <= 21) {
+        // 1234e7 -> 12340000000.0
+        memset(buf + len, '0', (size_t) (kk - len));
+        buf[kk] = '.';
+        buf[kk + 1] = '0';
+        return (size_t) kk + 2;
+    }
+    if (kk > 0 && kk <= 21) {
+        // 1234e-2 -> 12.34
+        memmove(buf + kk + 1, buf + kk, (size_t) (len - kk));
+        buf[kk] = '.';
+        return (size_t) len + 1;
+    }
+    if (kk > -6 && kk <= 0) {
+        // 1234e-6 -> 0.001234
+        int offset = 2 - kk;
+        memmove(buf + offset, buf, (size_t) len);
+        buf[0] = '0';
+        buf[1] = '.';
+        memset(buf + 2, '0', (size_t) (offset - 2));
+        return (size_t) (len + offset);
+    }
+    if (len == 1) {
+        // 1e30
+        return 1 + var_json_exponent(buf + 1, kk - 1);
+    }
+    // 1234e30 -> 1.234e33
+    memmove(buf + 2, buf + 1, (size_t) len - 1);
+    buf[1] = '.';
+    return (size_t) len + 1 + var_json_exponent(buf + len + 1, kk - 1);
+}
+
+
+// write a finite `f` at `p`, at most `JSON_FLOAT_SIZE` bytes
+static size_t var_json_f64(char* p, double f) {
+    uint64_t raw;
+    memcpy(&raw, &f, sizeof (double));
+    size_t n = 0;
+    if (raw >> 63) {
+        p[n++] = '-';
+        raw &= ~((uint64_t) 1 << 63);
+        memcpy(&f, &raw, sizeof (double));
+    }
+    if (raw == 0) {
+        memcpy(p + n, "0.0", 3);
+        return n + 3;
+    }
+
+    int len, k;
+    var_json_grisu(f, p + n, &len, &k);
+    return n + var_json_point(p + n, len, k);
+}
+
+
+// strings
+
+// bytes at `p` before the first one that needs escape
+static inline size_t var_json_clean(const unsigned char* p, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (p + i));
+        __m128i esc = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+            // bytes no greater than 0x1f saturate to 0
+            _mm_cmpeq_epi8(_mm_subs_epu8(v, _mm_set1_epi8(0x1f)), _mm_setzero_si128()));
+        uint32_t m = (uint32_t) _mm_movemask_epi8(esc);
+        if (m != 0) return i + (size_t) __builtin_ctz(m);
+    }
+#endif  // __SSE2__
+    for (; i < len; i++) {
+        if (p[i] == '"' || p[i] == '\\' || p[i] < 0x20) break;
+    }
+    return i;
+}
+
+
+static void var_json_write_str(var_json_writer_t* w, const char* str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+
+    var_json_putc(w, '"');
+    for (size_t i = 0; i < len;) {
+        size_t n = var_json_clean((const unsigned char*) str + i, len - i);
+        if (n > 0) {
+            var_json_put(w, str + i, n);
+            i += n;
+            if (i == len) break;
+        }
+
+        unsigned char c = (unsigned char) str[i++];
+        unsigned char* p = var_json_reserve(w, 6);
+        p[0] = '\\';
+        switch (c) {
+            case '"': p[1] = '"'; break;
+            case '\\': p[1] = '\\'; break;
+            case '\b': p[1] = 'b'; break;
+            case '\f': p[1] = 'f'; break;
+            case '\n': p[1] = 'n'; break;
+            case '\r': p[1] = 'r'; break;
+            case '\t': p[1] = 't'; break;
+            default: {
+                memcpy(p + 1, "u00", 3);
+                p[4] = hex[c >> 4];
+                p[5] = hex[c & 0xf];
+                w->buf->len += 4;
+            }
+        }
+        w->buf->len += 2;
+    }
+    var_json_putc(w, '"');
+}
+
+
+static void var_json_write_f64(var_json_writer_t* w, double f) {
+    // NaN and infinities are not JSON
+    uint64_t raw;
+    memcpy(&raw, &f, sizeof (double));
+    if (((raw >> 52) & 0x7ff) == 0x7ff) {
+        w->ok = false;
+        return;
+    }
+    unsigned char* p = var_json_reserve(w, JSON_FLOAT_SIZE);
+    w->buf->len += var_json_f64((char*) p, f);
+}
+
+
+static void var_json_write(var_json_writer_t* w, const var_t* var);
+
+// keys are strings, numbers are quoted
+static void var_json_write_key(var_json_writer_t* w, const var_t* key) {
+    switch (var_typeof(key)) {
+        case VAR_STRING: {
+            var_json_write_str(w, var_str(key), var_str_len(key));
+        }
+        return;
+
+        case VAR_INT:
+        case VAR_UINT:
+        case VAR_FLOAT: {
+            var_json_putc(w, '"');
+            var_json_write(w, key);
+            var_json_putc(w, '"');
+        }
+        return;
+
+        default: {
+            w->ok = false;
+        }
+    }
+}
+
+
+static void var_json_write_seq(var_json_writer_t* w, var_t* const* elem, size_t len) {
+    bool pretty = (w->flag & VAR_JSON_PRETTY) != 0;
+    var_json_putc(w, '[');
+    if (len == 0) {
+        var_json_putc(w, ']');
+        return;
+    }
+
+    w->depth++;
+    for (size_t i = 0; i < len && w->ok; i++) {
+        if (i > 0) var_json_putc(w, ',');
+        if (pretty) var_json_indent(w);
+        var_json_write(w, elem[i]);
+    }
+    w->depth--;
+    if (pretty) var_json_indent(w);
+    var_json_putc(w, ']');
+}
+
+
+static void var_json_write(var_json_writer_t* w, const var_t* var) {
+    switch (var_typeof(var)) {
+        case VAR_NIL: {
+            var_json_put(w, "null", 4);
+        }
+        break;
+
+        case VAR_INT: {
+            unsigned char* p = var_json_reserve(w, 20);
+            w->buf->len += var_json_i64((char*) p, var_int_of(var));
+        }
+        break;
+
+        case VAR_UINT: {
+            unsigned char* p = var_json_reserve(w, 20);
+            w->buf->len += var_json_u64((char*) p, var_uint_of(var));
+        }
+        break;
+
+        case VAR_FLOAT: {
+            var_json_write_f64(w, var_float_of(var));
+        }
+        break;
+
+        case VAR_STRING: {
+            var_json_write_str(w, var_str(var), var_str_len(var));
+        }
+        break;
+
+        case VAR_ARRAY: {
+            var_json_write_seq(w, var->data.a->av, var->data.a->len);
+        }
+        break;
+
+        case VAR_LIST: {
+            var_json_write_seq(w, var->data.l->lv, var->data.l->len);
+        }
+        break;
+
+        case VAR_DICT: {
+            bool pretty = (w->flag & VAR_JSON_PRETTY) != 0;
+            var_dict_t* dict = var->data.d;
+            var_json_putc(w, '{');
+            if (var_dict_len(dict) == 0) {
+                var_json_putc(w, '}');
+                break;
+            }
+
+            w->depth++;
+            size_t t = 0, pos = 0;
+            bool first = true;
+            for (var_dict_slot_t* slot; w->ok && (slot = var_dict_next(dict, &t, &pos)) != NULL; first = false) {
+                if (first == false) var_json_putc(w, ',');
+                if (pretty) var_json_indent(w);
+                var_json_write_key(w, slot->key);
+                if (pretty) {
+                    var_json_put(w, ": ", 2);
+                } else {
+                    var_json_putc(w, ':');
+                }
+                var_json_write(w, slot->val);
+            }
+            w->depth--;
+            if (pretty) var_json_indent(w);
+            var_json_putc(w, '}');
+        }
+        break;
+
+        default: {
+            ERRO("corrupted var");
+        }
+    }
+}
+
+
+/*
+ * append `var` as JSON to `buf`, dicts are written in no particular order.
+ * floats always have `.` or `e`, so `var_from_json` reads them back as `VAR_FLOAT`.
+ *
+ * @param   var     the `var_t*` to write
+ * @param   buf     a buffer from `var_buf_init`, it grows as needed
+ * @param   flag    0 or `VAR_JSON_PRETTY`
+ * @return          false if `var` has NaN, infinities, or dict keys other than strings and numbers,
+ *                  `buf` is left as it was
+ */
+bool var_to_json(const var_t* var, var_buf_t* buf, uint32_t flag) {
+    size_t len = buf->len;
+    var_json_writer_t w = { .buf = buf, .fn = NULL, .arg = NULL, .flag = flag, .depth = 0, .ok = true };
+    var_json_write(&w, var);
+    if (w.ok == false) buf->len = len;
+    return w.ok;
+}
+
+
+/*
+ * write `var` as JSON in chunks of at most 64 KB, besides long strings which are passed at once.
+ * the document is never buffered as a whole.
+ *
+ * @param   var     the `var_t*` to write
+ * @param   fn      called with every chunk, return false to stop
+ * @param   arg     passed to `fn`
+ * @param   flag    0 or `VAR_JSON_PRETTY`
+ * @return          false if `fn` failed, or `var` cannot be written as in `var_to_json`,
+ *                  chunks before the failure are already passed
+ */
+bool var_to_json_stream(const var_t* var, var_json_fn fn, void* arg, uint32_t flag) {
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_json_writer_t w = { .buf = &buf, .fn = fn, .arg = arg, .flag = flag, .depth = 0, .ok = true };
+    var_json_write(&w, var);
+    var_json_flush(&w);
+    var_buf_free(&buf);
+    return w.ok;
+}
+
+
+static bool var_json_fwrite(const char* data, size_t len, void* arg) {
+    return fwrite(data, 1, len, arg) == len;
+}
+
+
+/*
+ * write `var` as JSON to `fp`, see `var_to_json_stream`
+ *
+ * @param   var     the `var_t*` to write
+ * @param   fp      the file to write to
+ * @param   flag    0 or `VAR_JSON_PRETTY`
+ * @return          false if writing failed, or `var` cannot be written as in `var_to_json`
+ */
+bool var_to_json_file(const var_t* var, FILE* fp, uint32_t flag) {
+    return var_to_json_stream(var, var_json_fwrite, fp, flag);
+}
+
+
+/*
+ * the streaming reader is a state machine over the bytes of every chunk, it needs no index.
+ * strings, numbers and literals that are split between chunks are collected in `token`,
+ * the others are parsed in place.
+ * values are made in an arena of the reader, which is reset after every event or record,
+ * so memory is bounded by the longest token and the largest record, not by the input.
+ */
+
+
+// streaming reader
+
+// what the reader expects next
+enum {
+    JSON_READ_VALUE,        // a value, at the top level also the end of input
+    JSON_READ_VALUE_CLOSE,  // a value or `]`, after `[`
+    JSON_READ_KEY,          // a key, after `,` in an object
+    JSON_READ_KEY_CLOSE,    // a key or `}`, after `{`
+    JSON_READ_COLON,
+    JSON_READ_NEXT,         // `,` or the end of the container
+};
+
+struct var_json_reader {
+    var_json_event_fn   event;      // one of `event` and `record` is `NULL`
+    var_json_record_fn  record;
+    void*               arg;
+    var_arena_t*        arena;      // values of the current event or record
+    var_arena_t*        prev;       // arena of the caller during `var_json_reader_feed`
+    var_json_t          json;       // scratch of unescaped strings
+    var_buf_t           token;      // bytes of a token that is split between chunks
+    bool                in_token;
+    bool                in_string;  // if `token` is a string, else a number or literal
+    bool                escape;     // if `token` ends with an escaping backslash
+    bool                failed;
+    int                 state;
+    size_t              depth;
+    size_t              base;       // depth of records, 1 inside of a top level array
+    char                open[JSON_DEPTH];           // `[` or `{` of the open containers
+    var_t*              build[JSON_DEPTH + 1];      // open containers of the record, by depth
+    var_t*              key[JSON_DEPTH + 1];        // key of the next value of an open dict
+};
+
+
+static var_json_reader_t* var_json_reader_alloc(var_json_event_fn event, var_json_record_fn record, void* arg) {
+    var_json_reader_t* res = calloc(1, sizeof (var_json_reader_t));
+    MEM_CHECK(res);
+    res->event = event;
+    res->record = record;
+    res->arg = arg;
+    res->arena = var_arena_new(0);
+    var_buf_init(&res->token);
+    res->state = JSON_READ_VALUE;
+    return res;
+}
+
+
+/*
+ * create a reader that passes the input to `fn` as events.
+ * `val` of `VAR_JSON_KEY` and `VAR_JSON_VALUE` is freed when `fn` returns, `NULL` for the other events.
+ *
+ * @param   fn      the callback of events, which returns false to stop reading
+ * @param   arg     the last argument of `fn`
+ * @return          a new reader, free it with `var_json_reader_delete`
+ */
+var_json_reader_t* var_json_reader_new(var_json_event_fn fn, void* arg) {
+    return var_json_reader_alloc(fn, NULL, arg);
+}
+
+
+/*
+ * create a reader that builds records and passes them to `fn` one at a time.
+ * records are the elements of a top level array, or the top level values that are not arrays.
+ * a record is freed when `fn` returns, its memory is reused for the next one, keep it with `var_copy`.
+ * values are converted as in `var_from_json`.
+ *
+ * @param   fn      the callback of records, which returns false to stop reading
+ * @param   arg     the last argument of `fn`
+ * @return          a new reader, free it with `var_json_reader_delete`
+ */
+var_json_reader_t* var_json_reader_new_record(var_json_record_fn fn, void* arg) {
+    return var_json_reader_alloc(NULL, fn, arg);
+}
+
+
+/*
+ * free `reader`, and the values of a record it did not finish
+ */
+void var_json_reader_delete(var_json_reader_t* reader) {
+    var_arena_delete(reader->arena);
+    var_buf_free(&reader->token);
+    free(reader->json.scratch);
+    free(reader);
+}
+
+
+// pass an event to the callback in the arena of the caller
+static bool var_json_reader_emit(var_json_reader_t* r, var_json_event_t event, const var_t* val) {
+    var_arena_use(r->prev);
+    bool res = r->event(event, val, r->arg);
+    var_arena_reset(r->arena);
+    var_arena_use(r->arena);
+    return res;
+}
+
+
+// pass a record to the callback in the arena of the caller
+static bool var_json_reader_deliver(var_json_reader_t* r, var_t* record) {
+    var_arena_use(r->prev);
+    bool res = r->record(record, r->arg);
+    var_arena_reset(r->arena);
+    var_arena_use(r->arena);
+    return res;
+}
+
+
+static bool var_json_reader_open(var_json_reader_t* r, char c) {
+    if (r->state != JSON_READ_VALUE && r->state != JSON_READ_VALUE_CLOSE) return false;
+    if (r->depth == JSON_DEPTH) return false;
+
+    if (r->event != NULL) {
+        if (var_json_reader_emit(r, c == '[' ? VAR_JSON_ARRAY_BEGIN : VAR_JSON_OBJECT_BEGIN, NULL) == false) {
+            return false;
+        }
+    } else {
+        if (r->depth == 0) r->base = c == '[';
+        if (r->depth >= r->base) {
+            var_t* res = var_box(c == '[' ? VAR_LIST : VAR_DICT);
+            if (c == '[') var_list_init(res, 0);
+            else var_dict_init(res, 0);
+            r->build[r->depth + 1] = res;
+        }
+    }
+
+    r->open[r->depth++] = c;
+    r->state = c == '[' ? JSON_READ_VALUE_CLOSE : JSON_READ_KEY_CLOSE;
+    return true;
+}
+
+
+// `val` is complete at the current depth
+static bool var_json_reader_value(var_json_reader_t* r, var_t* val) {
+    bool res = true;
+    if (r->event != NULL) {
+        res = var_json_reader_emit(r, VAR_JSON_VALUE, val);
+    } else if (r->depth == r->base) {
+        res = var_json_reader_deliver(r, val);
+    } else {
+        var_t* parent = r->build[r->depth];
+        if (parent->type == VAR_LIST) {
+            var_list_t* list = parent->data.l;
+            if (list->len == list->cap) var_list_reserve(parent, list->cap < LIST_SIZE ? LIST_SIZE : list->cap * 2);
+            list->lv[list->len++] = val;
+        } else {
+            var_json_insert(parent, r->key[r->depth], val);
+        }
+    }
+    r->state = r->depth == 0 ? JSON_READ_VALUE : JSON_READ_NEXT;
+    return res;
+}
+
+
+static bool var_json_reader_close(var_json_reader_t* r, char c) {
+    char open = c == ']' ? '[' : '{';
+    int empty = c == ']' ? JSON_READ_VALUE_CLOSE : JSON_READ_KEY_CLOSE;
+    if (r->depth == 0 || r->open[r->depth - 1] != open) return false;
+    if (r->state != JSON_READ_NEXT && r->state != empty) return false;
+
+    r->depth--;
+    if (r->event != NULL) {
+        r->state = r->depth == 0 ? JSON_READ_VALUE : JSON_READ_NEXT;
+        return var_json_reader_emit(r, c == ']' ? VAR_JSON_ARRAY_END : VAR_JSON_OBJECT_END, NULL);
+    }
+    if (r->depth >= r->base) return var_json_reader_value(r, r->build[r->depth + 1]);
+
+    // end of the top level array
+    r->base = 0;
+    r->state = JSON_READ_VALUE;
+    return true;
+}
+
+
+// a string or scalar token of `len` bytes at `p` is complete, quotes are not included
+static bool var_json_reader_token(var_json_reader_t* r, const unsigned char* p, size_t len, bool string) {
+    var_t* val;
+    if (string) {
+        val = var_json_string_raw(&r->json, p, len);
+    } else {
+        var_json_t j = { .src = p, .len = len };
+        val = var_json_scalar(&j, 0);
+    }
+    if (val == NULL) return false;
+
+    if (r->state == JSON_READ_KEY || r->state == JSON_READ_KEY_CLOSE) {
+        r->state = JSON_READ_COLON;
+        if (r->event != NULL) return var_json_reader_emit(r, VAR_JSON_KEY, val);
+        r->key[r->depth] = val;
+        return true;
+    }
+    return var_json_reader_value(r, val);
+}
+
+
+// closing quote at or after `p`, `end` if it is not in this chunk
+static const unsigned char* var_json_reader_quote(const unsigned char* p, const unsigned char* end, bool* escape) {
+    if (*escape && p != end) {
+        *escape = false;
+        p++;
+    }
+    while (p != end) {
+        // control characters are left to `var_json_string_raw`
+        p += var_json_clean(p, (size_t) (end - p));
+        if (p == end) break;
+        if (*p == '"') return p;
+        if (*p == '\\' && ++p == end) {
+            *escape = true;
+            break;
+        }
+        p++;
+    }
+    return end;
+}
+
+
+// end of the number or literal at `p`
+static inline const unsigned char* var_json_reader_scalar_end(const unsigned char* p, const unsigned char* end) {
+    while (p != end && var_json_is_end(*p) == false) p++;
+    return p;
+}
+
+
+// continue the token in `token` with the bytes at `*p`
+static bool var_json_reader_resume(var_json_reader_t* r, const unsigned char** p, const unsigned char* end) {
+    const unsigned char* q = r->in_string
+        ? var_json_reader_quote(*p, end, &r->escape)
+        : var_json_reader_scalar_end(*p, end);
+
+    size_t n = (size_t) (q - *p);
+    if (n > 0) {
+        var_buf_reserve(&r->token, n);
+        memcpy(r->token.data + r->token.len, *p, n);
+        r->token.len += n;
+    }
+    if (q == end) {
+        *p = end;
+        return true;
+    }
+
+    r->in_token = false;
+    *p = r->in_string ? q + 1 : q;
+    // an empty string has no bytes in `token`
+    const unsigned char* data = r->token.len > 0 ? r->token.data : (const unsigned char*) "";
+    bool res = var_json_reader_token(r, data, r->token.len, r->in_string);
+    r->token.len = 0;
+    return res;
+}
+
+
+// start a token at `*p`, it is kept in `token` if the chunk ends before it
+static bool var_json_reader_start(var_json_reader_t* r, const unsigned char** p, const unsigned char* end) {
+    bool string = **p == '"';
+    switch (r->state) {
+        case JSON_READ_VALUE:
+        case JSON_READ_VALUE_CLOSE: break;
+
+        case JSON_READ_KEY:
+        case JSON_READ_KEY_CLOSE: {
+            if (string == false) return false;
+        }
+        break;
+
+        default: return false;
+    }
+
+    const unsigned char* s = string ? *p + 1 : *p;
+    bool escape = false;
+    const unsigned char* q = string ? var_json_reader_quote(s, end, &escape) : var_json_reader_scalar_end(s, end);
+    if (q != end) {
+        *p = string ? q + 1 : q;
+        return var_json_reader_token(r, s, (size_t) (q - s), string);
+    }
+
+    size_t n = (size_t) (end - s);
+    r->token.len = 0;
+    if (n > 0) {
+        var_buf_reserve(&r->token, n);
+        memcpy(r->token.data, s, n);
+        r->token.len = n;
+    }
+    r->in_token = true;
+    r->in_string = string;
+    r->escape = escape;
+    *p = end;
+    return true;
+}
+
+
+/*
+ * read the next chunk of input, chunks may split the input anywhere.
+ * the input is a JSON value, or a sequence of them separated by spaces or not, such as JSON lines.
+ *
+ * @param   reader  the reader
+ * @param   data    the next bytes of input
+ * @param   len     bytes of `data`
+ * @return          false if the input is not valid JSON or a callback returned false,
+ *                  the reader fails for the rest of the input
+ */
+bool var_json_reader_feed(var_json_reader_t* reader, const char* data, size_t len) {
+    var_json_reader_t* r = reader;
+    if (r->failed) return false;
+
+    r->prev = var_arena_use(r->arena);
+    const unsigned char* p = (const unsigned char*) data;
+    const unsigned char* end = p + len;
+    bool ok = true;
+    while (ok && p != end) {
+        if (r->in_token) {
+            ok = var_json_reader_resume(r, &p, end);
+            continue;
+        }
+
+        unsigned char c = *p;
+        switch (c) {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r': {
+                p++;
+            }
+            break;
+
+            case '{':
+            case '[': {
+                ok = var_json_reader_open(r, (char) c);
+                p++;
+            }
+            break;
+
+            case '}':
+            case ']': {
+                ok = var_json_reader_close(r, (char) c);
+                p++;
+            }
+            break;
+
+            case ':': {
+                ok = r->state == JSON_READ_COLON;
+                r->state = JSON_READ_VALUE;
+                p++;
+            }
+            break;
+
+            case ',': {
+                // `JSON_READ_NEXT` is inside of a container only
+                ok = r->state == JSON_READ_NEXT;
+                if (ok) r->state = r->open[r->depth - 1] == '{' ? JSON_READ_KEY : JSON_READ_VALUE;
+                p++;
+            }
+            break;
+
+            default: {
+                ok = var_json_reader_start(r, &p, end);
+            }
+        }
+    }
+    var_arena_use(r->prev);
+
+    if (ok == false) {
+        r->failed = true;
+        var_arena_reset(r->arena);
+    }
+    return ok;
+}
+
+
+/*
+ * end of input, a number or literal at the end is read.
+ * the reader is ready for another input afterwards, also if this one failed.
+ *
+ * @param   reader  the reader
+ * @return          false if the input is incomplete or failed before
+ */
+bool var_json_reader_end(var_json_reader_t* reader) {
+    var_json_reader_t* r = reader;
+    bool ok = r->failed == false;
+    if (ok && r->in_token) {
+        r->prev = var_arena_use(r->arena);
+        ok = r->in_string == false && var_json_reader_token(r, r->token.data, r->token.len, false);
+        var_arena_use(r->prev);
+    }
+    ok = ok && r->depth == 0;
+
+    var_arena_reset(r->arena);
+    r->token.len = 0;
+    r->in_token = false;
+    r->failed = false;
+    r->state = JSON_READ_VALUE;
+    r->depth = 0;
+    r->base = 0;
+    return ok;
+}
+
+
+/*
+ * read JSON from `fp` in chunks and pass its records to `fn`, see `var_json_reader_new_record`
+ *
+ * @param   fp      the file to read
+ * @param   fn      the callback of records, which returns false to stop reading
+ * @param   arg     the last argument of `fn`
+ * @return          false if reading failed, the input is not valid JSON, or `fn` returned false
+ */
+bool var_json_read_file(FILE* fp, var_json_record_fn fn, void* arg) {
+    var_json_reader_t* r = var_json_reader_new_record(fn, arg);
+    char* buf = malloc(JSON_BUF_SIZE);
+    MEM_CHECK(buf);
+
+    bool ok = true;
+    size_t n;
+    while (ok && (n = fread(buf, 1, JSON_BUF_SIZE, fp)) > 0) {
+        ok = var_json_reader_feed(r, buf, n);
+    }
+    ok = var_json_reader_end(r) && ok && ferror(fp) == 0;
+
+    free(buf);
+    var_json_reader_delete(r);
+    return ok;
+}
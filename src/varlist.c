@@ -0,0 +1,138 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * `VAR_LIST` is a contiguous array of `var_t*` that grows geometrically.
+ * empty list does not allocate the array, the first allocation holds `LIST_SIZE` elements.
+ */
+
+
+/*
+ * allocate the list of `var`
+ *
+ * @param   var     a `var_t*` of type `VAR_LIST`
+ * @param   size    number of elements to reserve
+ */
+void var_list_init(var_t* var, size_t size) {
+    var_list_t* list = var_alloc_for(var, sizeof (var_list_t));
+    MEM_CHECK(list);
+    var_ref_init(&list->ref);
+    list->len   = 0;
+    list->cap   = 0;
+    list->lv    = NULL;
+    var->data.l = list;
+
+    if (size > 0) var_list_reserve(var, size);
+}
+
+
+/*
+ * make sure the list of `var` holds at least `size` elements without reallocation
+ */
+void var_list_reserve(var_t* var, size_t size) {
+    var_list_t* list = var->data.l;
+    if (size <= list->cap) return;
+
+    if (list->lv == NULL) {
+        list->lv = var_alloc_for(var, sizeof (var_t*) * size);
+    } else {
+        list->lv = var_realloc(var, list->lv, sizeof (var_t*) * list->cap, sizeof (var_t*) * size);
+    }
+    MEM_CHECK(list->lv);
+    list->cap = size;
+}
+
+
+// room for one more element
+static inline void var_list_grow(var_t* var) {
+    var_list_t* list = var->data.l;
+    if (list->len < list->cap) return;
+    var_list_reserve(var, list->cap < LIST_SIZE ? LIST_SIZE : list->cap * 2);
+}
+
+
+static inline void var_list_check(const var_t* var) {
+    if (var_typeof(var) != VAR_LIST) {
+        ERRO("expected type `VAR_LIST`");
+    }
+}
+
+
+/*
+ * random access in O(1)
+ *
+ * @param   var     a `var_t*` of type `VAR_LIST`
+ * @param   index   index of the element
+ * @return          the element owned by the list
+ */
+var_t* var_list_at(const var_t* var, size_t index) {
+    var_list_check(var);
+    if (index >= var->data.l->len) {
+        ERRO("list index out of range");
+    }
+    return var->data.l->lv[index];
+}
+
+
+/*
+ * append `elem` to the end of the list in amortized O(1), the list takes `elem`
+ *
+ * @param   var     a `var_t*` of type `VAR_LIST`
+ * @param   elem    the element
+ */
+void var_list_push(var_t* var, var_t* elem) {
+    var_list_check(var);
+    var_unshare(var);
+    var_list_grow(var);
+    var_list_t* list = var->data.l;
+    list->lv[list->len++] = elem;
+}
+
+
+/*
+ * remove the last element of the list, the caller takes it
+ *
+ * @param   var     a `var_t*` of type `VAR_LIST`
+ * @return          the last element, `NULL` if the list is empty
+ */
+var_t* var_list_pop(var_t* var) {
+    var_list_check(var);
+    var_unshare(var);
+    var_list_t* list = var->data.l;
+    if (list->len == 0) return NULL;
+    return list->lv[--list->len];
+}
+
+
+/*
+ * insert `elem` before `index`, elements after are moved back, the list takes `elem`
+ *
+ * @param   var     a `var_t*` of type `VAR_LIST`
+ * @param   index   position of `elem` after insertion, `var_len` to append
+ * @param   elem    the element
+ */
+void var_list_insert(var_t* var, size_t index, var_t* elem) {
+    var_list_check(var);
+    var_unshare(var);
+    if (index > var->data.l->len) {
+        ERRO("list index out of range");
+    }
+    var_list_grow(var);
+    var_list_t* list = var->data.l;
+    memmove(list->lv + index + 1, list->lv + index, sizeof (var_t*) * (list->len - index));
+    list->lv[index] = elem;
+    list->len++;
+}
+
+
+/*
+ * free the list of `var` with all elements in it
+ */
+void var_list_free(var_t* var) {
+    var_list_t* list = var->data.l;
+    var_delete_all(list->lv, list->len);
+    if (list->lv != NULL) var_free(var, list->lv);
+    var_free(var, list);
+}
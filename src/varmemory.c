@@ -0,0 +1,129 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * a budget caps the bytes a thread allocates for `var_t`, see `var_budget_use`.
+ * every allocation of `var_alloc`, `var_alloc_for` and `var_realloc` is counted against it,
+ * constructors and parsers check it first and return `NULL` instead of going over.
+ * changes of an existing `var_t` are counted but never fail, there is no way to undo half of them.
+ */
+
+
+_Thread_local var_budget_t* var_budget_curr = NULL;
+
+
+/*
+ * set the budget of the calling thread, until it is set again.
+ * once `used` would go over `limit`, `var_new` and `var_new_*` of non immediate values,
+ * `var_copy`, `var_from_json`, `var_deserialize*`, `var_view_materialize` and `name_new` of `vargen`
+ * return `NULL`, the `var_t*` passed to them are deleted.
+ * a nested `var_new_*` in the arguments of another one can be `NULL` as well, check each of them.
+ * `var_news` and `var_news_plan` are counted but never fail, like changes.
+ *
+ * @param   budget  the budget to count against, `NULL` for none
+ * @return          the budget used before
+ */
+var_budget_t* var_budget_use(var_budget_t* budget) {
+    var_budget_t* prev = var_budget_curr;
+    var_budget_curr = budget;
+    return prev;
+}
+
+
+static void var_memory_walk(const var_t* var, var_memory_t* usage);
+
+// bytes taken by the allocation `ptr` of `size` bytes that belongs to `owner`, see `var_block_usage`
+static inline size_t var_memory_of(const var_t* owner, const void* ptr, size_t size) {
+    if (owner->flag & VAR_FLAG_BLOCK) return var_block_usage(ptr, size);
+    return size;
+}
+
+// tables and elements of the dict `var`, the `var_t` of shards are part of the payload
+static void var_memory_dict(const var_t* var, var_memory_t* usage) {
+    const var_dict_t* dict = var->data.d;
+    if (dict->shard != NULL) {
+        usage->buckets += var_memory_of(var, dict, sizeof (var_dict_t) + DICT_LINE + sizeof (var_dict_shard_t) * dict->shards);
+        for (size_t i = 0; i < dict->shards; i++) {
+            var_memory_dict(&dict->shard[i].var, usage);
+        }
+        return;
+    }
+
+    usage->buckets += var_memory_of(var, dict, sizeof (var_dict_t));
+    const var_dict_table_t* table[] = { &dict->table, &dict->old };
+    for (size_t i = 0; i < 2; i++) {
+        if (table[i]->cap == 0) continue;
+        size_t elements = sizeof (var_dict_slot_t) * table[i]->cap;
+        size_t total = var_memory_of(var, table[i]->ctrl, sizeof (int8_t) * table[i]->cap + elements);
+        usage->elements += elements;
+        usage->buckets += total - elements;
+    }
+
+    size_t t = 0, pos = 0;
+    for (var_dict_slot_t* slot; (slot = var_dict_next(dict, &t, &pos)) != NULL;) {
+        var_memory_walk(slot->key, usage);
+        var_memory_walk(slot->val, usage);
+    }
+}
+
+
+static void var_memory_walk(const var_t* var, var_memory_t* usage) {
+    if (var_is_imm(var)) return;
+
+    usage->nodes += (var->flag & VAR_FLAG_NODE) ? var_block_usage(var, sizeof (var_t)) : sizeof (var_t);
+    switch (var->type) {
+        case VAR_STRING: {
+            if ((var->flag & VAR_FLAG_SHORT) == 0) {
+                usage->strings += var_memory_of(var, var->data.s, sizeof (var_string_t) + sizeof (char) * (var->data.s->len + 1));
+            }
+        }
+        break;
+
+        case VAR_ARRAY: {
+            var_array_t* arr = var->data.a;
+            usage->slots += var_memory_of(var, arr, sizeof (var_array_t) + sizeof (var_t*) * arr->len);
+            for (size_t i = 0; i < arr->len; i++) {
+                var_memory_walk(arr->av[i], usage);
+            }
+        }
+        break;
+
+        case VAR_LIST: {
+            var_list_t* list = var->data.l;
+            usage->slots += var_memory_of(var, list, sizeof (var_list_t));
+            if (list->lv != NULL) usage->slots += var_memory_of(var, list->lv, sizeof (var_t*) * list->cap);
+            for (size_t i = 0; i < list->len; i++) {
+                var_memory_walk(list->lv[i], usage);
+            }
+        }
+        break;
+
+        case VAR_DICT: {
+            var_memory_dict(var, usage);
+        }
+        break;
+
+        default: break;
+    }
+}
+
+
+/*
+ * bytes held by `var` and everything inside of it, with the unused capacity of lists and dicts.
+ * immediates take none, a payload shared by `var_retain` is counted for every owner of it.
+ * memory of `var_copy` is counted with its headers and padding, and its block with the first allocation in it.
+ * allocator overhead, and alignment and free space of arenas, are not counted.
+ * a sharded dict must not be changed by other threads meanwhile.
+ *
+ * @param   var     the `var_t*` to measure
+ * @param   usage   if not `NULL`, set to the bytes by kind
+ * @return          bytes in total
+ */
+size_t var_memory_usage(const var_t* var, var_memory_t* usage) {
+    var_memory_t res = {0};
+    var_memory_walk(var, &res);
+    if (usage != NULL) *usage = res;
+    return res.nodes + res.strings + res.slots + res.buckets + res.elements;
+}
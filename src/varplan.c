@@ -0,0 +1,273 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * a plan is a format string parsed once, see `var_news` and `var_set` for the format.
+ * ops are stored in pre-order and `(` and `[` know their number of children,
+ * so running a plan never looks at the format string again.
+ */
+
+
+// count the ops of `format`, an upper bound if the format is invalid
+static size_t var_plan_count(const char* format) {
+    size_t res = 0;
+    for (; *format != '\0'; format++) {
+        switch (*format) {
+            case ' ':
+            case ')':
+            case ']': break;
+
+            default: res++;
+        }
+    }
+    return res;
+}
+
+
+static void var_plan_parse(var_plan_t* plan, const char** format) {
+    while (**format == ' ') (*format)++;
+
+    char c = **format;
+    switch (c) {
+        case 'n':
+        case 'i':
+        case 'u':
+        case 'f':
+        case 's':
+        case 'a':
+        case 'l':
+        case 'd':
+        case 'v': break;
+
+        case '_': {
+            plan->ignore = true;
+        }
+        break;
+
+        case '(':
+        case '[': {
+            char close = c == '(' ? ')' : ']';
+            var_plan_op_t* op = &plan->op[plan->len++];
+            op->code = c;
+            op->len  = 0;
+
+            (*format)++;
+            for (;;) {
+                while (**format == ' ') (*format)++;
+                if (**format == close) break;
+                if (**format == '\0') {
+                    ERRO("parsing failed, unbalanced brackets");
+                }
+                var_plan_parse(plan, format);
+                op->len++;
+            }
+            (*format)++;
+        }
+        return;
+
+        case '\0': {
+            ERRO("parsing failed, empty format");
+        }
+        break;
+
+        default: {
+            ERRO("parsing failed, unknown format character");
+        }
+    }
+
+    var_plan_op_t* op = &plan->op[plan->len++];
+    op->code = c;
+    op->len  = 0;
+    (*format)++;
+}
+
+
+/*
+ * parse `format` once for `var_news_plan`, `var_get_plan` and `var_set_plan`.
+ * errors in the format are reported here instead of by every call.
+ *
+ * @param   format  format string of a single `var_t`, e.g. `(u[si])`
+ * @return          a new plan, free it with `var_plan_delete`
+ */
+var_plan_t* var_format_compile(const char* format) {
+    size_t len = var_plan_count(format);
+    var_plan_t* res = malloc(sizeof (var_plan_t) + sizeof (var_plan_op_t) * len);
+    MEM_CHECK(res);
+    res->len    = 0;
+    res->ignore = false;
+
+    var_plan_parse(res, &format);
+    while (*format == ' ') format++;
+    if (*format != '\0') {
+        ERRO("parsing failed, format should describe a single `var_t`");
+    }
+    return res;
+}
+
+
+/*
+ * @param   plan    the plan to free
+ */
+void var_plan_delete(var_plan_t* plan) {
+    free(plan);
+}
+
+
+// create the `var_t` of `op` in `res`, return the op after it
+static const var_plan_op_t* var_plan_news(const var_plan_op_t* op, var_t** res, va_list ap) {
+    switch (op->code) {
+        case '(': {
+            var_t* var = var_box_array(op->len);
+            var_t** av = var->data.a->av;
+            const var_plan_op_t* next = op + 1;
+            for (size_t i = 0; i < op->len; i++) {
+                next = var_plan_news(next, &av[i], ap);
+            }
+            *res = var;
+            return next;
+        }
+
+        case '[': {
+            var_t* var = var_box(VAR_LIST);
+            var_list_init(var, op->len);
+            var_t** lv = var->data.l->lv;
+            const var_plan_op_t* next = op + 1;
+            for (size_t i = 0; i < op->len; i++) {
+                next = var_plan_news(next, &lv[i], ap);
+            }
+            var->data.l->len = op->len;
+            *res = var;
+            return next;
+        }
+
+        default: {
+            *res = var_new_op(op->code, ap);
+        }
+    }
+    return op + 1;
+}
+
+
+/*
+ * same as `var_news` with a compiled format
+ *
+ * @param   plan    compiled format, must not contain `_`
+ * @param   ...     see `var_news`
+ * @return          a new `var_t*`
+ */
+var_t* var_news_plan(const var_plan_t* plan, ...) {
+    if (plan->ignore) {
+        ERRO("`_` cannot be used to create `var_t`");
+    }
+
+    va_list ap;
+    va_start(ap, plan);
+
+    var_t* res;
+    var_plan_news(plan->op, &res, ap);
+
+    va_end(ap);
+    return res;
+}
+
+
+static const var_plan_op_t* var_plan_get(const var_t* var, const var_plan_op_t* op, va_list ap) {
+    var_type_t t = var_typeof(var);
+    const var_plan_op_t* next = op + 1;
+
+    if (op->code == '(' && t == VAR_ARRAY) {
+        if (var->data.a->len < op->len) {
+            ERRO("array index out of range");
+        }
+        for (size_t i = 0; i < op->len; i++) {
+            next = var_plan_get(var->data.a->av[i], next, ap);
+        }
+    } else if (op->code == '[' && t == VAR_LIST) {
+        if (var->data.l->len < op->len) {
+            ERRO("list index out of range");
+        }
+        for (size_t i = 0; i < op->len; i++) {
+            next = var_plan_get(var->data.l->lv[i], next, ap);
+        }
+    } else {
+        var_get_op(var, op->code, ap);
+    }
+
+    return next;
+}
+
+
+/*
+ * same as `var_get` with a compiled format
+ *
+ * @param   var     the `var_t*` that you want to get from
+ * @param   plan    compiled format
+ * @param   ...     see `var_get`
+ */
+void var_get_plan(const var_t* var, const var_plan_t* plan, ...) {
+    va_list ap;
+    va_start(ap, plan);
+
+    var_plan_get(var, plan->op, ap);
+
+    va_end(ap);
+}
+
+
+static const var_plan_op_t* var_plan_set(var_t* var, const var_plan_op_t* op, va_list ap);
+
+// immediate values in the array or list `owner` are replaced in their slot
+static const var_plan_op_t* var_plan_set_slot(const var_t* owner, var_t** slot, const var_plan_op_t* op, va_list ap) {
+    if (op->code == '(' || op->code == '[') {
+        return var_plan_set(*slot, op, ap);
+    }
+    var_set_slot_op(owner, slot, op->code, ap);
+    return op + 1;
+}
+
+
+static const var_plan_op_t* var_plan_set(var_t* var, const var_plan_op_t* op, va_list ap) {
+    var_type_t t = var_typeof(var);
+    const var_plan_op_t* next = op + 1;
+
+    if (op->code == '(' && t == VAR_ARRAY) {
+        if (var->data.a->len < op->len) {
+            ERRO("array index out of range");
+        }
+        var_unshare(var);
+        for (size_t i = 0; i < op->len; i++) {
+            next = var_plan_set_slot(var, &var->data.a->av[i], next, ap);
+        }
+    } else if (op->code == '[' && t == VAR_LIST) {
+        if (var->data.l->len < op->len) {
+            ERRO("list index out of range");
+        }
+        var_unshare(var);
+        for (size_t i = 0; i < op->len; i++) {
+            next = var_plan_set_slot(var, &var->data.l->lv[i], next, ap);
+        }
+    } else {
+        var_set_op(var, op->code, ap);
+    }
+
+    return next;
+}
+
+
+/*
+ * same as `var_set` with a compiled format
+ *
+ * @param   var     the `var_t*` that you want to change
+ * @param   plan    compiled format
+ * @param   ...     see `var_set`
+ */
+void var_set_plan(var_t* var, const var_plan_t* plan, ...) {
+    va_list ap;
+    va_start(ap, plan);
+
+    var_plan_set(var, plan->op, ap);
+
+    va_end(ap);
+}
@@ -0,0 +1,294 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L     // sysconf
+#include <unistd.h>
+#endif  // _WIN32
+
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+#include <threads.h>
+
+
+/*
+ * the pool runs deep operations on large trees with all cores, see `var_pool_for`.
+ * every worker has a deque of tasks, it pops the last task it pushed and steals the first of others.
+ * threads outside of the pool share one more deque.
+ * a thread that waits for its tasks runs other tasks meanwhile, so nested splits never block.
+ */
+
+
+typedef struct var_pool_task {
+    var_pool_fn     fn;
+    void*           arg;
+    size_t          begin;
+    size_t          end;
+    atomic_size_t*  pending;    // tasks of the same `var_pool_for` not done yet
+} var_pool_task_t;
+
+typedef struct var_pool_deque {
+    mtx_t               lock;
+    var_pool_task_t*    task;   // ring buffer
+    size_t              cap;    // power of 2
+    size_t              head;   // next task to steal
+    size_t              tail;   // next task to push, the owner pops the one before it
+} var_pool_deque_t;
+
+typedef struct var_pool {
+    thrd_t*             thread;
+    var_pool_deque_t*   deque;  // one per worker, the last for other threads
+    size_t              size;   // number of workers
+    atomic_size_t       queued; // tasks in all deques
+    atomic_bool         stop;
+    mtx_t               lock;   // sleeping workers wait on `wake` with it
+    cnd_t               wake;
+} var_pool_t;
+
+atomic_size_t var_pool_threads = 0;
+
+static var_pool_t var_pool;
+static _Thread_local size_t var_pool_self = SIZE_MAX;
+
+
+// number of online cores, 1 if unknown
+size_t var_pool_cores(void) {
+#if !defined(_WIN32) && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return (size_t) n;
+#endif  // _WIN32
+    return 1;
+}
+
+
+static void var_pool_push(var_pool_deque_t* deque, const var_pool_task_t* task) {
+    mtx_lock(&deque->lock);
+    if (deque->tail - deque->head == deque->cap) {
+        var_pool_task_t* grown = malloc(sizeof (var_pool_task_t) * deque->cap * 2);
+        MEM_CHECK(grown);
+        for (size_t i = deque->head; i != deque->tail; i++) {
+            grown[i & (deque->cap * 2 - 1)] = deque->task[i & (deque->cap - 1)];
+        }
+        free(deque->task);
+        deque->task = grown;
+        deque->cap *= 2;
+    }
+    deque->task[deque->tail++ & (deque->cap - 1)] = *task;
+    mtx_unlock(&deque->lock);
+}
+
+
+// the last task if `own`, else the first
+static bool var_pool_pop(var_pool_deque_t* deque, var_pool_task_t* task, bool own) {
+    mtx_lock(&deque->lock);
+    bool res = deque->head != deque->tail;
+    if (res && own) {
+        *task = deque->task[--deque->tail & (deque->cap - 1)];
+    } else if (res) {
+        *task = deque->task[deque->head++ & (deque->cap - 1)];
+    }
+    mtx_unlock(&deque->lock);
+    return res;
+}
+
+
+// run a task of deque `self`, or one stolen from the others, false if there is none
+static bool var_pool_run_one(size_t self) {
+    if (atomic_load_explicit(&var_pool.queued, memory_order_relaxed) == 0) return false;
+
+    var_pool_task_t task;
+    size_t n = var_pool.size + 1;
+    bool found = var_pool_pop(&var_pool.deque[self], &task, true);
+    for (size_t i = 1; i < n && found == false; i++) {
+        found = var_pool_pop(&var_pool.deque[(self + i) % n], &task, false);
+    }
+    if (found == false) return false;
+
+    atomic_fetch_sub_explicit(&var_pool.queued, 1, memory_order_relaxed);
+    task.fn(task.arg, task.begin, task.end);
+    atomic_fetch_sub_explicit(task.pending, 1, memory_order_release);
+    return true;
+}
+
+
+static int var_pool_worker(void* arg) {
+    size_t self = (size_t) (uintptr_t) arg;
+    var_pool_self = self;
+
+    for (;;) {
+        if (var_pool_run_one(self)) continue;
+
+        // sleep until tasks are pushed, tasks left at stop are still run
+        mtx_lock(&var_pool.lock);
+        while (atomic_load(&var_pool.queued) == 0 && atomic_load(&var_pool.stop) == false) {
+            cnd_wait(&var_pool.wake, &var_pool.lock);
+        }
+        bool stop = atomic_load(&var_pool.stop) && atomic_load(&var_pool.queued) == 0;
+        mtx_unlock(&var_pool.lock);
+        if (stop) return 0;
+    }
+}
+
+
+static void var_pool_wake(void) {
+    mtx_lock(&var_pool.lock);
+    cnd_broadcast(&var_pool.wake);
+    mtx_unlock(&var_pool.lock);
+}
+
+
+// run tasks until the ones of `pending` are done, some of them may be run by other threads
+static void var_pool_wait(size_t self, atomic_size_t* pending) {
+    while (atomic_load_explicit(pending, memory_order_acquire) != 0) {
+        if (var_pool_run_one(self) == false) thrd_yield();
+    }
+}
+
+
+/*
+ * call `fn` on ranges of [0, `len`), some of them on the threads of the pool, and wait for all of them.
+ * ranges are at least `POOL_GRAIN` long, without a running pool `fn` is called once on the whole range.
+ * `fn` may call `var_pool_for` again, the nested ranges are stolen by idle threads.
+ *
+ * @param   fn      called with `arg` and the begin and end of each range
+ * @param   arg     passed to `fn`
+ * @param   len     length of the whole range
+ */
+void var_pool_for(var_pool_fn fn, void* arg, size_t len) {
+    size_t size = atomic_load_explicit(&var_pool_threads, memory_order_acquire);
+    if (size == 0 || len < POOL_GRAIN * 2) {
+        fn(arg, 0, len);
+        return;
+    }
+
+    // a few tasks per thread, the ones that finish early steal the rest
+    size_t chunk = len / ((size + 1) * POOL_TASKS);
+    if (chunk < POOL_GRAIN) chunk = POOL_GRAIN;
+    size_t tasks = (len + chunk - 1) / chunk;
+    size_t self = var_pool_self == SIZE_MAX ? size : var_pool_self;
+
+    atomic_size_t pending;
+    atomic_init(&pending, tasks - 1);
+    atomic_fetch_add_explicit(&var_pool.queued, tasks - 1, memory_order_relaxed);
+    for (size_t i = 1; i < tasks; i++) {
+        var_pool_task_t task = {
+            .fn         = fn,
+            .arg        = arg,
+            .begin      = i * chunk,
+            .end        = i + 1 < tasks ? (i + 1) * chunk : len,
+            .pending    = &pending,
+        };
+        var_pool_push(&var_pool.deque[self], &task);
+    }
+    var_pool_wake();
+
+    fn(arg, 0, chunk);
+    var_pool_wait(self, &pending);
+}
+
+
+/*
+ * call `fn` with `left` on the threads of the pool and with `right` on this one, and wait for both.
+ * `fn` is called with a range of 0, without a running pool both are called on this thread.
+ * `fn` may fork again, for divide and conquer that does not split into equal ranges.
+ *
+ * @param   fn      called with `left` and with `right`
+ * @param   left    passed to `fn`, on the pool
+ * @param   right   passed to `fn`, on this thread
+ */
+void var_pool_fork(var_pool_fn fn, void* left, void* right) {
+    size_t size = atomic_load_explicit(&var_pool_threads, memory_order_acquire);
+    if (size == 0) {
+        fn(left, 0, 0);
+        fn(right, 0, 0);
+        return;
+    }
+    size_t self = var_pool_self == SIZE_MAX ? size : var_pool_self;
+
+    // this thread runs `left` itself if no other thread took it by then
+    atomic_size_t pending;
+    atomic_init(&pending, 1);
+    atomic_fetch_add_explicit(&var_pool.queued, 1, memory_order_relaxed);
+    var_pool_task_t task = { .fn = fn, .arg = left, .begin = 0, .end = 0, .pending = &pending };
+    var_pool_push(&var_pool.deque[self], &task);
+    var_pool_wake();
+
+    fn(right, 0, 0);
+    var_pool_wait(self, &pending);
+}
+
+
+/*
+ * start the pool, deep operations on large trees then run on its threads and the calling one.
+ * `var_delete` of arrays, lists and dicts and `var_hash` of arrays split their elements
+ * into tasks once they have `POOL_GRAIN * 2` of them, results are the same as without the pool.
+ * `var_list_sort` and `var_array_sort` fork halves of `SORT_PARALLEL` elements or more onto it.
+ * build with `TYPE_ATOMIC` if elements of a tree share payloads, see `var_retain`.
+ *
+ * @param   threads     number of threads, 0 for one per core besides the calling thread
+ */
+void var_pool_start(size_t threads) {
+    if (atomic_load(&var_pool_threads) != 0) {
+        ERRO("pool already started");
+    }
+    if (threads == 0) threads = var_pool_cores() > 1 ? var_pool_cores() - 1 : 1;
+    if (threads > POOL_THREADS) threads = POOL_THREADS;
+
+    var_pool.size = threads;
+    var_pool.thread = malloc(sizeof (thrd_t) * threads);
+    var_pool.deque = malloc(sizeof (var_pool_deque_t) * (threads + 1));
+    MEM_CHECK(var_pool.thread);
+    MEM_CHECK(var_pool.deque);
+    for (size_t i = 0; i <= threads; i++) {
+        var_pool_deque_t* deque = &var_pool.deque[i];
+        deque->task = malloc(sizeof (var_pool_task_t) * POOL_DEQUE);
+        MEM_CHECK(deque->task);
+        deque->cap  = POOL_DEQUE;
+        deque->head = 0;
+        deque->tail = 0;
+        if (mtx_init(&deque->lock, mtx_plain) != thrd_success) {
+            ERRO("failed to create mutex");
+        }
+    }
+    atomic_init(&var_pool.queued, 0);
+    atomic_init(&var_pool.stop, false);
+    if (mtx_init(&var_pool.lock, mtx_plain) != thrd_success || cnd_init(&var_pool.wake) != thrd_success) {
+        ERRO("failed to create mutex");
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        if (thrd_create(&var_pool.thread[i], var_pool_worker, (void*) (uintptr_t) i) != thrd_success) {
+            ERRO("failed to create thread");
+        }
+    }
+    atomic_store_explicit(&var_pool_threads, threads, memory_order_release);
+}
+
+
+/*
+ * stop the pool and join its threads, deep operations run on the calling thread again.
+ * it must not run while other threads are inside of deep operations.
+ */
+void var_pool_stop(void) {
+    if (atomic_load(&var_pool_threads) == 0) return;
+    atomic_store(&var_pool_threads, 0);
+
+    mtx_lock(&var_pool.lock);
+    atomic_store(&var_pool.stop, true);
+    cnd_broadcast(&var_pool.wake);
+    mtx_unlock(&var_pool.lock);
+    for (size_t i = 0; i < var_pool.size; i++) {
+        thrd_join(var_pool.thread[i], NULL);
+    }
+
+    for (size_t i = 0; i <= var_pool.size; i++) {
+        mtx_destroy(&var_pool.deque[i].lock);
+        free(var_pool.deque[i].task);
+    }
+    mtx_destroy(&var_pool.lock);
+    cnd_destroy(&var_pool.wake);
+    free(var_pool.deque);
+    free(var_pool.thread);
+    var_pool.deque  = NULL;
+    var_pool.thread = NULL;
+    var_pool.size   = 0;
+}
@@ -2,6 +2,7 @@
 #define __VARSTRUCT_H__
 
 #include "type.h"
+#include <stddef.h>
 
 #ifdef TYPE_GC
 #include <gc.h>
@@ -16,8 +17,64 @@ typedef struct var_array    var_array_t;
 typedef struct var_list     var_list_t;
 typedef struct var_dict     var_dict_t;
 
+// flags of `var_t`
+#define VAR_FLAG_ARENA  0x1u    // memory is owned by a `var_arena_t`, `var_delete` will not free it
+#define VAR_FLAG_SHORT  0x2u    // `VAR_STRING` stored inside of `var_t`, see `SSO_SIZE`
+#define VAR_FLAG_BLOCK  0x4u    // payload is allocated with a block header, see `varcopy.c`
+#define VAR_FLAG_HASHED 0x8u    // hashed as an element of an array since it last changed, see `var_hash_fresh`
+#define VAR_FLAG_NODE   0x10u   // the `var_t` itself is inside of a `var_copy` block
+
+// `var_t` with `VAR_FLAG_ARENA` keep the id of their arena in the bits of `flag` from `VAR_ARENA_SHIFT` on
+#define VAR_ARENA_SHIFT 8
+#define VAR_ARENA_IDS   0xffffffu   // ids of arenas wrap around after as many
+#define VAR_ARENA_OWNER (VAR_FLAG_ARENA | VAR_ARENA_IDS << VAR_ARENA_SHIFT)
+
+#include <stdatomic.h>
+
+// reference count of string, array, list and dict payloads, see `var_retain`
+// build with `TYPE_ATOMIC` to share payloads across threads
+#ifdef TYPE_ATOMIC
+typedef atomic_uint_least32_t   var_ref_t;
+#else
+typedef uint32_t                var_ref_t;
+#endif  // TYPE_ATOMIC
+
+// flags of `var_t`, readers set `VAR_FLAG_HASHED` as they hash, see `var_hash`
+#ifdef TYPE_ATOMIC
+typedef atomic_uint_least32_t   var_flag_t;
+#else
+typedef uint32_t                var_flag_t;
+#endif  // TYPE_ATOMIC
+
+// cached hash of string and array payloads, 0 if not computed, see `var_hash`
+#ifdef TYPE_ATOMIC
+typedef atomic_uint_least64_t   var_hash_cache_t;
+#else
+typedef uint64_t                var_hash_cache_t;
+#endif  // TYPE_ATOMIC
+
+/*
+ * immediate values, scalars that are encoded inside of the `var_t*` itself and never allocated
+ *      ...xx1: VAR_INT,    63 bits integers
+ *      ...x10: VAR_FLOAT,  doubles with exponent in range [2^-255, 2^256) and 0.0
+ *      ...100: VAR_UINT,   61 bits unsigned integers
+ *      0x8   : VAR_NIL
+ * values out of range are allocated as usual. 
+ * every allocated `var_t` is aligned to at least 8 bytes, thus has no tag bits. 
+ */
+#if UINTPTR_MAX == UINT64_MAX
+#define VAR_IMM             1
+#endif  // UINTPTR_MAX
+#define VAR_IMM_MASK        0x7u
+#define VAR_IMM_NIL         ((var_t*) (uintptr_t) 0x8)
+#define VAR_IMM_FLOAT_ZERO  0x8000000000000002LLU
+
+// strings shorter than `SSO_SIZE` are stored inside of `var_t` without `var_string_t`
+#define SSO_SIZE    16
+
 struct var {
     var_type_t  type;
+    var_flag_t  flag;
     union {
         // basic types
         int64_t     i;
@@ -27,6 +84,9 @@ struct var {
         // sized string 
         var_string_t*   s;
 
+        // short string, the last byte is the remaining capacity, which is also `\0` when full
+        char            ss[SSO_SIZE];
+
         // fix sized array. Struct will be implemented as fix sized array
         var_array_t*    a;
 
@@ -36,58 +96,171 @@ struct var {
         // dict 
         var_dict_t*     d;
         // TODO: memory representation of dict
+
+        // pending `var_delete_deferred`, the payload pointer is kept
+        struct {
+            void*       payload;
+            var_t*      next;
+        } defer;
     } data;
 };
 
 // structs fo string 
 struct var_string {
-    uint32_t    len;
-    char        str[];
+    var_ref_t           ref;
+    uint32_t            len;
+    var_hash_cache_t    hash;
+    char                str[];
 };
 
 // structs for array
 struct var_array {
-    uint64_t    len;
-    var_t*      av[];
+    var_ref_t           ref;
+    uint64_t            len;
+    var_hash_cache_t    hash;
+    var_hash_cache_t    seen;   // `var_hash_epoch` when `hash` was last known to be fresh, see `var_hash_fresh`
+    var_t*              av[];
 };
 
 // structs for list
-#define LIST_SIZE 16
-typedef struct var_node var_node_t;
-struct var_node {
-    var_t*          vars[LIST_SIZE];
-    var_node_t*     next;
-};
-
+#define LIST_SIZE 16    // capacity of the first allocation, grows by doubling
 struct var_list {
+    var_ref_t   ref;
     uint64_t    len;
-    var_node_t  lv;
+    uint64_t    cap;
+    var_t**     lv;     // `NULL` until the first element
 };
 
 // structs for dict
-#define DICT_SIZE   16
-#define DICT_HASH   0xcbf29ce484222325LLU
-#define DICT_PRIME  0x100000001b3LLU
-#define DICT_RATIO  0x9e3779b97f4a7c15LLU
-typedef struct var_dict_elem var_dict_elem_t;
-struct var_dict_elem {
+// open addressing hash table, slots are probed by groups of `DICT_GROUP` control bytes
+#define DICT_SIZE       16      // minimal capacity of a non empty dict
+#define DICT_GROUP      16      // slots compared at once, one SSE2 register of control bytes
+#define DICT_HASH       0xcbf29ce484222325LLU
+#define DICT_PRIME      0x100000001b3LLU
+#define DICT_RATIO      0x9e3779b97f4a7c15LLU
+#define DICT_EMPTY      ((int8_t) -128)
+#define DICT_DELETED    ((int8_t) -2)
+#define DICT_STEP       4       // groups moved by each write during incremental resize
+typedef struct var_dict_slot var_dict_slot_t;
+struct var_dict_slot {
     uint64_t            hash;
     var_t*              key;
     var_t*              val;
-    var_dict_elem_t*    prev;
-    var_dict_elem_t*    next;
 };
 
-typedef struct var_dict_list var_dict_list_t;
-struct var_dict_list {
-    size_t              size;
-    var_dict_elem_t*    head;
-    var_dict_elem_t*    tail;
+typedef struct var_dict_table var_dict_table_t;
+struct var_dict_table {
+    uint64_t            cap;    // number of slots, 0 or power of 2 no less than `DICT_SIZE`
+    int8_t*             ctrl;   // `DICT_EMPTY`, `DICT_DELETED`, or 7 bits of the hash of each slot 
+    var_dict_slot_t*    slot;   // in the same allocation as `ctrl`
+};
+
+// sharded dict, see `var_new_dict_sharded`
+// each shard is a dict of its own behind a reader writer lock, picked by 16 bits of the hash
+#define DICT_SHARDS     64          // shards if none is given
+#define DICT_SHARD_MAX  0x10000     // max shards
+#define DICT_LINE       64          // bytes of a cache line, every shard takes one
+#define DICT_WRITER     0x80000000u // bit of `var_rwlock_t` held by a writer, the others count readers
+typedef atomic_uint_least32_t var_rwlock_t;
+
+typedef struct var_dict_shard var_dict_shard_t;
+struct var_dict_shard {
+    var_t           var;    // a `VAR_DICT` on the heap, its payload is never shared
+    var_rwlock_t    lock;
+    char            pad[DICT_LINE - sizeof (var_t) - sizeof (var_rwlock_t)];
 };
 
 struct var_dict {
-    uint64_t            mod;
-    var_dict_list_t*    list;
+    var_ref_t           ref;
+    uint64_t            len;            // number of elements in both tables
+    uint64_t            growth;         // number of empty slots of `table` that can still be filled before resize
+    var_dict_table_t    table;          // new elements are always inserted here
+    var_dict_table_t    old;            // table being moved into `table` during incremental resize
+    uint64_t            moved;          // groups of `old` that are already moved
+    bool                incremental;    // resize a few groups per write instead of all at once
+    var_dict_shard_t*   shard;          // `NULL` unless sharded, then the elements are in the shards
+    uint64_t            shards;         // number of shards, power of 2
+};
+
+// hash, see `var_hash`
+#define HASH_P0         0x2d358dccaa6c78a5LLU
+#define HASH_P1         0x8bb84b93962eacc9LLU
+#define HASH_P2         0x4b33a62ed433d4a3LLU
+#define HASH_P3         0x4d5a2da51de1aa47LLU
+
+// intern, see `varintern.c`
+#define INTERN_SIZE     256     // capacity of the first table, grows by doubling
+
+// sort, see `varcompare.c`
+#define SORT_RUN        16          // runs sorted by insertion before merging
+#define SORT_PARALLEL   0x10000     // elements below which a sort or merge stays on one thread
+#define SORT_THREADS    64          // max threads of a sort
+
+// pool, see `varpool.c`
+#define POOL_GRAIN      1024    // min elements of a task, elements below twice of it are not split
+#define POOL_TASKS      4       // tasks per thread of each split
+#define POOL_THREADS    256     // max threads of the pool
+#define POOL_DEQUE      64      // capacity of the first allocation of a deque, grows by doubling
+
+// deferred delete, see `vardefer.c`
+#define DEFER_DEPTH     0x10000 // trees pending before `var_delete_deferred` pushes back, if none is given
+#define DEFER_BATCH     64      // trees freed between wake ups of waiting threads, if none is given
+
+// structs for arena
+#define ARENA_SIZE  0x10000
+#define ARENA_ALIGN _Alignof (max_align_t)
+typedef struct var_arena_block var_arena_block_t;
+struct var_arena_block {
+    var_arena_block_t*  next;
+    size_t              size;
+    _Alignas (max_align_t) unsigned char mem[];
+};
+
+struct var_arena {
+    uint32_t            id;     // kept in the flag of every `var_t` of the arena, see `var_arena_of`
+    size_t              block_size;
+    size_t              used;   // bytes used in `curr`
+    var_arena_block_t*  head;
+    var_arena_block_t*  curr;
+};
+
+// structs for `var_copy`
+// every allocation of a `var_t` with `VAR_FLAG_BLOCK` follows a header that points to its block,
+// or is `NULL` for memory of its own on the heap
+#define BLOCK_ALIGN 8       // enough for `var_t` and every payload
+#define BLOCK_HEAD  8       // bytes of the header
+typedef struct var_block var_block_t;
+struct var_block {
+    var_ref_t   ref;        // allocations not freed yet, and one more while the copy is built
+    size_t      size;
+    size_t      used;
+    _Alignas (max_align_t) unsigned char mem[];
+};
+
+// binary format, see `varserial.c`
+#define SERIAL_MAGIC    "VAR"
+#define SERIAL_VERSION  1
+#define SERIAL_INDEXED  2           // version of `var_serialize_indexed`, see `varview.c`
+#define SERIAL_BUF_SIZE 0x10000     // initial buffer size, and buffer size of `FILE*`
+#define SERIAL_VARINT   10          // max bytes of a varint
+#define SERIAL_DEPTH    1024        // max nesting of input
+
+// json, see `varjson.c`
+#define JSON_DEPTH      1024        // max nesting of input
+#define JSON_BUF_SIZE   0x10000     // chunk size of `var_to_json_stream` and `var_json_read_file`
+#define JSON_FLOAT_SIZE 32          // max bytes of a float
+
+// structs for format plan
+typedef struct var_plan_op var_plan_op_t;
+struct var_plan_op {
+    char        code;   // format character, `(` and `[` are followed by their children
+    uint32_t    len;    // number of children of `(` and `[`
+};
+
+struct var_plan {
+    size_t          len;
+    bool            ignore; // contains `_`, cannot be used by `var_news_plan`
+    var_plan_op_t   op[];   // pre-order, spaces and closing brackets are dropped
 };
 
 
@@ -0,0 +1,227 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * payloads of string, array, list and dict are reference counted.
+ * every owner has its own `var_t`, which points to the shared payload.
+ * a shared payload is copied by the first owner that changes it, one level at a time:
+ * the copy of an array, list or dict shares the elements of the original.
+ *
+ * counting is atomic if built with `TYPE_ATOMIC`,
+ * a payload can not be shared between arena and heap `var_t`, nor between two arenas.
+ */
+
+
+/*
+ * share `var` in O(1), changes made through either of them are not seen by the other.
+ * the new `var_t` is always on the heap, arena `var_t` cannot be retained as they live no longer than their arena.
+ *
+ * @param   var     the `var_t*` to share, not from an arena
+ * @return          a new `var_t*` with the same value, free it with `var_release` or `var_delete`
+ */
+var_t* var_retain(const var_t* var) {
+    if (var_is_imm(var)) return (var_t*) var;
+    if (var->flag & VAR_FLAG_ARENA) {
+        ERRO("arena `var_t` cannot be retained, use `var_copy`");
+    }
+    return var_retain_elem(var);
+}
+
+
+/*
+ * same as `var_retain` for an element put into a container,
+ * an arena `var_t` is shared by a new `var_t` of its own arena, as an element of a container of that arena
+ */
+var_t* var_retain_elem(const var_t* var) {
+    if (var_is_imm(var)) return (var_t*) var;
+
+    var_t* res;
+    if (var->flag & VAR_FLAG_ARENA) {
+        res = var_alloc_for(var, sizeof (var_t));
+    } else {
+        var_budget_charge(sizeof (var_t));
+        res = malloc(sizeof (var_t));
+    }
+    MEM_CHECK(res);
+    memcpy(res, var, sizeof (var_t));
+    res->flag &= ~(VAR_FLAG_NODE | VAR_FLAG_HASHED);
+
+    var_ref_t* ref = var_ref_of(var);
+    if (ref != NULL) var_ref_inc(ref);
+    return res;
+}
+
+
+/*
+ * same as `var_delete`, the payload is freed with its last owner.
+ *
+ * @param   var     the `var_t*` to release
+ */
+void var_release(var_t* var) {
+    var_delete(var);
+}
+
+
+/*
+ * release the payload of `var`, `var` itself is kept
+ */
+void var_drop(var_t* var) {
+    var_ref_t* ref = var_ref_of(var);
+    if (ref == NULL || var_ref_dec(ref) == false) return;
+
+    switch (var->type) {
+        case VAR_STRING: {
+            var_free(var, var->data.s);
+        }
+        break;
+
+        case VAR_ARRAY: {
+            var_array_t* arr = var->data.a;
+            var_delete_all(arr->av, arr->len);
+            var_free(var, arr);
+        }
+        break;
+
+        case VAR_LIST: {
+            var_list_free(var);
+        }
+        break;
+
+        case VAR_DICT: {
+            var_dict_free(var);
+        }
+        break;
+
+        default: break;
+    }
+}
+
+
+static void var_delete_range(void* arg, size_t begin, size_t end) {
+    var_t** elem = arg;
+    for (size_t i = begin; i < end; i++) {
+        var_delete_elem(elem[i]);
+    }
+}
+
+
+/*
+ * delete `len` elements, large arrays are split across the pool, see `var_pool_start`
+ */
+void var_delete_all(var_t** elem, size_t len) {
+    if (var_pool_split(len)) {
+        var_pool_for(var_delete_range, elem, len);
+    } else {
+        var_delete_range(elem, 0, len);
+    }
+}
+
+
+/*
+ * copy the payload of `var` if it is shared, called before every change of the payload.
+ * cached hashes of the payload and of the arrays that hold `var` are dropped, see `var_hash`
+ */
+void var_unshare(var_t* var) {
+    var_hash_touch(var);
+    var_ref_t* ref = var_ref_of(var);
+    if (ref == NULL || var_ref_shared(ref) == false) return;
+
+    // the old payload is dropped at last, it may be freed by other owners meanwhile
+    var_t old;
+    memcpy(&old, var, sizeof (var_t));
+
+    switch (var->type) {
+        case VAR_STRING: {
+            size_t size = sizeof (var_string_t) + sizeof (char) * (old.data.s->len + 1);
+            var->data.s = var_alloc_for(var, size);
+            MEM_CHECK(var->data.s);
+            memcpy(var->data.s, old.data.s, size);
+            var_ref_init(&var->data.s->ref);
+            var_hash_cache_init(&var->data.s->hash);
+        }
+        break;
+
+        case VAR_ARRAY: {
+            var_array_t* src = old.data.a;
+            var_array_t* arr = var_alloc_for(var, sizeof (var_array_t) + sizeof (var_t*) * src->len);
+            MEM_CHECK(arr);
+            var_ref_init(&arr->ref);
+            var_hash_cache_init(&arr->hash);
+            var_hash_cache_init(&arr->seen);
+            arr->len = src->len;
+            for (size_t i = 0; i < src->len; i++) {
+                arr->av[i] = var_retain_elem(src->av[i]);
+            }
+            var->data.a = arr;
+        }
+        break;
+
+        case VAR_LIST: {
+            var_list_t* src = old.data.l;
+            var_list_init(var, src->len);
+            var_list_t* list = var->data.l;
+            for (size_t i = 0; i < src->len; i++) {
+                list->lv[i] = var_retain_elem(src->lv[i]);
+            }
+            list->len = src->len;
+        }
+        break;
+
+        case VAR_DICT: {
+            var_dict_clone(var, old.data.d);
+        }
+        break;
+
+        default: break;
+    }
+
+    var_drop(&old);
+}
+
+
+/*
+ * replace the value of `var` with the value of `src`, sharing its payload
+ */
+void var_share(var_t* var, const var_t* src) {
+    if (var == src) return;
+
+    // `src` may be inside of the old payload, drop it at last
+    var_t old;
+    memcpy(&old, var, sizeof (var_t));
+
+    if (var_is_imm(src)) {
+        var->type = var_typeof(src);
+        var->flag &= ~VAR_FLAG_SHORT;
+        switch (var->type) {
+            case VAR_INT: {
+                var->data.i = var_int_of(src);
+            }
+            break;
+            case VAR_UINT: {
+                var->data.u = var_uint_of(src);
+            }
+            break;
+            case VAR_FLOAT: {
+                var->data.f = var_float_of(src);
+            }
+            break;
+            default: break;
+        }
+    } else {
+        var_ref_t* ref = var_ref_of(src);
+        if (ref != NULL) {
+            if ((var->flag & VAR_ARENA_OWNER) != (src->flag & VAR_ARENA_OWNER)) {
+                ERRO("payload cannot be shared between arena and heap `var_t`, or two arenas");
+            }
+            var_ref_inc(ref);
+        }
+        var->type = src->type;
+        // the payload is freed the way it was allocated
+        var->flag = (var->flag & ~(VAR_FLAG_SHORT | VAR_FLAG_BLOCK)) | (src->flag & (VAR_FLAG_SHORT | VAR_FLAG_BLOCK));
+        memcpy(&var->data, &src->data, sizeof (var->data));
+    }
+
+    var_drop(&old);
+}
@@ -0,0 +1,474 @@
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * binary format, all integers are little endian:
+ *
+ *      header:     "VAR" version
+ *      nil:        'n'
+ *      int:        'i' zigzag varint
+ *      uint:       'u' varint
+ *      float:      'f' 8 bytes IEEE 754
+ *      string:     's' varint length, bytes
+ *      array:      'a' varint count, elements
+ *      list:       'l' varint count, elements
+ *      dict:       'd' varint count, key val pairs
+ *
+ * counts come first, so containers are allocated once with their final size.
+ */
+
+
+// buffer
+
+/*
+ * @param   buf     an empty buffer, usually on stack
+ */
+void var_buf_init(var_buf_t* buf) {
+    buf->data   = NULL;
+    buf->len    = 0;
+    buf->cap    = 0;
+}
+
+
+/*
+ * @param   buf     the buffer to free, it can be reused after `var_buf_init`
+ */
+void var_buf_free(var_buf_t* buf) {
+    free(buf->data);
+    var_buf_init(buf);
+}
+
+
+// room for `size` more bytes
+void var_buf_reserve(var_buf_t* buf, size_t size) {
+    if (buf->cap - buf->len >= size) return;
+
+    size_t cap = buf->cap < SERIAL_BUF_SIZE ? SERIAL_BUF_SIZE : buf->cap;
+    while (cap - buf->len < size) cap *= 2;
+    buf->data = realloc(buf->data, cap);
+    MEM_CHECK(buf->data);
+    buf->cap = cap;
+}
+
+
+// writer, to memory or through a buffer to `FILE*`
+
+typedef struct var_writer {
+    var_buf_t*  buf;
+    FILE*       fp;     // `NULL` to write into `buf` only
+    bool        ok;
+} var_writer_t;
+
+
+static void var_writer_flush(var_writer_t* w) {
+    if (w->fp == NULL || w->buf->len == 0) return;
+    if (fwrite(w->buf->data, 1, w->buf->len, w->fp) != w->buf->len) w->ok = false;
+    w->buf->len = 0;
+}
+
+
+static unsigned char* var_writer_grow(var_writer_t* w, size_t size) {
+    if (w->fp != NULL && w->buf->len + size > SERIAL_BUF_SIZE) var_writer_flush(w);
+    var_buf_reserve(w->buf, size);
+    return w->buf->data + w->buf->len;
+}
+
+
+// room for `size` more bytes, flushes to `FILE*` first if the buffer is full
+static inline unsigned char* var_writer_reserve(var_writer_t* w, size_t size) {
+    var_buf_t* buf = w->buf;
+    if (buf->cap - buf->len >= size && (w->fp == NULL || buf->len + size <= SERIAL_BUF_SIZE)) {
+        return buf->data + buf->len;
+    }
+    return var_writer_grow(w, size);
+}
+
+
+// tag and varint
+static inline void var_write_head(var_writer_t* w, char tag, uint64_t v) {
+    unsigned char* p = var_writer_reserve(w, 1 + SERIAL_VARINT);
+    p[0] = (unsigned char) tag;
+    w->buf->len += 1 + var_put_varint(p + 1, v);
+}
+
+
+static void var_write_bytes(var_writer_t* w, const char* str, size_t len) {
+    // large strings skip the buffer
+    if (w->fp != NULL && len > SERIAL_BUF_SIZE) {
+        var_writer_flush(w);
+        if (fwrite(str, 1, len, w->fp) != len) w->ok = false;
+        return;
+    }
+    unsigned char* p = var_writer_reserve(w, len);
+    memcpy(p, str, len);
+    w->buf->len += len;
+}
+
+
+static void var_write(var_writer_t* w, const var_t* var) {
+    switch (var_typeof(var)) {
+        case VAR_NIL: {
+            unsigned char* p = var_writer_reserve(w, 1);
+            p[0] = VAR_NIL;
+            w->buf->len++;
+        }
+        break;
+
+        case VAR_INT: {
+            int64_t i = var_int_of(var);
+            var_write_head(w, VAR_INT, ((uint64_t) i << 1) ^ (uint64_t) (i >> 63));
+        }
+        break;
+
+        case VAR_UINT: {
+            var_write_head(w, VAR_UINT, var_uint_of(var));
+        }
+        break;
+
+        case VAR_FLOAT: {
+            double f = var_float_of(var);
+            uint64_t bits;
+            memcpy(&bits, &f, sizeof (double));
+            unsigned char* p = var_writer_reserve(w, 9);
+            p[0] = VAR_FLOAT;
+            var_put_u64(p + 1, bits);
+            w->buf->len += 9;
+        }
+        break;
+
+        case VAR_STRING: {
+            size_t len = var_str_len(var);
+            var_write_head(w, VAR_STRING, len);
+            var_write_bytes(w, var_str(var), len);
+        }
+        break;
+
+        case VAR_ARRAY: {
+            var_array_t* arr = var->data.a;
+            var_write_head(w, VAR_ARRAY, arr->len);
+            for (size_t i = 0; i < arr->len; i++) {
+                var_write(w, arr->av[i]);
+            }
+        }
+        break;
+
+        case VAR_LIST: {
+            var_list_t* list = var->data.l;
+            var_write_head(w, VAR_LIST, list->len);
+            for (size_t i = 0; i < list->len; i++) {
+                var_write(w, list->lv[i]);
+            }
+        }
+        break;
+
+        case VAR_DICT: {
+            var_dict_t* dict = var->data.d;
+            var_write_head(w, VAR_DICT, var_dict_len(dict));
+            size_t t = 0, pos = 0;
+            for (var_dict_slot_t* slot; (slot = var_dict_next(dict, &t, &pos)) != NULL;) {
+                var_write(w, slot->key);
+                var_write(w, slot->val);
+            }
+        }
+        break;
+
+        default: {
+            ERRO("corrupted var");
+        }
+    }
+}
+
+
+static void var_write_header(var_writer_t* w) {
+    unsigned char* p = var_writer_reserve(w, 4);
+    memcpy(p, SERIAL_MAGIC, 3);
+    p[3] = SERIAL_VERSION;
+    w->buf->len += 4;
+}
+
+
+/*
+ * append the binary form of `var` to `buf`
+ *
+ * @param   var     the `var_t*` to serialize
+ * @param   buf     a buffer from `var_buf_init`, it grows as needed
+ */
+void var_serialize(const var_t* var, var_buf_t* buf) {
+    var_writer_t w = { .buf = buf, .fp = NULL, .ok = true };
+    var_write_header(&w);
+    var_write(&w, var);
+}
+
+
+/*
+ * write the binary form of `var` to `fp` through an internal buffer
+ *
+ * @param   var     the `var_t*` to serialize
+ * @param   fp      the file to write to
+ * @return          if all bytes were written
+ */
+bool var_serialize_file(const var_t* var, FILE* fp) {
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_writer_t w = { .buf = &buf, .fp = fp, .ok = true };
+    var_write_header(&w);
+    var_write(&w, var);
+    var_writer_flush(&w);
+    var_buf_free(&buf);
+    return w.ok;
+}
+
+
+// reader, from memory or through a buffer from `FILE*`
+
+typedef struct var_reader {
+    const unsigned char*    p;
+    const unsigned char*    end;
+    FILE*                   fp;     // `NULL` if all input is in memory
+    unsigned char*          buf;    // buffer of `fp`
+    size_t                  depth;
+} var_reader_t;
+
+
+// make at least `size` bytes available, less only at the end of input
+static size_t var_reader_fill(var_reader_t* r, size_t size) {
+    size_t left = (size_t) (r->end - r->p);
+    if (left >= size || r->fp == NULL) return left;
+
+    memmove(r->buf, r->p, left);
+    left += fread(r->buf + left, 1, SERIAL_BUF_SIZE - left, r->fp);
+    r->p    = r->buf;
+    r->end  = r->buf + left;
+    return left;
+}
+
+
+static inline bool var_get_varint(var_reader_t* r, uint64_t* v) {
+    if ((size_t) (r->end - r->p) < SERIAL_VARINT) var_reader_fill(r, SERIAL_VARINT);
+
+    // locals, stores through `r` would otherwise alias the input
+    const unsigned char* p      = r->p;
+    const unsigned char* end    = r->end;
+    uint64_t res = 0;
+    for (size_t shift = 0; shift < 64 && p != end; shift += 7) {
+        unsigned char c = *p++;
+        res |= (uint64_t) (c & 0x7f) << shift;
+        if ((c & 0x80) == 0) {
+            r->p = p;
+            *v = res;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static bool var_get_bytes(var_reader_t* r, char* dst, size_t len) {
+    size_t left = (size_t) (r->end - r->p);
+    if (left >= len) {
+        memcpy(dst, r->p, len);
+        r->p += len;
+        return true;
+    }
+    if (r->fp == NULL) return false;
+
+    // large strings are read directly
+    memcpy(dst, r->p, left);
+    r->p = r->end;
+    return fread(dst + left, 1, len - left, r->fp) == len - left;
+}
+
+
+// an element takes at least one byte, in the input and in memory, larger counts can not be valid
+static inline bool var_count_check(var_reader_t* r, uint64_t count) {
+    return (r->fp != NULL || count <= (uint64_t) (r->end - r->p)) && var_budget_over(count) == false;
+}
+
+
+static var_t* var_read(var_reader_t* r) {
+    if (var_budget_over(0)) return NULL;
+    if (r->p == r->end && var_reader_fill(r, 1) == 0) return NULL;
+    if (++r->depth > SERIAL_DEPTH) return NULL;
+
+    var_t* res = NULL;
+    uint64_t v;
+    char tag = (char) *r->p++;
+    switch (tag) {
+        case VAR_NIL: {
+            res = VAR_IMM_NIL;
+        }
+        break;
+
+        case VAR_INT: {
+            if (var_get_varint(r, &v) == false) break;
+            int64_t i = (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+            res = var_imm_int(i);
+            if (res == NULL) res = var_new_int(i);
+        }
+        break;
+
+        case VAR_UINT: {
+            if (var_get_varint(r, &v) == false) break;
+            res = var_imm_uint(v);
+            if (res == NULL) res = var_new_uint(v);
+        }
+        break;
+
+        case VAR_FLOAT: {
+            if (var_reader_fill(r, 8) < 8) break;
+            uint64_t bits = var_get_u64(r->p);
+            r->p += 8;
+            double f;
+            memcpy(&f, &bits, sizeof (double));
+            res = var_imm_float(f);
+            if (res == NULL) res = var_new_float(f);
+        }
+        break;
+
+        case VAR_STRING: {
+            if (var_get_varint(r, &v) == false || v > UINT32_MAX || var_count_check(r, v) == false) break;
+            res = var_box_string(v);
+            if (var_get_bytes(r, var_str(res), v) == false) {
+                var_delete(res);
+                res = NULL;
+            }
+        }
+        break;
+
+        case VAR_ARRAY: {
+            if (var_get_varint(r, &v) == false || var_count_check(r, v) == false) break;
+            res = var_box_array(v);
+            var_t** av = res->data.a->av;
+            for (size_t i = 0; i < v; i++) {
+                av[i] = var_read(r);
+                if (av[i] == NULL) {
+                    // the rest is not filled yet
+                    for (; i < v; i++) av[i] = var_new_nil();
+                    var_delete(res);
+                    res = NULL;
+                    break;
+                }
+            }
+        }
+        break;
+
+        case VAR_LIST: {
+            if (var_get_varint(r, &v) == false || var_count_check(r, v) == false) break;
+            res = var_box(VAR_LIST);
+            var_list_init(res, v);
+            var_list_t* list = res->data.l;
+            for (; list->len < v; list->len++) {
+                list->lv[list->len] = var_read(r);
+                if (list->lv[list->len] == NULL) {
+                    var_delete(res);
+                    res = NULL;
+                    break;
+                }
+            }
+        }
+        break;
+
+        case VAR_DICT: {
+            if (var_get_varint(r, &v) == false || var_count_check(r, v) == false) break;
+            res = var_box(VAR_DICT);
+            var_dict_init(res, v);
+            for (size_t i = 0; i < v; i++) {
+                var_t* key = var_read(r);
+                var_t* val = key == NULL ? NULL : var_read(r);
+                uint64_t hash;
+                if (val == NULL || var_hash(key, &hash) == false) {
+                    if (key != NULL) var_delete(key);
+                    if (val != NULL) var_delete(val);
+                    var_delete(res);
+                    res = NULL;
+                    break;
+                }
+
+                // a duplicated key replaces the earlier one, same as `var_new_dict`
+                bool found;
+                var_dict_slot_t* slot = var_dict_emplace(res, key, hash, &found);
+                if (found) {
+                    var_delete(key);
+                    var_delete(slot->val);
+                } else {
+                    slot->key = key;
+                }
+                slot->val = val;
+            }
+        }
+        break;
+
+        default: break;
+    }
+
+    r->depth--;
+    return res;
+}
+
+
+static bool var_read_header(var_reader_t* r) {
+    if (var_reader_fill(r, 4) < 4) return false;
+    if (memcmp(r->p, SERIAL_MAGIC, 3) != 0 || r->p[3] != SERIAL_VERSION) return false;
+    r->p += 4;
+    return true;
+}
+
+
+/*
+ * @param   data    output of `var_serialize` or `var_serialize_indexed`
+ * @param   len     bytes of `data`
+ * @param   used    if not `NULL`, set to the bytes read from `data`
+ * @return          a new `var_t*`, `NULL` if `data` is malformed
+ */
+var_t* var_deserialize(const void* data, size_t len, size_t* used) {
+    var_reader_t r = {
+        .p      = data,
+        .end    = (const unsigned char*) data + len,
+        .fp     = NULL,
+        .buf    = NULL,
+        .depth  = 0,
+    };
+
+    // indexed format is read through a view
+    var_view_t view;
+    if (var_view_init(&view, data, len)) {
+        var_t* res = var_view_materialize(&view);
+        if (res != NULL && used != NULL) *used = 4 + var_view_size(&view);
+        return res;
+    }
+    if (var_read_header(&r) == false) return NULL;
+
+    var_t* res = var_read(&r);
+    if (res != NULL && used != NULL) *used = (size_t) (r.p - (const unsigned char*) data);
+    return res;
+}
+
+
+/*
+ * read one `var_t` written by `var_serialize_file`.
+ * input is read ahead, the position of a seekable `fp` is moved back to the end of the `var_t`.
+ *
+ * @param   fp      the file to read from
+ * @return          a new `var_t*`, `NULL` if the input is malformed or incomplete
+ */
+var_t* var_deserialize_file(FILE* fp) {
+    unsigned char* buf = malloc(SERIAL_BUF_SIZE);
+    MEM_CHECK(buf);
+    var_reader_t r = {
+        .p      = buf,
+        .end    = buf,
+        .fp     = fp,
+        .buf    = buf,
+        .depth  = 0,
+    };
+
+    var_t* res = NULL;
+    if (var_read_header(&r)) res = var_read(&r);
+
+    // give back what was read ahead
+    if (r.end > r.p) fseek(fp, -(long) (r.end - r.p), SEEK_CUR);
+    free(buf);
+    return res;
+}
@@ -14,48 +14,716 @@ exit((fprintf(stderr, "[ERRO]: " msg "\n"), 1));
 if (ptr == NULL) ERRO("out of memory");
 
 
+// immediate values
 
-// reshape dictionary
-static inline void var_dict_reshape(var_dict_t* dict, size_t step) {
-    size_t old_size = dict->mod;
-    size_t new_size = old_size * step * 2;
-
-    var_dict_list_t* old_list = dict->list;
-    var_dict_list_t* new_list = malloc(sizeof (var_dict_list_t) * new_size);
-    MEM_CHECK(new_list);
-
-    dict->mod   = new_size;
-    dict->list  = new_list;
-
-    memset(dict->list, 0, sizeof (var_dict_list_t) * new_size);
-
-    var_dict_elem_t* curr;
-    var_dict_elem_t* next;
-    uint64_t index;
-    for (size_t i = 0; i < old_size; i++) {
-        curr = old_list[i].head;
-        while (curr != NULL) {
-            next    = curr->next;
-            index   = curr->hash % new_size;
-            
-            if ( new_list[index].head == NULL ) {
-                new_list[index].head = new_list[index].tail = curr;
-                curr->prev = NULL;
-            } else {
-                new_list[index].tail->next = curr;
-                new_list[index].tail = curr;
-                curr->prev = new_list[index].tail;
-            }
-            new_list[index].size++;
-            curr = next;
+// if `var` is encoded inside of the pointer
+static inline bool var_is_imm(const var_t* var) {
+    return ((uintptr_t) var & VAR_IMM_MASK) != 0 || var == VAR_IMM_NIL;
+}
+
+// type of both immediate and allocated `var_t`
+static inline var_type_t var_typeof(const var_t* var) {
+    uintptr_t bits = (uintptr_t) var;
+    if (bits & 0x1) return VAR_INT;
+    if (bits & 0x2) return VAR_FLOAT;
+    if (bits & 0x4) return VAR_UINT;
+    if (var == VAR_IMM_NIL) return VAR_NIL;
+    return var->type;
+}
+
+static inline int64_t var_int_of(const var_t* var) {
+    uintptr_t bits = (uintptr_t) var;
+    if (bits & 0x1) return (int64_t) bits >> 1;
+    return var->data.i;
+}
+
+static inline uint64_t var_uint_of(const var_t* var) {
+    uintptr_t bits = (uintptr_t) var;
+    if (bits & 0x4) return (uint64_t) bits >> 3;
+    return var->data.u;
+}
+
+static inline double var_float_of(const var_t* var) {
+    uintptr_t bits = (uintptr_t) var;
+    if ((bits & 0x3) != 0x2) return var->data.f;
+
+    // undo the rotation of `var_imm_float`
+    uint64_t raw = 0;
+    if (bits != VAR_IMM_FLOAT_ZERO) {
+        uint64_t b63 = bits >> 63;
+        raw = (2 - b63) | (bits & ~(uint64_t) 0x3);
+        raw = (raw >> 3) | (raw << 61);
+    }
+    double res;
+    memcpy(&res, &raw, sizeof (double));
+    return res;
+}
+
+// encode `i` as immediate, `NULL` if out of range 
+static inline var_t* var_imm_int(int64_t i) {
+#ifdef VAR_IMM
+    if (i >= -((int64_t) 1 << 62) && i < ((int64_t) 1 << 62)) {
+        return (var_t*) (((uintptr_t) i << 1) | 0x1);
+    }
+#endif  // VAR_IMM
+    (void) i;
+    return NULL;
+}
+
+// encode `u` as immediate, `NULL` if out of range 
+static inline var_t* var_imm_uint(uint64_t u) {
+#ifdef VAR_IMM
+    if (u < ((uint64_t) 1 << 61)) {
+        return (var_t*) (((uintptr_t) u << 3) | 0x4);
+    }
+#endif  // VAR_IMM
+    (void) u;
+    return NULL;
+}
+
+// encode `f` as immediate, `NULL` if out of range
+// exponents within [2^-255, 2^256) have bit 62 and 61 different, which can be dropped after rotation
+static inline var_t* var_imm_float(double f) {
+#ifdef VAR_IMM
+    uint64_t raw;
+    memcpy(&raw, &f, sizeof (double));
+    int bits = (int) ((raw >> 60) & 0x7);
+    if (raw != 0x3000000000000000LLU && ((bits - 3) & ~0x1) == 0) {
+        raw = (raw << 3) | (raw >> 61);
+        return (var_t*) (uintptr_t) ((raw & ~(uint64_t) 0x1) | 0x2);
+    }
+    if (raw == 0) return (var_t*) (uintptr_t) VAR_IMM_FLOAT_ZERO;
+#endif  // VAR_IMM
+    (void) f;
+    return NULL;
+}
+
+
+// arena used by constructors of the current thread, `NULL` for heap
+extern _Thread_local var_arena_t* var_arena_curr;
+
+void* var_arena_alloc(var_arena_t* arena, size_t size);
+
+// budget of the current thread, `NULL` for none
+extern _Thread_local var_budget_t* var_budget_curr;
+
+// count `size` bytes against the budget in use, allocations themselves never fail for it
+static inline void var_budget_charge(size_t size) {
+    if (var_budget_curr != NULL) var_budget_curr->used += size;
+}
+
+// if `size` more bytes go over the budget in use, constructors return `NULL` instead of allocating
+static inline bool var_budget_over(size_t size) {
+    const var_budget_t* budget = var_budget_curr;
+    return budget != NULL && (budget->used > budget->limit || size > budget->limit - budget->used);
+}
+
+// memory of `var_t` with `VAR_FLAG_BLOCK`, see `varcopy.c`
+void*               var_block_alloc(size_t size);
+void*               var_block_realloc(void* ptr, size_t old_size, size_t new_size);
+void                var_block_free(void* ptr);
+size_t              var_block_usage(const void* ptr, size_t size);
+
+// allocate memory for a new `var_t` or its payload from the current thread's arena or heap
+static inline void* var_alloc(size_t size) {
+    var_budget_charge(size);
+    if (var_arena_curr != NULL) {
+        return var_arena_alloc(var_arena_curr, size);
+    }
+    return malloc(size);
+}
+
+// flag of a new `var_t` allocated by `arena`, 0 for heap
+static inline uint32_t var_arena_flag(const var_arena_t* arena) {
+    if (arena == NULL) return 0;
+    return VAR_FLAG_ARENA | arena->id << VAR_ARENA_SHIFT;
+}
+
+// the arena in use, which must be the one that owns `owner`, memory of an arena `var_t` never moves to another
+static inline var_arena_t* var_arena_of(const var_t* owner) {
+    var_arena_t* arena = var_arena_curr;
+    if (arena == NULL || (owner->flag & VAR_ARENA_OWNER) != var_arena_flag(arena)) {
+        ERRO("arena `var_t` can only grow while its own arena is in use");
+    }
+    return arena;
+}
+
+// allocate a new `var_t` of type `t`
+static inline var_t* var_box(var_type_t t) {
+    var_t* res = var_alloc(sizeof (var_t));
+    MEM_CHECK(res);
+    res->type = t;
+    res->flag = var_arena_flag(var_arena_curr);
+    return res;
+}
+
+// free memory that belongs to `owner`
+static inline void var_free(const var_t* owner, void* ptr) {
+    if (owner->flag & VAR_FLAG_BLOCK) {
+        var_block_free(ptr);
+        return;
+    }
+    if (owner->flag & VAR_FLAG_ARENA) return;
+    free(ptr);
+}
+
+// resize memory that belongs to `owner`, arena memory can only grow while its own arena is in use
+static inline void* var_realloc(const var_t* owner, void* ptr, size_t old_size, size_t new_size) {
+    if (new_size > old_size) var_budget_charge(new_size - old_size);
+    if (owner->flag & VAR_FLAG_BLOCK) {
+        return var_block_realloc(ptr, old_size, new_size);
+    }
+    if ((owner->flag & VAR_FLAG_ARENA) == 0) {
+        return realloc(ptr, new_size);
+    }
+    if (new_size <= old_size) return ptr;
+    void* res = var_arena_alloc(var_arena_of(owner), new_size);
+    if (res != NULL) memcpy(res, ptr, old_size);
+    return res;
+}
+
+
+
+// allocate memory that will belong to `owner`, from the heap or its own arena, whatever arena is in use
+static inline void* var_alloc_for(const var_t* owner, size_t size) {
+    var_budget_charge(size);
+    if (owner->flag & VAR_FLAG_BLOCK) {
+        return var_block_alloc(size);
+    }
+    if ((owner->flag & VAR_FLAG_ARENA) == 0) {
+        return malloc(size);
+    }
+    return var_arena_alloc(var_arena_of(owner), size);
+}
+
+// allocate a new `var_t` of type `t` to be put into the container `owner`, see `var_retain_elem`.
+// `NULL` for none, then it is allocated by whatever arena is in use, see `var_box`
+static inline var_t* var_box_for(const var_t* owner, var_type_t t) {
+    if (owner == NULL) return var_box(t);
+
+    var_t* res;
+    if (owner->flag & VAR_FLAG_ARENA) {
+        res = var_alloc_for(owner, sizeof (var_t));
+    } else {
+        var_budget_charge(sizeof (var_t));
+        res = malloc(sizeof (var_t));
+    }
+    MEM_CHECK(res);
+    res->type = t;
+    res->flag = owner->flag & VAR_ARENA_OWNER;
+    return res;
+}
+
+
+// reference count, see `var_retain`
+
+static inline void var_ref_init(var_ref_t* ref) {
+#ifdef TYPE_ATOMIC
+    atomic_init(ref, 1);
+#else
+    *ref = 1;
+#endif  // TYPE_ATOMIC
+}
+
+static inline void var_ref_inc(var_ref_t* ref) {
+#ifdef TYPE_ATOMIC
+    atomic_fetch_add_explicit(ref, 1, memory_order_relaxed);
+#else
+    (*ref)++;
+#endif  // TYPE_ATOMIC
+}
+
+// drop one reference, true if it was the last one
+static inline bool var_ref_dec(var_ref_t* ref) {
+#ifdef TYPE_ATOMIC
+    return atomic_fetch_sub_explicit(ref, 1, memory_order_acq_rel) == 1;
+#else
+    return --(*ref) == 0;
+#endif  // TYPE_ATOMIC
+}
+
+static inline bool var_ref_shared(var_ref_t* ref) {
+#ifdef TYPE_ATOMIC
+    return atomic_load_explicit(ref, memory_order_acquire) > 1;
+#else
+    return *ref > 1;
+#endif  // TYPE_ATOMIC
+}
+
+// reference count of the payload of `var`, `NULL` if `var` has no payload
+static inline var_ref_t* var_ref_of(const var_t* var) {
+    if (var_is_imm(var)) return NULL;
+    switch (var->type) {
+        case VAR_STRING: return (var->flag & VAR_FLAG_SHORT) ? NULL : &var->data.s->ref;
+        case VAR_ARRAY: return &var->data.a->ref;
+        case VAR_LIST: return &var->data.l->ref;
+        case VAR_DICT: return &var->data.d->ref;
+        default: return NULL;
+    }
+}
+
+// cached hashes, see `var_hash`
+
+static inline void var_hash_cache_init(var_hash_cache_t* cache) {
+#ifdef TYPE_ATOMIC
+    atomic_init(cache, 0);
+#else
+    *cache = 0;
+#endif  // TYPE_ATOMIC
+}
+
+static inline uint64_t var_hash_cache_load(var_hash_cache_t* cache) {
+#ifdef TYPE_ATOMIC
+    return atomic_load_explicit(cache, memory_order_relaxed);
+#else
+    return *cache;
+#endif  // TYPE_ATOMIC
+}
+
+static inline void var_hash_cache_store(var_hash_cache_t* cache, uint64_t hash) {
+#ifdef TYPE_ATOMIC
+    atomic_store_explicit(cache, hash, memory_order_relaxed);
+#else
+    *cache = hash;
+#endif  // TYPE_ATOMIC
+}
+
+// bumped by every change of a `var_t` marked by an array, see `var_hash_fresh`
+extern atomic_uint_fast64_t var_hash_epoch;
+
+bool                var_hash_fresh(var_array_t* arr);
+
+// a `var_t` marked by an array changed, arrays that cached their hash check their elements again
+static inline void var_hash_changed(void) {
+    atomic_fetch_add_explicit(&var_hash_epoch, 1, memory_order_relaxed);
+}
+
+// called before every change of `var`, a shared payload keeps its cached hash as it is copied first.
+// an array that hashed `var` as its element sees it is no longer marked, see `var_hash_fresh`
+static inline void var_hash_touch(var_t* var) {
+    if (var->flag & VAR_FLAG_HASHED) {
+        var->flag &= ~VAR_FLAG_HASHED;
+        var_hash_changed();
+    }
+    var_ref_t* ref = var_ref_of(var);
+    if (ref == NULL || var_ref_shared(ref)) return;
+    if (var->type == VAR_STRING) {
+        var_hash_cache_store(&var->data.s->hash, 0);
+    } else if (var->type == VAR_ARRAY) {
+        var_hash_cache_store(&var->data.a->hash, 0);
+    }
+}
+
+// hash of `var` if it is cached and not stale
+static inline bool var_hash_cached(const var_t* var, uint64_t* hash) {
+    if (var_is_imm(var)) return false;
+    if (var->type == VAR_STRING && (var->flag & VAR_FLAG_SHORT) == 0) {
+        *hash = var_hash_cache_load(&var->data.s->hash);
+        return *hash != 0;
+    }
+    if (var->type == VAR_ARRAY) {
+        *hash = var_hash_cache_load(&var->data.a->hash);
+        return *hash != 0 && var_hash_fresh(var->data.a);
+    }
+    return false;
+}
+
+// see `varref.c`
+var_t*              var_retain_elem(const var_t* var);
+void                var_drop(var_t* var);
+void                var_unshare(var_t* var);
+void                var_share(var_t* var, const var_t* src);
+void                var_delete_all(var_t** elem, size_t len);
+void                var_delete_elem(var_t* var);  // see `type.c`
+
+
+// pool, see `varpool.c`
+typedef void (*var_pool_fn)(void* arg, size_t begin, size_t end);
+
+// number of threads of the running pool, 0 if it is not running
+extern atomic_size_t var_pool_threads;
+
+size_t              var_pool_cores(void);
+void                var_pool_for(var_pool_fn fn, void* arg, size_t len);
+void                var_pool_fork(var_pool_fn fn, void* left, void* right);
+
+// if `len` elements would be split into tasks by `var_pool_for`
+static inline bool var_pool_split(size_t len) {
+    return len >= POOL_GRAIN * 2 && atomic_load_explicit(&var_pool_threads, memory_order_relaxed) != 0;
+}
+
+
+// scalars, immediate if they fit, boxed otherwise. unlike `var_new_int` and others, never `NULL`.
+// the `_for` ones box for the container `owner`, see `var_box_for`
+
+static inline var_t* var_box_int_for(const var_t* owner, int64_t i) {
+    var_t* res = var_imm_int(i);
+    if (res == NULL) {
+        res = var_box_for(owner, VAR_INT);
+        res->data.i = i;
+    }
+    return res;
+}
+
+static inline var_t* var_box_uint_for(const var_t* owner, uint64_t u) {
+    var_t* res = var_imm_uint(u);
+    if (res == NULL) {
+        res = var_box_for(owner, VAR_UINT);
+        res->data.u = u;
+    }
+    return res;
+}
+
+static inline var_t* var_box_float_for(const var_t* owner, double f) {
+    var_t* res = var_imm_float(f);
+    if (res == NULL) {
+        res = var_box_for(owner, VAR_FLOAT);
+        res->data.f = f;
+    }
+    return res;
+}
+
+static inline var_t* var_box_int(int64_t i) {
+    return var_box_int_for(NULL, i);
+}
+
+static inline var_t* var_box_uint(uint64_t u) {
+    return var_box_uint_for(NULL, u);
+}
+
+static inline var_t* var_box_float(double f) {
+    return var_box_float_for(NULL, f);
+}
+
+
+// bytes allocated by `var_box_array` of `len` elements
+static inline size_t var_array_size(size_t len) {
+    return sizeof (var_t) + sizeof (var_array_t) + sizeof (var_t*) * len;
+}
+
+// a new `VAR_ARRAY` of `len` elements, elements are left for the caller to fill in
+static inline var_t* var_box_array(size_t len) {
+    var_t* res = var_box(VAR_ARRAY);
+    res->data.a = var_alloc(sizeof (var_array_t) + sizeof (var_t*) * len);
+    MEM_CHECK(res->data.a);
+    var_ref_init(&res->data.a->ref);
+    var_hash_cache_init(&res->data.a->hash);
+    var_hash_cache_init(&res->data.a->seen);
+    res->data.a->len = len;
+    return res;
+}
+
+
+// strings
+
+// pointer to the content of a `VAR_STRING`, short or not
+static inline char* var_str(const var_t* var) {
+    if (var->flag & VAR_FLAG_SHORT) return (char*) var->data.ss;
+    return var->data.s->str;
+}
+
+static inline size_t var_str_len(const var_t* var) {
+    if (var->flag & VAR_FLAG_SHORT) {
+        return SSO_SIZE - 1 - (unsigned char) var->data.ss[SSO_SIZE - 1];
+    }
+    return var->data.s->len;
+}
+
+// set the length of a short string, `len` must be less than `SSO_SIZE`
+static inline void var_str_short(var_t* var, size_t len) {
+    var->flag |= VAR_FLAG_SHORT;
+    var->data.ss[SSO_SIZE - 1] = (char) (SSO_SIZE - 1 - len);
+    var->data.ss[len] = '\0';
+}
+
+// bytes allocated by `var_box_string` of `len` bytes
+static inline size_t var_string_size(size_t len) {
+    if (len < SSO_SIZE) return sizeof (var_t);
+    return sizeof (var_t) + sizeof (var_string_t) + sizeof (char) * (len + 1);
+}
+
+// a new `VAR_STRING` of `len` bytes, content is left for the caller to fill in
+static inline var_t* var_box_string(size_t len) {
+    var_t* res = var_box(VAR_STRING);
+    if (len < SSO_SIZE) {
+        var_str_short(res, len);
+        return res;
+    }
+    res->data.s = var_alloc(sizeof (var_string_t) + sizeof (char) * (len + 1));
+    MEM_CHECK(res->data.s);
+    var_ref_init(&res->data.s->ref);
+    var_hash_cache_init(&res->data.s->hash);
+    res->data.s->len = len;
+    res->data.s->str[len] = '\0';
+    return res;
+}
+
+// replace the content of `var` with `len` bytes of `str`, `str` may point into `var`
+static inline void var_str_assign(var_t* var, const char* str, size_t len) {
+    var_hash_touch(var);
+
+    // a shared buffer is left to its other owners, see `var_retain`
+    bool shared = (var->flag & VAR_FLAG_SHORT) == 0 && var_ref_shared(&var->data.s->ref);
+
+    if (len < SSO_SIZE) {
+        // `ss` overlaps `s`, keep the old buffer until the copy is done
+        var_string_t* old = (var->flag & VAR_FLAG_SHORT) ? NULL : var->data.s;
+        memmove(var->data.ss, str, len);
+        var_str_short(var, len);
+        if (old != NULL && var_ref_dec(&old->ref)) var_free(var, old);
+        return;
+    }
+
+    size_t size = sizeof (var_string_t) + sizeof (char) * (len + 1);
+    if ((var->flag & VAR_FLAG_SHORT) || shared) {
+        var_string_t* s = var_alloc_for(var, size);
+        MEM_CHECK(s);
+        var_ref_init(&s->ref);
+        var_hash_cache_init(&s->hash);
+        memcpy(s->str, str, len);
+        if (shared && var_ref_dec(&var->data.s->ref)) var_free(var, var->data.s);
+        var->flag &= ~VAR_FLAG_SHORT;
+        var->data.s = s;
+    } else {
+        if (var->data.s->len < len) {
+            var->data.s = var_realloc(var, var->data.s, 
+                sizeof (var_string_t) + sizeof (char) * (var->data.s->len + 1), size);
+            MEM_CHECK(var->data.s);
+        }
+        memmove(var->data.s->str, str, len);
+    }
+    var->data.s->len = len;
+    var->data.s->str[len] = '\0';
+}
+
+
+// single format character that is not `(` or `[`, see `type.c`
+var_t*              var_new_op(char op, va_list ap);
+void                var_get_op(const var_t* var, char op, va_list ap);
+void                var_set_op(var_t* var, char op, va_list ap);
+void                var_set_slot_op(const var_t* owner, var_t** slot, char op, va_list ap);
+
+
+// hash, see `var_hash`
+
+// key of `var_hash`, random per process unless set by `var_hash_seed`
+uint64_t            var_hash_key(void);
+
+// 64 x 64 bits multiplication, low and high halves are returned in `a` and `b`
+static inline void var_hash_mum(uint64_t* a, uint64_t* b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 var_hash_u128_t;
+    var_hash_u128_t r = (var_hash_u128_t) *a * *b;
+    *a = (uint64_t) r;
+    *b = (uint64_t) (r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif  // __SIZEOF_INT128__
+}
+
+// both halves of the product folded together
+static inline uint64_t var_hash_fold(uint64_t a, uint64_t b) {
+    var_hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t var_hash_read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof (uint64_t));
+    return v;
+}
+
+static inline uint64_t var_hash_read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof (uint32_t));
+    return v;
+}
+
+// 1 to 3 bytes
+static inline uint64_t var_hash_read_small(const unsigned char* p, size_t len) {
+    return ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+}
+
+/*
+ * hash of `len` bytes at `p`, 16 bytes per step, and 48 over 3 independent lanes for long input.
+ * wyhash: every step multiplies two 64 bits words into 128 bits and folds the halves.
+ */
+static inline uint64_t var_hash_bytes(const void* data, size_t len, uint64_t seed) {
+    const unsigned char* p = data;
+    seed ^= var_hash_fold(seed ^ HASH_P0, HASH_P1);
+
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (var_hash_read32(p) << 32) | var_hash_read32(p + mid);
+            b = (var_hash_read32(p + len - 4) << 32) | var_hash_read32(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = var_hash_read_small(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t lane1 = seed, lane2 = seed;
+            do {
+                seed = var_hash_fold(var_hash_read64(p) ^ HASH_P1, var_hash_read64(p + 8) ^ seed);
+                lane1 = var_hash_fold(var_hash_read64(p + 16) ^ HASH_P2, var_hash_read64(p + 24) ^ lane1);
+                lane2 = var_hash_fold(var_hash_read64(p + 32) ^ HASH_P3, var_hash_read64(p + 40) ^ lane2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= lane1 ^ lane2;
+        }
+        while (i > 16) {
+            seed = var_hash_fold(var_hash_read64(p) ^ HASH_P1, var_hash_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
         }
+        // the last 16 bytes, which may overlap the ones already hashed
+        a = var_hash_read64(p + i - 16);
+        b = var_hash_read64(p + i - 8);
+    }
+
+    a ^= HASH_P1;
+    b ^= seed;
+    var_hash_mum(&a, &b);
+    return var_hash_fold(a ^ HASH_P0 ^ (uint64_t) len, b ^ HASH_P1);
+}
+
+// hash of a single word, integers and floats would cluster in the low bits without it
+static inline uint64_t var_hash_word(uint64_t v, uint64_t seed) {
+    uint64_t a = v ^ HASH_P0;
+    uint64_t b = seed ^ HASH_P1;
+    var_hash_mum(&a, &b);
+    return var_hash_fold(a ^ HASH_P0, b ^ HASH_P1);
+}
+
+
+// binary format, see `varserial.c` and `varview.c`
+
+// room for `size` more bytes
+void                var_buf_reserve(var_buf_t* buf, size_t size);
+
+// bytes of the indexed `var_t` at `view`, 0 if malformed
+size_t              var_view_size(const var_view_t* view);
+
+static inline size_t var_put_varint(unsigned char* p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (unsigned char) (v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char) v;
+    return n;
+}
+
+static inline void var_put_u64(unsigned char* p, uint64_t v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(p, &v, sizeof (uint64_t));
+#else
+    for (size_t i = 0; i < 8; i++) {
+        p[i] = (unsigned char) (v >> (i * 8));
+    }
+#endif  // __BYTE_ORDER__
+}
+
+static inline uint64_t var_get_u64(const unsigned char* p) {
+    uint64_t v;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&v, p, sizeof (uint64_t));
+#else
+    v = 0;
+    for (size_t i = 0; i < 8; i++) {
+        v |= (uint64_t) p[i] << (i * 8);
+    }
+#endif  // __BYTE_ORDER__
+    return v;
+}
+
+static inline void var_put_u32(unsigned char* p, uint32_t v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(p, &v, sizeof (uint32_t));
+#else
+    for (size_t i = 0; i < 4; i++) {
+        p[i] = (unsigned char) (v >> (i * 8));
     }
+#endif  // __BYTE_ORDER__
+}
 
-    for ( size_t i = 0; i < new_size; i++ ) {
-        new_list[i].tail->next = NULL;
+static inline uint32_t var_get_u32(const unsigned char* p) {
+    uint32_t v;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&v, p, sizeof (uint32_t));
+#else
+    v = 0;
+    for (size_t i = 0; i < 4; i++) {
+        v |= (uint32_t) p[i] << (i * 8);
     }
+#endif  // __BYTE_ORDER__
+    return v;
+}
 
-    free(old_list);
+
+// list, see `varlist.c`
+void                var_list_init(var_t* var, size_t size);
+void                var_list_reserve(var_t* var, size_t size);
+void                var_list_free(var_t* var);
+
+
+// dict, see `vardict.c`
+void                var_dict_init(var_t* var, size_t size);
+void                var_dict_shard_init(var_t* var, size_t shards);
+size_t              var_dict_table_size(size_t size);
+size_t              var_dict_len(const var_dict_t* dict);
+void                var_dict_free(var_t* var);
+var_dict_slot_t*    var_dict_find(const var_dict_t* dict, const var_t* key, uint64_t hash);
+var_dict_slot_t*    var_dict_emplace(var_t* var, const var_t* key, uint64_t hash, bool* found);
+var_dict_slot_t*    var_dict_next(const var_dict_t* dict, size_t* table, size_t* pos);
+void                var_dict_clone(var_t* var, const var_dict_t* src);
+
+
+// if two hashable keys are the same
+static inline bool var_key_equal(const var_t* a, const var_t* b) {
+    if (a == b) return true;
+
+    var_type_t t = var_typeof(a);
+    if (t != var_typeof(b)) return false;
+
+    switch (t) {
+        case VAR_NIL: return true;
+        case VAR_INT: return var_int_of(a) == var_int_of(b);
+        case VAR_UINT: return var_uint_of(a) == var_uint_of(b);
+        case VAR_FLOAT: {
+            // same as `var_hash`, compare bits
+            double fa = var_float_of(a);
+            double fb = var_float_of(b);
+            return memcmp(&fa, &fb, sizeof (double)) == 0;
+        }
+        case VAR_STRING: {
+            // interned and other shared strings have the same payload
+            if (((a->flag | b->flag) & VAR_FLAG_SHORT) == 0 && a->data.s == b->data.s) return true;
+            size_t len = var_str_len(a);
+            return len == var_str_len(b) && memcmp(var_str(a), var_str(b), len) == 0;
+        }
+        case VAR_ARRAY: {
+            if (a->data.a->len != b->data.a->len) return false;
+            for (size_t i = 0; i < a->data.a->len; i++) {
+                if (var_key_equal(a->data.a->av[i], b->data.a->av[i]) == false) return false;
+            }
+            return true;
+        }
+        default: return false;
+    }
 }
 
 
@@ -0,0 +1,794 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L     // mmap
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif  // _WIN32
+
+#include "type.h"
+#include "varprivate.h"
+#include "varutil.h"
+
+
+/*
+ * indexed binary format, read in place by `var_view_t` without allocating.
+ * all integers are little endian, `u32` offsets are relative to the body of their container:
+ *
+ *      header:     "VAR" 2
+ *      nil:        'n'
+ *      int:        'i' 8 bytes
+ *      uint:       'u' 8 bytes
+ *      float:      'f' 8 bytes IEEE 754
+ *      string:     's' varint length, bytes, '\0'
+ *      array:      'a' varint count, u32 size, count u32 offsets, body
+ *      list:       'l' varint count, u32 size, count u32 offsets, body
+ *      dict:       'd' varint count, varint cap, u32 size, count u32 key and val offsets,
+ *                  cap u32 index, body of key val pairs
+ *
+ * the index of a dict is open addressing with linear probing, every slot is 0 or entry + 1.
+ * keys are hashed by their encoded bytes, so the index does not depend on `var_hash`,
+ * and two keys are the same if their bytes are.
+ *
+ * every access checks bounds, a malformed buffer makes it fail instead of reading out of it.
+ */
+
+
+// writer
+
+static size_t var_index_cap(size_t count) {
+    if (count == 0) return 0;
+    size_t cap = 1;
+    while (cap < count * 2) cap *= 2;
+    return cap;
+}
+
+
+static inline uint64_t var_index_hash(uint64_t hash, const unsigned char* p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint64_t) p[i];
+        hash *= DICT_PRIME;
+    }
+    return hash;
+}
+
+
+static inline size_t var_index_slot(uint64_t hash, size_t cap) {
+    return (size_t) (hash ^ (hash >> 32)) & (cap - 1);
+}
+
+
+// tag and 8 bytes
+static void var_index_word(var_buf_t* buf, char tag, uint64_t bits) {
+    var_buf_reserve(buf, 9);
+    unsigned char* p = buf->data + buf->len;
+    p[0] = (unsigned char) tag;
+    var_put_u64(p + 1, bits);
+    buf->len += 9;
+}
+
+
+/*
+ * container of `count` elements, which are written by the caller.
+ * returns the position of its size, the tables follow it and are filled by `var_index_offset`.
+ */
+static size_t var_index_begin(var_buf_t* buf, char tag, size_t count, size_t cap) {
+    size_t table = (tag == VAR_DICT ? count * 2 : count) + cap;
+    var_buf_reserve(buf, 1 + SERIAL_VARINT * 2 + 4 + table * 4);
+    unsigned char* p = buf->data + buf->len;
+    size_t n = 0;
+    p[n++] = (unsigned char) tag;
+    n += var_put_varint(p + n, count);
+    if (tag == VAR_DICT) n += var_put_varint(p + n, cap);
+    memset(p + n, 0, 4 + table * 4);
+    buf->len += n + 4 + table * 4;
+    return buf->len - table * 4 - 4;
+}
+
+
+// offset of the next element, relative to `body`
+static void var_index_offset(var_buf_t* buf, size_t at, size_t body) {
+    size_t off = buf->len - body;
+    if (off > UINT32_MAX) {
+        ERRO("container is too large for the indexed format");
+    }
+    var_put_u32(buf->data + at, (uint32_t) off);
+}
+
+
+static void var_index_write(var_buf_t* buf, const var_t* var) {
+    switch (var_typeof(var)) {
+        case VAR_NIL: {
+            var_buf_reserve(buf, 1);
+            buf->data[buf->len++] = VAR_NIL;
+        }
+        break;
+
+        case VAR_INT: {
+            var_index_word(buf, VAR_INT, (uint64_t) var_int_of(var));
+        }
+        break;
+
+        case VAR_UINT: {
+            var_index_word(buf, VAR_UINT, var_uint_of(var));
+        }
+        break;
+
+        case VAR_FLOAT: {
+            double f = var_float_of(var);
+            uint64_t bits;
+            memcpy(&bits, &f, sizeof (double));
+            var_index_word(buf, VAR_FLOAT, bits);
+        }
+        break;
+
+        case VAR_STRING: {
+            size_t len = var_str_len(var);
+            var_buf_reserve(buf, 1 + SERIAL_VARINT + len + 1);
+            unsigned char* p = buf->data + buf->len;
+            p[0] = VAR_STRING;
+            size_t n = 1 + var_put_varint(p + 1, len);
+            memcpy(p + n, var_str(var), len + 1);
+            buf->len += n + len + 1;
+        }
+        break;
+
+        case VAR_ARRAY:
+        case VAR_LIST: {
+            size_t len;
+            var_t** elem;
+            if (var_typeof(var) == VAR_ARRAY) {
+                len  = var->data.a->len;
+                elem = var->data.a->av;
+            } else {
+                len  = var->data.l->len;
+                elem = var->data.l->lv;
+            }
+
+            size_t head = var_index_begin(buf, var_typeof(var), len, 0);
+            size_t body = buf->len;
+            for (size_t i = 0; i < len; i++) {
+                var_index_offset(buf, head + 4 + i * 4, body);
+                var_index_write(buf, elem[i]);
+            }
+            var_index_offset(buf, head, body);    // size of the body
+        }
+        break;
+
+        case VAR_DICT: {
+            var_dict_t* dict = var->data.d;
+            size_t len  = var_dict_len(dict);
+            size_t cap  = var_index_cap(len);
+            size_t head = var_index_begin(buf, VAR_DICT, len, cap);
+            size_t body = buf->len;
+
+            size_t i = 0, t = 0, pos = 0;
+            for (var_dict_slot_t* slot; (slot = var_dict_next(dict, &t, &pos)) != NULL; i++) {
+                var_index_offset(buf, head + 4 + i * 8, body);
+                var_index_write(buf, slot->key);
+                var_index_offset(buf, head + 8 + i * 8, body);
+                var_index_write(buf, slot->val);
+            }
+            var_index_offset(buf, head, body);    // size of the body
+
+            // keys are hashed once the buffer stops moving, a key ends where its val starts
+            const unsigned char* off = buf->data + head + 4;
+            unsigned char* index = buf->data + head + 4 + len * 8;
+            for (i = 0; i < len; i++) {
+                uint32_t key = var_get_u32(off + i * 8);
+                uint32_t val = var_get_u32(off + i * 8 + 4);
+                uint64_t hash = var_index_hash(DICT_HASH, buf->data + body + key, val - key);
+                size_t s = var_index_slot(hash, cap);
+                while (var_get_u32(index + s * 4) != 0) s = (s + 1) & (cap - 1);
+                var_put_u32(index + s * 4, (uint32_t) (i + 1));
+            }
+        }
+        break;
+
+        default: {
+            ERRO("corrupted var");
+        }
+    }
+}
+
+
+/*
+ * append the indexed binary form of `var` to `buf`, which can be read in place by `var_view_init`.
+ * it is larger than the output of `var_serialize`, `var_deserialize` reads both.
+ *
+ * @param   var     the `var_t*` to serialize
+ * @param   buf     a buffer from `var_buf_init`, it grows as needed
+ */
+void var_serialize_indexed(const var_t* var, var_buf_t* buf) {
+    var_buf_reserve(buf, 4);
+    memcpy(buf->data + buf->len, SERIAL_MAGIC, 3);
+    buf->data[buf->len + 3] = SERIAL_INDEXED;
+    buf->len += 4;
+    var_index_write(buf, var);
+}
+
+
+// reader
+
+static inline bool var_view_tag(unsigned char c) {
+    switch (c) {
+        case VAR_NIL:
+        case VAR_INT:
+        case VAR_UINT:
+        case VAR_FLOAT:
+        case VAR_STRING:
+        case VAR_ARRAY:
+        case VAR_LIST:
+        case VAR_DICT: return true;
+
+        default: return false;
+    }
+}
+
+
+static inline bool var_view_make(const unsigned char* p, const unsigned char* end, var_view_t* res) {
+    if (p >= end || var_view_tag(*p) == false) return false;
+    res->p   = p;
+    res->end = end;
+    return true;
+}
+
+
+static inline bool var_view_varint(const unsigned char** p, const unsigned char* end, uint64_t* v) {
+    uint64_t res = 0;
+    for (size_t shift = 0; shift < 64 && *p != end; shift += 7) {
+        unsigned char c = *(*p)++;
+        res |= (uint64_t) (c & 0x7f) << shift;
+        if ((c & 0x80) == 0) {
+            *v = res;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// 8 bytes after a tag
+static inline bool var_view_word(const var_view_t* view, char tag, uint64_t* bits) {
+    if (*view->p != (unsigned char) tag || view->end - view->p < 9) return false;
+    *bits = var_get_u64(view->p + 1);
+    return true;
+}
+
+
+// header of a container
+typedef struct var_view_table {
+    uint64_t                count;
+    uint64_t                cap;
+    uint32_t                size;   // bytes of `body`
+    const unsigned char*    off;    // offsets of elements, or of keys and vals
+    const unsigned char*    index;  // slots of a dict
+    const unsigned char*    body;
+} var_view_table_t;
+
+
+static bool var_view_open(const var_view_t* view, var_view_table_t* t) {
+    unsigned char tag = *view->p;
+    if (tag != VAR_ARRAY && tag != VAR_LIST && tag != VAR_DICT) return false;
+
+    const unsigned char* p = view->p + 1;
+    if (var_view_varint(&p, view->end, &t->count) == false) return false;
+    t->cap = 0;
+    if (tag == VAR_DICT) {
+        if (var_view_varint(&p, view->end, &t->cap) == false) return false;
+        if (t->cap == 0 ? t->count != 0 : ((t->cap & (t->cap - 1)) != 0 || t->cap <= t->count)) {
+            return false;
+        }
+    }
+
+    size_t left = (size_t) (view->end - p);
+    if (left < 4) return false;
+    t->size = var_get_u32(p);
+    p += 4;
+    left -= 4;
+
+    // checked one by one, so the sum does not overflow
+    uint64_t width = tag == VAR_DICT ? 8 : 4;
+    if (t->count > left / width || t->cap > left / 4) return false;
+    uint64_t table = t->count * width + t->cap * 4;
+    if (table > left || t->size > left - table) return false;
+
+    t->off   = p;
+    t->index = p + t->count * width;
+    t->body  = p + table;
+    return true;
+}
+
+
+static inline bool var_view_elem(const var_view_table_t* t, uint32_t off, var_view_t* res) {
+    if (off >= t->size) return false;
+    return var_view_make(t->body + off, t->body + t->size, res);
+}
+
+
+/*
+ * @param   view    set to the root of `data`
+ * @param   data    output of `var_serialize_indexed`, e.g. from `var_map_file`, it must outlive `view`
+ * @param   len     bytes of `data`
+ * @return          false if `data` is not in the indexed format
+ */
+bool var_view_init(var_view_t* view, const void* data, size_t len) {
+    const unsigned char* p = data;
+    if (len < 4 || memcmp(p, SERIAL_MAGIC, 3) != 0 || p[3] != SERIAL_INDEXED) return false;
+    return var_view_make(p + 4, p + len, view);
+}
+
+
+/*
+ * @param   view    a valid view
+ * @return          type of the viewed value
+ */
+var_type_t var_view_type(const var_view_t* view) {
+    return (var_type_t) *view->p;
+}
+
+
+/*
+ * same as `var_len`, except that scalars and malformed values have len 0
+ *
+ * @param   view    a valid view
+ * @return          number of bytes of a string, or elements of a container
+ */
+size_t var_view_len(const var_view_t* view) {
+    if (*view->p == VAR_STRING) {
+        const char* str;
+        size_t len;
+        return var_view_str(view, &str, &len) ? len : 0;
+    }
+
+    var_view_table_t t;
+    return var_view_open(view, &t) ? t.count : 0;
+}
+
+
+/*
+ * @param   view    a valid view
+ * @param   i       set to the value
+ * @return          false if it is not a `VAR_INT`
+ */
+bool var_view_int(const var_view_t* view, int64_t* i) {
+    uint64_t bits;
+    if (var_view_word(view, VAR_INT, &bits) == false) return false;
+    *i = (int64_t) bits;
+    return true;
+}
+
+
+/*
+ * @param   view    a valid view
+ * @param   u       set to the value
+ * @return          false if it is not a `VAR_UINT`
+ */
+bool var_view_uint(const var_view_t* view, uint64_t* u) {
+    return var_view_word(view, VAR_UINT, u);
+}
+
+
+/*
+ * @param   view    a valid view
+ * @param   f       set to the value
+ * @return          false if it is not a `VAR_FLOAT`
+ */
+bool var_view_float(const var_view_t* view, double* f) {
+    uint64_t bits;
+    if (var_view_word(view, VAR_FLOAT, &bits) == false) return false;
+    memcpy(f, &bits, sizeof (double));
+    return true;
+}
+
+
+/*
+ * @param   view    a valid view
+ * @param   str     set to the content inside of the buffer, with `\0` terminator
+ * @param   len     if not `NULL`, set to the number of bytes
+ * @return          false if it is not a `VAR_STRING`
+ */
+bool var_view_str(const var_view_t* view, const char** str, size_t* len) {
+    if (*view->p != VAR_STRING) return false;
+
+    const unsigned char* p = view->p + 1;
+    uint64_t n;
+    if (var_view_varint(&p, view->end, &n) == false) return false;
+    if (n >= (uint64_t) (view->end - p) || p[n] != '\0') return false;
+
+    *str = (const char*) p;
+    if (len != NULL) *len = n;
+    return true;
+}
+
+
+/*
+ * element of a `VAR_ARRAY` or `VAR_LIST` in O(1)
+ *
+ * @param   view    a valid view
+ * @param   index   index of the element
+ * @param   elem    set to the element
+ * @return          false if `view` is not an array or list, or `index` is out of range
+ */
+bool var_view_at(const var_view_t* view, size_t index, var_view_t* elem) {
+    var_view_table_t t;
+    if (*view->p == VAR_DICT || var_view_open(view, &t) == false || index >= t.count) return false;
+    return var_view_elem(&t, var_get_u32(t.off + index * 4), elem);
+}
+
+
+/*
+ * entry of a `VAR_DICT` by position, in no particular order
+ *
+ * @param   view    a valid view
+ * @param   index   position of the entry, less than `var_view_len`
+ * @param   key     if not `NULL`, set to the key
+ * @param   val     if not `NULL`, set to the val
+ * @return          false if `view` is not a dict, or `index` is out of range
+ */
+bool var_view_dict_at(const var_view_t* view, size_t index, var_view_t* key, var_view_t* val) {
+    var_view_table_t t;
+    if (*view->p != VAR_DICT || var_view_open(view, &t) == false || index >= t.count) return false;
+
+    var_view_t k, v;
+    if (var_view_elem(&t, var_get_u32(t.off + index * 8), &k) == false) return false;
+    if (var_view_elem(&t, var_get_u32(t.off + index * 8 + 4), &v) == false) return false;
+    if (key != NULL) *key = k;
+    if (val != NULL) *val = v;
+    return true;
+}
+
+
+// look up the key encoded as `head` followed by `tail`
+static bool var_view_find(const var_view_t* view, const unsigned char* head, size_t head_len,
+                          const unsigned char* tail, size_t tail_len, var_view_t* val) {
+    var_view_table_t t;
+    if (*view->p != VAR_DICT || var_view_open(view, &t) == false || t.count == 0) return false;
+
+    uint64_t hash = var_index_hash(var_index_hash(DICT_HASH, head, head_len), tail, tail_len);
+    size_t len = head_len + tail_len;
+    for (size_t s = var_index_slot(hash, t.cap), n = 0; n < t.cap; s = (s + 1) & (t.cap - 1), n++) {
+        uint32_t e = var_get_u32(t.index + s * 4);
+        if (e == 0) return false;
+        if (e > t.count) continue;
+
+        uint32_t key = var_get_u32(t.off + (e - 1) * 8);
+        uint32_t off = var_get_u32(t.off + (e - 1) * 8 + 4);
+        if (key >= off || off - key != len) continue;
+
+        const unsigned char* p = t.body + key;
+        if (memcmp(p, head, head_len) == 0 && memcmp(p + head_len, tail, tail_len) == 0) {
+            return var_view_elem(&t, off, val);
+        }
+    }
+    return false;
+}
+
+
+static bool var_view_find_str(const var_view_t* view, const char* key, size_t len, var_view_t* val) {
+    unsigned char head[1 + SERIAL_VARINT];
+    head[0] = VAR_STRING;
+    size_t n = 1 + var_put_varint(head + 1, len);
+    return var_view_find(view, head, n, (const unsigned char*) key, len + 1, val);
+}
+
+
+/*
+ * same as `var_dict_get`, through the index of the buffer
+ *
+ * @param   view    a valid view of a `VAR_DICT`
+ * @param   key     the key to look up
+ * @param   val     set to the val
+ * @return          false if the key is not found, or `view` is not a dict
+ */
+bool var_view_dict_get(const var_view_t* view, const var_t* key, var_view_t* val) {
+    if (var_typeof(key) == VAR_STRING) {
+        return var_view_find_str(view, var_str(key), var_str_len(key), val);
+    }
+
+    uint64_t hash;
+    if (var_hash(key, &hash) == false) return false;
+
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_index_write(&buf, key);
+    bool res = var_view_find(view, buf.data, buf.len, buf.data + buf.len, 0, val);
+    var_buf_free(&buf);
+    return res;
+}
+
+
+/*
+ * same as `var_view_dict_get` with a string key, without creating a `var_t`
+ *
+ * @param   view    a valid view of a `VAR_DICT`
+ * @param   key     the key to look up
+ * @param   val     set to the val
+ * @return          false if the key is not found, or `view` is not a dict
+ */
+bool var_view_dict_get_str(const var_view_t* view, const char* key, var_view_t* val) {
+    return var_view_find_str(view, key, strlen(key), val);
+}
+
+
+static bool var_view_vget(const var_view_t* view, const char** format, va_list ap) {
+    while (**format == ' ') (*format)++;
+    char c = *(*format)++;
+
+    switch (c) {
+        case '(':
+        case '[': {
+            char close = c == '(' ? ')' : ']';
+            if (*view->p != (c == '(' ? VAR_ARRAY : VAR_LIST)) return false;
+
+            for (size_t i = 0;; i++) {
+                while (**format == ' ') (*format)++;
+                if (**format == close) break;
+                if (**format == '\0') return false;
+
+                var_view_t elem;
+                if (var_view_at(view, i, &elem) == false) return false;
+                if (var_view_vget(&elem, format, ap) == false) return false;
+            }
+            (*format)++;
+        }
+        break;
+
+        case 'n': return *view->p == VAR_NIL;
+        case 'i': return var_view_int(view, va_arg(ap, int64_t*));
+        case 'u': return var_view_uint(view, va_arg(ap, uint64_t*));
+        case 'f': return var_view_float(view, va_arg(ap, double*));
+        case 's': return var_view_str(view, va_arg(ap, const char**), NULL);
+
+        case 'a':
+        case 'l':
+        case 'd': {
+            if (*view->p != (unsigned char) c) return false;
+            *va_arg(ap, var_view_t*) = *view;
+        }
+        break;
+
+        case 'v': {
+            *va_arg(ap, var_view_t*) = *view;
+        }
+        break;
+
+        case '_': break;
+
+        default: return false;
+    }
+    return true;
+}
+
+
+/*
+ * same as `var_get` on a view, nothing is allocated.
+ * `s` gives `const char*` into the buffer, `v`, `a`, `l` and `d` give `var_view_t` of the value.
+ * unlike `var_get`, a value of another type or a missing element makes it fail,
+ * arguments before the failure are already written.
+ *
+ * @param   view    a valid view
+ * @param   format  format string, see `var_get`
+ * @param   ...     pointers to store values
+ * @return          false if the value does not match `format`
+ */
+bool var_view_get(const var_view_t* view, const char* format, ...) {
+    va_list ap;
+    va_start(ap, format);
+
+    bool res = var_view_vget(view, &format, ap);
+    while (*format == ' ') format++;
+    if (*format != '\0') res = false;
+
+    va_end(ap);
+    return res;
+}
+
+
+static var_t* var_view_build(const var_view_t* view, size_t depth) {
+    if (depth > SERIAL_DEPTH || var_budget_over(0)) return NULL;
+
+    var_t* res = NULL;
+    switch (*view->p) {
+        case VAR_NIL: {
+            res = var_new_nil();
+        }
+        break;
+
+        case VAR_INT: {
+            int64_t i;
+            if (var_view_int(view, &i)) res = var_new_int(i);
+        }
+        break;
+
+        case VAR_UINT: {
+            uint64_t u;
+            if (var_view_uint(view, &u)) res = var_new_uint(u);
+        }
+        break;
+
+        case VAR_FLOAT: {
+            double f;
+            if (var_view_float(view, &f)) res = var_new_float(f);
+        }
+        break;
+
+        case VAR_STRING: {
+            const char* str;
+            size_t len;
+            if (var_view_str(view, &str, &len) == false || len > UINT32_MAX) break;
+            res = var_box_string(len);
+            memcpy(var_str(res), str, len);
+        }
+        break;
+
+        case VAR_ARRAY: {
+            var_view_table_t t;
+            if (var_view_open(view, &t) == false) break;
+            res = var_box_array(t.count);
+            var_t** av = res->data.a->av;
+            for (size_t i = 0; i < t.count; i++) {
+                var_view_t elem;
+                av[i] = var_view_elem(&t, var_get_u32(t.off + i * 4), &elem) ? var_view_build(&elem, depth + 1) : NULL;
+                if (av[i] == NULL) {
+                    // the rest is not filled yet
+                    for (; i < t.count; i++) av[i] = var_new_nil();
+                    var_delete(res);
+                    res = NULL;
+                    break;
+                }
+            }
+        }
+        break;
+
+        case VAR_LIST: {
+            var_view_table_t t;
+            if (var_view_open(view, &t) == false) break;
+            res = var_box(VAR_LIST);
+            var_list_init(res, t.count);
+            var_list_t* list = res->data.l;
+            for (; list->len < t.count; list->len++) {
+                var_view_t elem;
+                var_t* var = NULL;
+                if (var_view_elem(&t, var_get_u32(t.off + list->len * 4), &elem)) {
+                    var = var_view_build(&elem, depth + 1);
+                }
+                if (var == NULL) {
+                    var_delete(res);
+                    res = NULL;
+                    break;
+                }
+                list->lv[list->len] = var;
+            }
+        }
+        break;
+
+        case VAR_DICT: {
+            var_view_table_t t;
+            if (var_view_open(view, &t) == false) break;
+            res = var_box(VAR_DICT);
+            var_dict_init(res, t.count);
+            for (size_t i = 0; i < t.count; i++) {
+                var_view_t k, v;
+                var_t* key = NULL;
+                var_t* val = NULL;
+                if (var_view_dict_at(view, i, &k, &v)) {
+                    key = var_view_build(&k, depth + 1);
+                    val = key == NULL ? NULL : var_view_build(&v, depth + 1);
+                }
+                uint64_t hash;
+                if (val == NULL || var_hash(key, &hash) == false) {
+                    if (key != NULL) var_delete(key);
+                    if (val != NULL) var_delete(val);
+                    var_delete(res);
+                    res = NULL;
+                    break;
+                }
+
+                // a duplicated key replaces the earlier one, same as `var_new_dict`
+                bool found;
+                var_dict_slot_t* slot = var_dict_emplace(res, key, hash, &found);
+                if (found) {
+                    var_delete(key);
+                    var_delete(slot->val);
+                } else {
+                    slot->key = key;
+                }
+                slot->val = val;
+            }
+        }
+        break;
+
+        default: break;
+    }
+    return res;
+}
+
+
+/*
+ * copy the viewed value into a new `var_t`, allocated from the arena in use if any
+ *
+ * @param   view    a valid view
+ * @return          a new `var_t*`, `NULL` if the buffer is malformed
+ */
+var_t* var_view_materialize(const var_view_t* view) {
+    return var_view_build(view, 0);
+}
+
+
+size_t var_view_size(const var_view_t* view) {
+    switch (*view->p) {
+        case VAR_NIL: return 1;
+
+        case VAR_INT:
+        case VAR_UINT:
+        case VAR_FLOAT: return view->end - view->p < 9 ? 0 : 9;
+
+        case VAR_STRING: {
+            const char* str;
+            size_t len;
+            if (var_view_str(view, &str, &len) == false) return 0;
+            return (size_t) ((const unsigned char*) str - view->p) + len + 1;
+        }
+
+        case VAR_ARRAY:
+        case VAR_LIST:
+        case VAR_DICT: {
+            var_view_table_t t;
+            if (var_view_open(view, &t) == false) return 0;
+            return (size_t) (t.body - view->p) + t.size;
+        }
+
+        default: return 0;
+    }
+}
+
+
+// mapped files
+
+/*
+ * map a file read-only, e.g. for `var_view_init`
+ *
+ * @param   path    path of the file
+ * @param   len     set to the bytes of the file
+ * @return          the mapped memory, `NULL` on failure or if the file is empty
+ */
+const void* var_map_file(const char* path, size_t* len) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void* res = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        res = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (res == MAP_FAILED) {
+            res = NULL;
+        } else {
+            *len = (size_t) st.st_size;
+        }
+    }
+
+    // the mapping stays valid after close
+    close(fd);
+    return res;
+#else
+    (void) path;
+    (void) len;
+    return NULL;
+#endif  // _WIN32
+}
+
+
+/*
+ * @param   data    memory from `var_map_file`, views into it can not be used afterwards
+ * @param   len     bytes given by `var_map_file`
+ */
+void var_unmap_file(const void* data, size_t len) {
+#ifndef _WIN32
+    munmap((void*) data, len);
+#else
+    (void) data;
+    (void) len;
+#endif  // _WIN32
+}
@@ -0,0 +1,267 @@
+#define _POSIX_C_SOURCE 200809L     // fork
+
+#include "src/type.h"
+#include "testgen.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/*
+ * an arena holds whole trees until it is reset, memory of a `var_t` stays with its owner:
+ * heap `var_t` grow on the heap while an arena is in use, arena `var_t` only grow in their own arena.
+ * the address sanitizer of the default build catches memory that went to the wrong owner.
+ * `testgen.h` is written by `vargen` for the setters of generated code, see the `testarena` rule.
+ * build the library first, e.g. `make type && make testarena && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+
+
+// if `fn` exits the process, it runs in a child process
+static bool dies(void (*fn)(void* arg), void* arg) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        assert(freopen("/dev/null", "w", stderr) != NULL);
+        fn(arg);
+        _exit(0);
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    return WIFEXITED(status) && WEXITSTATUS(status) != 0;
+}
+
+
+// overwrite memory the arena in use handed out before its reset
+static void scribble(void) {
+    for (int i = 0; i < 1000; i++) {
+        var_t* list = var_new_list(var_new_string("%s %d", LONG_STR, i), NULL);
+        for (int k = 0; k < 20; k++) var_list_push(list, var_new_float(1e300));
+    }
+}
+
+
+static void check_str(const var_t* var, const char* expect) {
+    const char* str;
+    var_get(var, "s", &str);
+    assert(strcmp(str, expect) == 0);
+}
+
+
+// trees larger than a block, and strings larger than a block, are rebuilt after every reset
+static void test_reset(void) {
+    var_arena_t* arena = var_arena_new(256);
+    for (int round = 0; round < 3; round++) {
+        var_arena_use(arena);
+        char big[1000];
+        memset(big, 'x', sizeof (big) - 1);
+        big[sizeof (big) - 1] = '\0';
+
+        var_t* tree = var_news("(s[if]s)", LONG_STR, (int64_t) 1 << 62, 1e300, big);
+        var_t* list = var_new_list(NULL);
+        for (int i = 0; i < 500; i++) var_list_push(list, var_new_string("%s %d", LONG_STR, i));
+        var_arena_use(NULL);
+
+        const char *a, *b;
+        int64_t i;
+        double f;
+        var_get(tree, "(s[if]s)", &a, &i, &f, &b);
+        assert(strcmp(a, LONG_STR) == 0 && i == (int64_t) 1 << 62 && f == 1e300 && strcmp(b, big) == 0);
+        assert(var_len(list) == 500);
+        check_str(var_list_at(list, 499), LONG_STR " 499");
+
+        // nothing to free, the arena does it
+        var_delete(tree);
+        var_delete(list);
+        var_arena_reset(arena);
+    }
+    var_arena_delete(arena);
+}
+
+
+// heap `var_t` changed while an arena is in use outlive its reset
+static void test_heap(void) {
+    var_t* list = var_new_list(NULL);
+    var_t* str = var_new_string("short");
+    var_t* dict = var_new_dict(NULL, NULL);
+
+    var_arena_t* arena = var_arena_new(0);
+    var_arena_use(arena);
+    for (int64_t i = 0; i < 1000; i++) {
+        var_list_push(list, var_new_int(i));
+        var_dict_put(dict, var_new_int(i), var_new_nil());
+    }
+    var_set(str, "s", LONG_STR);
+    var_arena_reset(arena);
+    scribble();
+    var_arena_use(NULL);
+    var_arena_delete(arena);
+
+    int64_t v;
+    var_get(var_list_at(list, 999), "i", &v);
+    assert(v == 999 && var_len(dict) == 1000);
+    check_str(str, LONG_STR);
+    var_delete(list);
+    var_delete(str);
+    var_delete(dict);
+}
+
+
+// an arena `var_t` grows in its own arena after another one was in use
+static void test_own(void) {
+    var_arena_t* a = var_arena_new(0);
+    var_arena_t* b = var_arena_new(0);
+
+    var_arena_use(a);
+    var_t* list = var_new_list(NULL);
+    var_t* str = var_new_string("short");
+    var_arena_use(b);
+    scribble();
+    var_arena_use(a);
+    for (int64_t i = 0; i < 1000; i++) var_list_push(list, var_new_int(i));
+    var_set(str, "s", LONG_STR);
+
+    // whatever `b` hands out after its reset, it is not the memory of `a`
+    var_arena_reset(b);
+    var_arena_use(b);
+    scribble();
+    var_arena_use(NULL);
+
+    int64_t v;
+    var_get(var_list_at(list, 999), "i", &v);
+    assert(v == 999);
+    check_str(str, LONG_STR);
+    var_arena_delete(a);
+    var_arena_delete(b);
+}
+
+
+// scalars replaced in the slot of a heap container are boxed on the heap, whatever arena is in use
+static void test_box(void) {
+    var_t* heap = var_news("(iifn)", (int64_t) 1, (int64_t) 2, 0.5);
+    var_t* str = var_new_string(LONG_STR);
+    var_t* gen = testgen_new("a", "b", 1, 2, 0.5, 3, var_new_nil());
+    var_plan_t* plan = var_format_compile("(_i__)");
+
+    var_arena_t* arena = var_arena_new(0);
+    var_arena_use(arena);
+    var_set(heap, "(i_f_)", BOXED, 1e300);
+    var_set_plan(heap, plan, BOXED + 1);
+    var_set(heap, "(___v)", str);
+    testgen_set_2(gen, BOXED);
+    testgen_set_3_0(gen, 1e300);
+    testgen_set_3_1(gen, UINT64_MAX);
+    var_arena_reset(arena);
+    scribble();
+    var_arena_use(NULL);
+    var_arena_delete(arena);
+
+    int64_t a, b;
+    double f;
+    const char* s;
+    var_get(heap, "(iifs)", &a, &b, &f, &s);
+    assert(a == BOXED && b == BOXED + 1 && f == 1e300 && strcmp(s, LONG_STR) == 0);
+    assert(testgen_get_2(gen) == BOXED && testgen_get_3_0(gen) == 1e300 && testgen_get_3_1(gen) == UINT64_MAX);
+    var_delete(heap);
+    var_delete(str);
+    var_delete(gen);
+    var_plan_delete(plan);
+}
+
+
+typedef struct grow {
+    var_arena_t*    own;
+    var_arena_t*    other;  // in use while growing, `NULL` for none
+    var_t*          list;
+    var_t*          str;
+} grow_t;
+
+
+static void push(void* arg) {
+    grow_t* g = arg;
+    var_arena_use(g->other);
+    var_list_push(g->list, var_new_int(1));
+}
+
+
+static void assign(void* arg) {
+    grow_t* g = arg;
+    var_arena_use(g->other);
+    var_set(g->str, "s", LONG_STR);
+}
+
+
+static void box(void* arg) {
+    grow_t* g = arg;
+    var_arena_use(g->other);
+    var_set(g->list, "[i]", BOXED);
+}
+
+
+static void share(void* arg) {
+    grow_t* g = arg;
+    var_arena_use(NULL);
+    var_t* str = var_new_string(LONG_STR);
+    var_arena_use(g->other);
+    var_set(g->list, "[_v]", str);
+}
+
+
+// growing in another arena, or on the heap, is an error
+static void test_other(void) {
+    grow_t g = { .own = var_arena_new(0), .other = var_arena_new(0) };
+    var_arena_use(g.own);
+    g.list = var_new_list(NULL);
+    g.str = var_new_string("short");
+    var_arena_use(NULL);
+
+    assert(dies(push, &g));
+    assert(dies(assign, &g));
+    var_arena_delete(g.other);
+    g.other = NULL;
+    assert(dies(push, &g));
+    assert(dies(assign, &g));
+
+    // the same in its own arena
+    g.other = g.own;
+    push(&g);
+    assign(&g);
+    var_arena_use(NULL);
+    assert(var_len(g.list) == 1);
+    check_str(g.str, LONG_STR);
+
+    // scalars are boxed into the arena of their container, payloads are not shared with the heap
+    var_arena_use(g.own);
+    var_list_push(g.list, var_new_nil());
+    var_arena_use(NULL);
+    g.other = NULL;
+    assert(dies(box, &g));
+    assert(dies(share, &g));
+    g.other = g.own;
+    box(&g);
+    assert(dies(share, &g));
+    var_arena_use(NULL);
+    int64_t v;
+    var_get(g.list, "[i]", &v);
+    assert(v == BOXED);
+    var_arena_delete(g.own);
+}
+
+
+int main(void) {
+    test_reset();
+    test_heap();
+    test_own();
+    test_box();
+    test_other();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,374 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+#include "testgen.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * every constructor returns `NULL` while its `var_t` do not fit into the budget in use,
+ * deletes the `var_t*` it was passed, and builds the same tree once they fit.
+ * `testgen.h` is written by `vargen` for `name_new` of generated code, see the `testbudget` rule.
+ * build the library first, e.g. `make type && make testbudget && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+
+
+// builds the same tree every time, it is called with `budget` in use around the constructor only
+typedef var_t* (*make_fn)(var_budget_t* budget);
+
+
+static var_t* under(var_budget_t* budget, var_t* (*fn)(void* arg), void* arg) {
+    var_budget_use(budget);
+    var_t* res = fn(arg);
+    var_budget_use(NULL);
+    return res;
+}
+
+
+/*
+ * `make` with budgets of every size up to what it needs.
+ * constructors check all they allocate at once, parsers check before every value,
+ * the sizes between are `NULL` for both, the first size that fits builds the tree.
+ */
+static void sweep(const char* name, make_fn make) {
+    var_budget_t unlimited = { .limit = SIZE_MAX, .used = 0 };
+    var_t* expect = make(&unlimited);
+    assert(expect != NULL);
+    size_t need = unlimited.used;
+
+    for (size_t limit = 0; limit <= need; limit++) {
+        var_budget_t budget = { .limit = limit, .used = 0 };
+        var_t* res = make(&budget);
+        if (res == NULL) {
+            if (limit == need) fprintf(stderr, "%s: NULL with all it needs\n", name);
+            assert(limit < need);
+            continue;
+        }
+        assert(budget.used <= limit);
+        if (limit < need) fprintf(stderr, "%s: built with %zu of %zu\n", name, limit, need);
+        assert(limit == need);
+        assert(var_equal(res, expect));
+        var_delete(res);
+    }
+    var_delete(expect);
+}
+
+
+static var_t* new_int(void* arg) {
+    (void) arg;
+    return var_new_int(BOXED);
+}
+
+static var_t* make_int(var_budget_t* budget) {
+    return under(budget, new_int, NULL);
+}
+
+
+static var_t* new_uint(void* arg) {
+    (void) arg;
+    return var_new_uint(UINT64_MAX);
+}
+
+static var_t* make_uint(var_budget_t* budget) {
+    return under(budget, new_uint, NULL);
+}
+
+
+static var_t* new_float(void* arg) {
+    (void) arg;
+    return var_new_float(1e300);
+}
+
+static var_t* make_float(var_budget_t* budget) {
+    return under(budget, new_float, NULL);
+}
+
+
+static var_t* new_string(void* arg) {
+    return var_new_string("%s %d", (const char*) arg, 7);
+}
+
+static var_t* make_string(var_budget_t* budget) {
+    return under(budget, new_string, LONG_STR);
+}
+
+static var_t* make_short(var_budget_t* budget) {
+    return under(budget, new_string, "short");
+}
+
+
+static var_t* new_var_string(void* arg) {
+    (void) arg;
+    return var_new(VAR_STRING, "%s", LONG_STR);
+}
+
+static var_t* make_var_string(var_budget_t* budget) {
+    return under(budget, new_var_string, NULL);
+}
+
+
+// elements are made before the budget, the constructor takes them
+static var_t* new_array(void* arg) {
+    var_t** elem = arg;
+    return var_new_array(elem[0], elem[1], NULL);
+}
+
+static var_t* make_array(var_budget_t* budget) {
+    var_t* elem[] = { var_new_string(LONG_STR), var_new_int(BOXED) };
+    return under(budget, new_array, elem);
+}
+
+
+static var_t* new_var_array(void* arg) {
+    var_t** elem = arg;
+    return var_new(VAR_ARRAY, elem[0], elem[1], NULL);
+}
+
+static var_t* make_var_array(var_budget_t* budget) {
+    var_t* elem[] = { var_new_string(LONG_STR), var_new_int(BOXED) };
+    return under(budget, new_var_array, elem);
+}
+
+
+static var_t* new_array_size(void* arg) {
+    (void) arg;
+    return var_new_array_size(100);
+}
+
+static var_t* make_array_size(var_budget_t* budget) {
+    return under(budget, new_array_size, NULL);
+}
+
+
+static var_t* new_list(void* arg) {
+    var_t** elem = arg;
+    return var_new_list(elem[0], elem[1], NULL);
+}
+
+static var_t* make_list(var_budget_t* budget) {
+    var_t* elem[] = { var_new_string(LONG_STR), var_new_int(BOXED) };
+    return under(budget, new_list, elem);
+}
+
+
+static var_t* new_var_list(void* arg) {
+    var_t** elem = arg;
+    return var_new(VAR_LIST, elem[0], elem[1], NULL);
+}
+
+static var_t* make_var_list(var_budget_t* budget) {
+    var_t* elem[] = { var_new_string(LONG_STR), var_new_int(BOXED) };
+    return under(budget, new_var_list, elem);
+}
+
+
+static var_t* new_empty_list(void* arg) {
+    (void) arg;
+    return var_new_list(NULL);
+}
+
+static var_t* make_empty_list(var_budget_t* budget) {
+    return under(budget, new_empty_list, NULL);
+}
+
+
+// the dict takes keys and vals even over the budget, the key and val arrays stay with the caller
+static void free_shell(var_t* arr) {
+    free(arr->data.a);
+    free(arr);
+}
+
+static var_t* new_dict(void* arg) {
+    var_t** arr = arg;
+    return var_new_dict(arr[0], arr[1]);
+}
+
+static var_t* make_dict(var_budget_t* budget) {
+    var_t* arr[] = {
+        var_new_array(var_new_string("key one"), var_new_string(LONG_STR), NULL),
+        var_new_array(var_new_int(1), var_new_float(1e300), NULL),
+    };
+    var_t* res = under(budget, new_dict, arr);
+    free_shell(arr[0]);
+    free_shell(arr[1]);
+    return res;
+}
+
+
+static var_t* new_empty_dict(void* arg) {
+    (void) arg;
+    return var_new_dict(NULL, NULL);
+}
+
+static var_t* make_empty_dict(var_budget_t* budget) {
+    return under(budget, new_empty_dict, NULL);
+}
+
+
+static var_t* new_sharded(void* arg) {
+    (void) arg;
+    return var_new_dict_sharded(4);
+}
+
+static var_t* make_sharded(var_budget_t* budget) {
+    return under(budget, new_sharded, NULL);
+}
+
+
+static var_t* new_copy(void* arg) {
+    return var_copy(arg);
+}
+
+static var_t* make_copy(var_budget_t* budget) {
+    var_t* src = var_news("(s[sif]u)", LONG_STR, "short", BOXED, 1e300, UINT64_MAX);
+    var_t* res = under(budget, new_copy, src);
+    var_delete(src);
+    return res;
+}
+
+
+// same tree as `make_copy`, from every parser
+static const char* JSON = "[\"" LONG_STR "\", [\"short\", 4611686018427387904, 1e300], 18446744073709551615]";
+
+static var_t* new_json(void* arg) {
+    (void) arg;
+    return var_from_json(JSON, strlen(JSON));
+}
+
+static var_t* make_json(var_budget_t* budget) {
+    return under(budget, new_json, NULL);
+}
+
+
+static var_t* new_deserialize(void* arg) {
+    const var_buf_t* buf = arg;
+    return var_deserialize(buf->data, buf->len, NULL);
+}
+
+static var_t* make_deserialize(var_budget_t* budget) {
+    var_t* src = var_news("(s[sif]u)", LONG_STR, "short", BOXED, 1e300, UINT64_MAX);
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_serialize(src, &buf);
+    var_delete(src);
+    var_t* res = under(budget, new_deserialize, &buf);
+    var_buf_free(&buf);
+    return res;
+}
+
+
+static var_t* new_deserialize_file(void* arg) {
+    FILE* fp = arg;
+    rewind(fp);
+    return var_deserialize_file(fp);
+}
+
+static var_t* make_deserialize_file(var_budget_t* budget) {
+    var_t* src = var_news("(s[sif]u)", LONG_STR, "short", BOXED, 1e300, UINT64_MAX);
+    FILE* fp = tmpfile();
+    assert(fp != NULL && var_serialize_file(src, fp));
+    var_delete(src);
+    var_t* res = under(budget, new_deserialize_file, fp);
+    fclose(fp);
+    return res;
+}
+
+
+static var_t* new_materialize(void* arg) {
+    return var_view_materialize(arg);
+}
+
+static var_t* make_materialize(var_budget_t* budget) {
+    var_t* src = var_news("(s[sif]u)", LONG_STR, "short", BOXED, 1e300, UINT64_MAX);
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_serialize_indexed(src, &buf);
+    var_delete(src);
+    var_view_t view;
+    assert(var_view_init(&view, buf.data, buf.len));
+    var_t* res = under(budget, new_materialize, &view);
+    var_buf_free(&buf);
+    return res;
+}
+
+
+// generated code, the `var_t*` argument is made before the budget
+static var_t* new_gen(void* arg) {
+    return testgen_new(LONG_STR, "short", BOXED, 7, 1e300, UINT64_MAX, arg);
+}
+
+static var_t* make_gen(var_budget_t* budget) {
+    return under(budget, new_gen, var_new_string(LONG_STR));
+}
+
+
+// a `var_t*` argument of generated code that was over the budget itself
+static void test_gen_null(void) {
+    var_budget_t budget = { .limit = 0, .used = 0 };
+    var_budget_use(&budget);
+    var_t* res = testgen_new("a", "b", 1, 2, 0.5, 3, var_new_string(LONG_STR));
+    var_budget_use(NULL);
+    assert(res == NULL);
+}
+
+
+// changes are counted but never fail, nor does `var_news`
+static void test_changes(void) {
+    var_budget_t budget = { .limit = 0, .used = 0 };
+    var_budget_use(&budget);
+    var_t* res = var_news("(s[i]f)", LONG_STR, BOXED, 1e300);
+    assert(res != NULL && budget.used > 0);
+    var_set(res, "(s[i]_)", LONG_STR LONG_STR, BOXED + 1);
+    var_budget_use(NULL);
+    var_delete(res);
+
+    var_t* gen = testgen_new("a", "b", 1, 2, 0.5, 3, var_new_nil());
+    var_budget_use(&budget);
+    testgen_set_1_1(gen, BOXED);
+    testgen_set_3_0(gen, 1e300);
+    testgen_set_3_1(gen, UINT64_MAX);
+    testgen_set_0(gen, LONG_STR);
+    var_budget_use(NULL);
+    assert(testgen_get_1_1(gen) == BOXED && testgen_get_3_1(gen) == UINT64_MAX);
+    var_delete(gen);
+
+    // immediates take nothing
+    var_budget_use(&budget);
+    assert(var_new_int(1) != NULL && var_new_float(0.5) != NULL && var_new_nil() != NULL);
+    var_budget_use(NULL);
+}
+
+
+int main(void) {
+    sweep("var_new_int", make_int);
+    sweep("var_new_uint", make_uint);
+    sweep("var_new_float", make_float);
+    sweep("var_new_string", make_string);
+    sweep("var_new_string short", make_short);
+    sweep("var_new VAR_STRING", make_var_string);
+    sweep("var_new_array", make_array);
+    sweep("var_new VAR_ARRAY", make_var_array);
+    sweep("var_new_array_size", make_array_size);
+    sweep("var_new_list", make_list);
+    sweep("var_new VAR_LIST", make_var_list);
+    sweep("var_new_list empty", make_empty_list);
+    sweep("var_new_dict", make_dict);
+    sweep("var_new_dict empty", make_empty_dict);
+    sweep("var_new_dict_sharded", make_sharded);
+    sweep("var_copy", make_copy);
+    sweep("var_from_json", make_json);
+    sweep("var_deserialize", make_deserialize);
+    sweep("var_deserialize_file", make_deserialize_file);
+    sweep("var_view_materialize", make_materialize);
+    sweep("testgen_new", make_gen);
+    test_gen_null();
+    test_changes();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "src/type.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * `var_copy` builds the whole tree in one block, see `varcopy.c`.
+ * the copy must behave like a tree of `var_new_*`: it grows, is retained,
+ * takes new heap elements and gives its elements away, in any order of deletes.
+ * build the library first, e.g. `make type && make testcopy && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+
+
+// {"k": ("first element long string", 1e300, [<20 strings>]), "key two that is long": 7}
+static var_t* template(void) {
+    var_t* list = var_new_list(NULL);
+    for (int i = 0; i < 20; i++) {
+        var_list_push(list, var_new_string("a long element string %d", i));
+    }
+    var_t* arr = var_new_array(var_new_string("first element long string"), var_new_float(1e300), list, NULL);
+
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_dict_put(dict, var_new_string("k"), arr);
+    var_dict_put(dict, var_new_string("key two that is long"), var_new_int(7));
+    return dict;
+}
+
+
+// the list inside of `dict`, borrowed
+static var_t* inner_list(var_t* dict) {
+    var_t* key = var_new_string("k");
+    var_t* list;
+    var_get(var_dict_get(dict, key), "(__v)", &list);
+    var_delete(key);
+    return list;
+}
+
+
+static void test_equal(void) {
+    var_t* src = template();
+    var_t* copy = var_copy(src);
+    assert(var_equal(src, copy));
+    assert(var_compare(src, copy) == 0);
+
+    // copies do not share anything with their source
+    var_list_push(inner_list(copy), var_new_int(1));
+    assert(var_equal(src, copy) == false);
+    var_delete(src);
+    assert(var_len(inner_list(copy)) == 21);
+    var_delete(copy);
+
+    // immediates and short strings
+    assert(var_copy(var_new_int(5)) == var_new_int(5));
+    var_t* s = var_new_string("short");
+    var_t* c = var_copy(s);
+    assert(var_equal(s, c));
+    var_delete(s);
+    var_delete(c);
+}
+
+
+// payloads of the block move to the heap as they grow
+static void test_grow(void) {
+    var_t* src = var_new_array(var_new_string("short"), var_new_list(NULL), NULL);
+    var_t* copy = var_copy(src);
+    var_delete(src);
+    var_t* list;
+    var_get(copy, "(_v)", &list);
+    for (int i = 0; i < 100; i++) {
+        var_list_push(list, var_new_string("pushed string number %d", i));
+    }
+    var_set(copy, "(s_)", LONG_STR);
+
+    const char* str;
+    var_get(copy, "(s_)", &str);
+    assert(strcmp(str, LONG_STR) == 0);
+    assert(var_len(list) == 100);
+    var_delete(copy);
+}
+
+
+static void test_retain(void) {
+    var_t* src = template();
+    var_t* copy = var_copy(src);
+    var_t* retained = var_retain(copy);
+    var_delete(src);
+
+    // the copy changes, the retained payload does not
+    var_dict_put(copy, var_new_string("new heap key, long enough"), var_new_string("new heap val, long enough"));
+    assert(var_len(copy) == 3);
+    assert(var_len(retained) == 2);
+
+    var_delete(copy);
+    assert(var_len(inner_list(retained)) == 20);
+    var_delete(retained);
+}
+
+
+// elements taken out of the copy outlive it
+static void test_pop(void) {
+    var_t* src = template();
+    var_t* copy = var_copy(src);
+    var_delete(src);
+    var_t* list = inner_list(copy);
+    var_t* popped = var_list_pop(list);
+    var_t* elem = var_retain(var_list_at(list, 0));
+    var_delete(copy);
+
+    const char* str;
+    var_get(popped, "s", &str);
+    assert(strcmp(str, "a long element string 19") == 0);
+    var_get(elem, "s", &str);
+    assert(strcmp(str, "a long element string 0") == 0);
+    var_delete(popped);
+    var_delete(elem);
+}
+
+
+// a copy grows while an arena is in use, its payloads are not moved into the arena
+static void test_arena(void) {
+    var_t* src = template();
+    var_t* copy = var_copy(src);
+    var_t* list = inner_list(copy);
+
+    var_arena_t* arena = var_arena_new(0);
+    var_arena_use(arena);
+    for (int i = 0; i < 100; i++) {
+        var_list_push(list, var_new_int(i));
+    }
+    var_arena_use(NULL);
+    var_arena_delete(arena);
+
+    for (int i = 0; i < 100; i++) {
+        var_list_push(list, var_new_string("pushed string number %d", i));
+    }
+    assert(var_len(list) == 220);
+    var_delete(copy);
+    var_delete(src);
+}
+
+
+int main(void) {
+    test_equal();
+    test_grow();
+    test_retain();
+    test_pop();
+    test_arena();
+    puts("ok");
+    return 0;
+}
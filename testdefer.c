@@ -0,0 +1,94 @@
+#include "src/type.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <threads.h>
+
+
+/*
+ * every tree passed to `var_delete_deferred` is freed once `var_defer_drain` returns,
+ * from any number of threads and whatever the queue does while it is full.
+ * the leak sanitizer of the default build checks that nothing is left.
+ * build the library first, e.g. `make type && make testdefer && ./test`,
+ * or run it under the thread sanitizer with `make tsan TEST=testdefer && ./test`
+ */
+
+
+#define THREADS 4
+#define TREES   500
+
+
+static var_t* tree(int len) {
+    var_t* list = var_new_list(NULL);
+    for (int i = 0; i < len; i++) {
+        var_list_push(list, var_new_array(var_new_string("a string that is long %d", i), var_new_float(i + 1e300), NULL));
+    }
+    return list;
+}
+
+
+static int producer(void* arg) {
+    (void) arg;
+    for (int i = 0; i < TREES; i++) {
+        var_delete_deferred(tree(20));
+        var_delete_deferred(var_new_string("short"));
+        var_delete_deferred(var_new_int(i));
+    }
+    return 0;
+}
+
+
+static void run_producers(void) {
+    thrd_t thread[THREADS];
+    for (size_t i = 0; i < THREADS; i++) {
+        assert(thrd_create(&thread[i], producer, NULL) == thrd_success);
+    }
+    for (size_t i = 0; i < THREADS; i++) {
+        thrd_join(thread[i], NULL);
+    }
+}
+
+
+// every kind of `var_t` that `var_delete` takes
+static void test_kinds(void) {
+    var_delete_deferred(tree(1000));
+    var_delete_deferred(var_new_nil());
+    var_delete_deferred(var_new_float(1e300));
+
+    var_t* dict = var_new_dict_sharded(0);
+    var_dict_put(dict, var_new_string("key that is long enough"), tree(3));
+    var_delete_deferred(dict);
+
+    var_t* src = tree(10);
+    var_delete_deferred(var_copy(src));
+    var_delete_deferred(src);
+
+    // arena trees are deleted right away
+    var_arena_t* arena = var_arena_new(0);
+    var_arena_use(arena);
+    var_delete_deferred(tree(10));
+    var_arena_use(NULL);
+    var_arena_delete(arena);
+    var_defer_drain();
+}
+
+
+int main(void) {
+    test_kinds();
+
+    // a small queue, producers wait for room
+    var_defer_config(4, 2, VAR_DEFER_WAIT);
+    run_producers();
+    var_defer_drain();
+
+    // a small queue, producers delete themselves
+    var_defer_config(4, 2, VAR_DEFER_INLINE);
+    run_producers();
+    var_defer_drain();
+
+    var_defer_config(0, 0, VAR_DEFER_WAIT);
+    run_producers();
+    var_defer_drain();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,371 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <threads.h>
+
+
+/*
+ * a dict is one open addressing table, removed slots are reused by later puts.
+ * in incremental mode it grows into a second table step by step, and is read from both meanwhile.
+ * a sharded dict is a dict for every function that reads it,
+ * and takes puts, removes and lookups from many threads at once.
+ * build the library first, e.g. `make type && make testdict && ./test`,
+ * or run it under the thread sanitizer with `make tsan TEST=testdict && ./test`
+ */
+
+
+#define LONG_KEY "a key that does not fit inside of `var_t`"
+#define KEYS    2000
+#define THREADS 4
+#define OPS     20000
+
+
+static void count(var_t* key, var_t* val, void* arg) {
+    (void) key;
+    (void) val;
+    (*(size_t*) arg)++;
+}
+
+
+static size_t scan_len(const var_t* dict) {
+    size_t len = 0;
+    uint64_t cursor = 0;
+    do {
+        cursor = var_dict_scan(dict, cursor, count, &len);
+    } while (cursor != 0);
+    return len;
+}
+
+
+static int64_t get_int(const var_t* dict, int64_t k) {
+    var_t* key = var_new_int(k);
+    var_t* val = var_dict_get(dict, key);
+    var_delete(key);
+    if (val == NULL) return -1;
+    int64_t res;
+    var_get(val, "i", &res);
+    return res;
+}
+
+
+// grows, removes every other key and puts them back into the removed slots
+static void test_table(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    assert(var_len(dict) == 0 && get_int(dict, 0) == -1);
+    for (int64_t i = 0; i < 100000; i++) {
+        var_dict_put(dict, var_new_int(i), var_new_int(i * 3));
+    }
+    assert(var_len(dict) == 100000 && scan_len(dict) == 100000);
+    for (int64_t i = 0; i < 100000; i++) assert(get_int(dict, i) == i * 3);
+
+    for (int64_t i = 1; i < 100000; i += 2) {
+        var_t* key = var_new_int(i);
+        assert(var_dict_remove(dict, key) && var_dict_remove(dict, key) == false);
+        var_delete(key);
+    }
+    assert(var_len(dict) == 50000 && scan_len(dict) == 50000);
+    for (int64_t i = 0; i < 100000; i++) assert(get_int(dict, i) == (i % 2 ? -1 : i * 3));
+
+    // many rounds of put and remove of new keys do not fill the table with removed slots
+    size_t size = var_memory_usage(dict, NULL);
+    for (int64_t i = 0; i < 1000000; i++) {
+        var_t* key = var_new_int(-i - 1);
+        var_dict_put(dict, var_new_int(-i - 1), var_new_nil());
+        assert(var_dict_remove(dict, key));
+        var_delete(key);
+    }
+    assert(var_memory_usage(dict, NULL) == size && var_len(dict) == 50000);
+    for (int64_t i = 1; i < 100000; i += 2) {
+        var_dict_put(dict, var_new_int(i), var_new_int(i * 3));
+    }
+    assert(var_len(dict) == 100000 && scan_len(dict) == 100000);
+    for (int64_t i = 0; i < 100000; i++) assert(get_int(dict, i) == i * 3);
+    var_delete(dict);
+}
+
+
+// keys of the same hash probe past each other, and past removed slots of them
+static void test_collide(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_t* key[100];
+    for (int i = 0; i < 100; i++) {
+        key[i] = var_new_string("colliding key %d", i);
+        var_dict_put_hashed(dict, var_copy(key[i]), var_new_int(i), 42);
+    }
+    assert(var_len(dict) == 100);
+    for (int i = 0; i < 100; i += 3) {
+        assert(var_dict_remove_hashed(dict, key[i], 42));
+    }
+    for (int i = 0; i < 100; i++) {
+        var_t* val = var_dict_get_hashed(dict, key[i], 42);
+        assert((val == NULL) == (i % 3 == 0));
+        if (val != NULL) {
+            int64_t v;
+            var_get(val, "i", &v);
+            assert(v == i);
+        }
+    }
+    for (int i = 0; i < 100; i += 3) {
+        var_dict_put_hashed(dict, key[i], var_new_int(i), 42);
+    }
+    assert(var_len(dict) == 100 && scan_len(dict) == 100);
+    for (int i = 0; i < 100; i++) assert(var_dict_contains_hashed(dict, key[i], 42));
+    for (int i = 0; i < 100; i++) {
+        if (i % 3) var_delete(key[i]);
+    }
+    var_delete(dict);
+}
+
+
+// every key put before is found at each step of an incremental resize
+static void test_incremental(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_dict_incremental(dict, true);
+    size_t steps = 0;
+    for (int64_t i = 0; i < 20000; i++) {
+        var_dict_put(dict, var_new_int(i), var_new_int(i * 3));
+        if (dict->data.d->old.cap == 0) continue;
+
+        steps++;
+        assert(var_len(dict) == (size_t) i + 1);
+        for (int64_t k = i % 7; k <= i; k += 7) assert(get_int(dict, k) == k * 3);
+    }
+    assert(steps > 0);
+
+    // removes during resize find keys in either table
+    var_dict_put(dict, var_new_int(20000), var_new_nil());
+    for (int64_t i = 0; dict->data.d->old.cap == 0; i++) {
+        var_dict_put(dict, var_new_int(20001 + i), var_new_nil());
+    }
+    for (int64_t i = 0; i < 20000; i += 2) {
+        var_t* key = var_new_int(i);
+        assert(var_dict_remove(dict, key));
+        var_delete(key);
+    }
+    for (int64_t i = 0; i < 20000; i++) assert(get_int(dict, i) == (i % 2 ? i * 3 : -1));
+
+    // turning it off finishes the resize
+    var_dict_incremental(dict, false);
+    assert(dict->data.d->old.cap == 0 && scan_len(dict) == var_len(dict));
+    for (int64_t i = 1; i < 20000; i += 2) assert(get_int(dict, i) == i * 3);
+    var_delete(dict);
+}
+
+
+static void mark(var_t* key, var_t* val, void* arg) {
+    (void) val;
+    int64_t k;
+    var_get(key, "i", &k);
+    if (k < 1000) ((int*) arg)[k]++;
+}
+
+
+// a scan visits every key at least once while the dict grows between calls, and once if not
+static void test_scan(bool incremental) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_dict_incremental(dict, incremental);
+    assert(scan_len(dict) == 0);
+    for (int64_t i = 0; i < 1000; i++) var_dict_put(dict, var_new_int(i), var_new_nil());
+
+    int seen[1000] = {0};
+    uint64_t cursor = 0;
+    do {
+        cursor = var_dict_scan(dict, cursor, mark, seen);
+    } while (cursor != 0);
+    for (int i = 0; i < 1000; i++) assert(seen[i] == 1);
+
+    memset(seen, 0, sizeof (seen));
+    int64_t next = 1000;
+    do {
+        cursor = var_dict_scan(dict, cursor, mark, seen);
+        for (int i = 0; i < 100; i++, next++) var_dict_put(dict, var_new_int(next), var_new_nil());
+    } while (cursor != 0);
+    for (int i = 0; i < 1000; i++) assert(seen[i] >= 1);
+    var_delete(dict);
+}
+
+
+// keys of every hashable type, equal by type and value
+static void test_keys(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_t* key[] = {
+        var_new_int(1), var_new_uint(1), var_new_float(1.0), var_new_int(INT64_MAX),
+        var_new_string("1"), var_new_string(LONG_KEY), var_news("(is)", (int64_t) 1, LONG_KEY),
+    };
+    size_t n = sizeof (key) / sizeof (key[0]);
+    for (size_t i = 0; i < n; i++) {
+        var_dict_put(dict, var_copy(key[i]), var_new_int((int64_t) i));
+    }
+    assert(var_len(dict) == n);
+    for (size_t i = 0; i < n; i++) {
+        int64_t v;
+        var_get(var_dict_get(dict, key[i]), "i", &v);
+        assert(v == (int64_t) i && var_dict_contains(dict, key[i]));
+    }
+
+    // unhashable keys are never found
+    var_t* list = var_new_list(var_new_int(1), NULL);
+    assert(var_dict_get(dict, list) == NULL && var_dict_get_retain(dict, list) == NULL);
+    assert(var_dict_contains(dict, list) == false && var_dict_remove(dict, list) == false);
+    var_delete(list);
+
+    // a replaced val is deleted, the dict keeps its key
+    var_t* val = var_new_string(LONG_KEY);
+    var_dict_put(dict, var_copy(key[5]), val);
+    assert(var_len(dict) == n && var_dict_get(dict, key[5]) == val);
+
+    // a retained val outlives its removal
+    var_t* retained = var_dict_get_retain(dict, key[5]);
+    assert(var_dict_remove(dict, key[5]) && var_dict_contains(dict, key[5]) == false);
+    assert(var_len(dict) == n - 1 && var_equal(retained, key[5]));
+    var_delete(retained);
+
+    for (size_t i = 0; i < n; i++) var_delete(key[i]);
+    var_delete(dict);
+}
+
+
+// a key hashed once is looked up in many dicts
+static void test_hashed(void) {
+    var_t* key = var_new_string(LONG_KEY);
+    uint64_t hash;
+    assert(var_hash(key, &hash));
+    var_t* dict[3];
+    for (int64_t i = 0; i < 3; i++) {
+        dict[i] = var_new_dict(NULL, NULL);
+        var_dict_put_hashed(dict[i], var_copy(key), var_new_int(i), hash);
+    }
+    for (int64_t i = 0; i < 3; i++) {
+        int64_t v;
+        var_get(var_dict_get_hashed(dict[i], key, hash), "i", &v);
+        assert(v == i && var_dict_get(dict[i], key) == var_dict_get_hashed(dict[i], key, hash));
+        assert(var_dict_contains_hashed(dict[i], key, hash));
+        assert(var_dict_remove_hashed(dict[i], key, hash) && var_dict_remove_hashed(dict[i], key, hash) == false);
+        assert(var_len(dict[i]) == 0);
+        var_delete(dict[i]);
+    }
+    var_delete(key);
+}
+
+
+// same as a plain dict with the same elements
+static void test_plain(void) {
+    var_t* sharded = var_new_dict_sharded(0);
+    var_t* plain = var_new_dict(NULL, NULL);
+    for (int64_t i = 0; i < 1000; i++) {
+        var_dict_put(sharded, var_new_int(i), var_new_string("value number %d", (int) i));
+        var_dict_put(plain, var_new_int(i), var_new_string("value number %d", (int) i));
+    }
+    assert(var_len(sharded) == 1000 && scan_len(sharded) == 1000);
+    assert(var_equal(sharded, plain) && var_compare(plain, sharded) == 0);
+
+    // copies and retained payloads are dicts of their own
+    var_t* copy = var_copy(sharded);
+    assert(var_equal(copy, plain));
+    var_t* retained = var_retain(sharded);
+    var_dict_put(retained, var_new_int(5000), var_new_nil());
+    assert(var_len(sharded) == 1000 && var_len(retained) == 1001);
+    var_delete(retained);
+    var_delete(copy);
+
+    // an arena cannot hold shards, the copy inside of it is a plain dict
+    var_arena_t* arena = var_arena_new(0);
+    var_arena_use(arena);
+    assert(var_equal(var_copy(sharded), plain));
+    var_arena_use(NULL);
+    var_arena_delete(arena);
+
+    var_buf_t a, b;
+    var_buf_init(&a);
+    var_buf_init(&b);
+    var_to_json(sharded, &a, 0);
+    var_to_json(plain, &b, 0);
+    assert(a.len == b.len);
+    var_buf_free(&a);
+    var_buf_free(&b);
+
+    for (int64_t i = 0; i < 1000; i++) {
+        var_t* key = var_new_int(i);
+        assert(var_dict_remove(sharded, key));
+        var_delete(key);
+    }
+    assert(var_len(sharded) == 0);
+    var_delete(sharded);
+    var_delete(plain);
+}
+
+
+static var_t* shared;
+
+
+// vals are immediate, retaining them does not touch a reference count
+static int worker(void* arg) {
+    unsigned seed = (unsigned) (uintptr_t) arg * 7919 + 1;
+    for (int i = 0; i < OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        int64_t k = (seed >> 8) % KEYS;
+        var_t* key = var_new_string("key number %d, long enough", (int) k);
+
+        if ((seed >> 4) % 4 == 0) {
+            if ((seed >> 12) & 1) {
+                var_dict_put(shared, key, var_new_int(k * 2));
+                continue;
+            }
+            var_dict_remove(shared, key);
+        } else {
+            var_t* val = var_dict_get_retain(shared, key);
+            if (val != NULL) {
+                int64_t v;
+                var_get(val, "i", &v);
+                assert(v == k * 2);
+                var_delete(val);
+            }
+        }
+        var_delete(key);
+    }
+    return 0;
+}
+
+
+static void test_threads(bool copy) {
+    shared = var_new_dict_sharded(0);
+    var_dict_incremental(shared, true);
+    if (copy) {
+        // a copy keeps the shards, threads write to it the same way
+        for (int64_t k = 0; k < KEYS; k += 2) {
+            var_dict_put(shared, var_new_string("key number %d, long enough", (int) k), var_new_int(k * 2));
+        }
+        var_t* orig = shared;
+        shared = var_copy(orig);
+        var_delete(orig);
+    }
+
+    thrd_t thread[THREADS];
+    for (size_t i = 0; i < THREADS; i++) {
+        assert(thrd_create(&thread[i], worker, (void*) (uintptr_t) i) == thrd_success);
+    }
+    for (size_t i = 0; i < THREADS; i++) {
+        thrd_join(thread[i], NULL);
+    }
+
+    assert(scan_len(shared) == var_len(shared));
+    var_delete(shared);
+}
+
+
+int main(void) {
+    test_table();
+    test_collide();
+    test_incremental();
+    test_scan(false);
+    test_scan(true);
+    test_keys();
+    test_hashed();
+    test_plain();
+    test_threads(false);
+    test_threads(true);
+    puts("ok");
+    return 0;
+}
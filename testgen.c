@@ -0,0 +1,122 @@
+#include "src/type.h"
+#include "testgen.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * accessors generated by `vargen` agree with `var_news`, `var_get` and `var_set` of the same format,
+ * setters copy a shared payload at every level before they change it.
+ * `testgen.h` is written by `vargen`, see the `testgen` rule.
+ * build the library first, e.g. `make type && make testgen && ./test`
+ */
+
+
+#define SCHEMA   "(s(si)i[fu]v)"
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+
+
+static void test_check(void) {
+    var_t* gen = testgen_new("a", LONG_STR, BOXED, 2, 0.5, 3, var_new_nil());
+    assert(testgen_check(gen));
+
+    var_t* same = var_news(SCHEMA, "a", LONG_STR, BOXED, (int64_t) 2, 0.5, (uint64_t) 3, var_new_nil());
+    assert(testgen_check(same) && var_equal(gen, same));
+
+    // lists may be longer, arrays may not
+    var_t* longer = var_news("(s(si)i[fui]v)", "a", "b", (int64_t) 1, (int64_t) 2, 0.5, (uint64_t) 3, (int64_t) 4, var_new_nil());
+    assert(testgen_check(longer));
+
+    var_t* other[] = {
+        var_news("(s(si)i[fu])", "a", "b", (int64_t) 1, (int64_t) 2, 0.5, (uint64_t) 3),
+        var_news("(s(si)i[fu]vv)", "a", "b", (int64_t) 1, (int64_t) 2, 0.5, (uint64_t) 3, var_new_nil(), var_new_nil()),
+        var_news("(s(s)i[fu]v)", "a", "b", (int64_t) 2, 0.5, (uint64_t) 3, var_new_nil()),
+        var_news("(s(sii)i[fu]v)", "a", "b", (int64_t) 1, (int64_t) 1, (int64_t) 2, 0.5, (uint64_t) 3, var_new_nil()),
+        var_news("(s(si)i[f]v)", "a", "b", (int64_t) 1, (int64_t) 2, 0.5, var_new_nil()),
+        var_news("(s(si)u[fu]v)", "a", "b", (int64_t) 1, (uint64_t) 2, 0.5, (uint64_t) 3, var_new_nil()),
+        var_news("(s[si]i[fu]v)", "a", "b", (int64_t) 1, (int64_t) 2, 0.5, (uint64_t) 3, var_new_nil()),
+        var_news("(s(si)i(fu)v)", "a", "b", (int64_t) 1, (int64_t) 2, 0.5, (uint64_t) 3, var_new_nil()),
+    };
+    for (size_t i = 0; i < sizeof (other) / sizeof (other[0]); i++) {
+        assert(testgen_check(other[i]) == false);
+        var_delete(other[i]);
+    }
+
+    var_t* scalar = var_new_int(1);
+    assert(testgen_check(scalar) == false);
+
+    var_delete(gen);
+    var_delete(same);
+    var_delete(longer);
+}
+
+
+static void test_access(void) {
+    var_t* gen = testgen_new("a", LONG_STR, BOXED, 2, 0.5, 3, var_new_string(LONG_STR));
+    assert(strcmp(testgen_get_0(gen), "a") == 0 && strcmp(testgen_get_1_0(gen), LONG_STR) == 0);
+    assert(testgen_get_1_1(gen) == BOXED && testgen_get_2(gen) == 2);
+    assert(testgen_get_3_0(gen) == 0.5 && testgen_get_3_1(gen) == 3);
+
+    var_t* inner;
+    var_get(gen, "(_v___)", &inner);
+    assert(testgen_get_1(gen) == inner);
+
+    // immediates are boxed as they grow, boxed values are changed in place, strings change length
+    testgen_set_0(gen, LONG_STR);
+    testgen_set_1_0(gen, "b");
+    testgen_set_1_1(gen, 1);
+    testgen_set_2(gen, BOXED);
+    testgen_set_3_0(gen, 1e300);
+    testgen_set_3_1(gen, UINT64_MAX);
+    testgen_set_4(gen, var_new_int(7));
+    var_t* expected = var_news(SCHEMA, LONG_STR, "b", (int64_t) 1, BOXED, 1e300, UINT64_MAX, var_new_int(7));
+    assert(var_equal(gen, expected) && testgen_check(gen));
+
+    // the same with `var_set`
+    var_t* other = var_news(SCHEMA, "a", LONG_STR, BOXED, (int64_t) 2, 0.5, (uint64_t) 3, var_new_nil());
+    var_set(other, "(s(si)i[fu]_)", LONG_STR, "b", (int64_t) 1, BOXED, 1e300, UINT64_MAX);
+    testgen_set_4(other, var_new_int(7));
+    assert(var_equal(gen, other));
+
+    var_delete(other);
+    var_delete(expected);
+    var_delete(gen);
+}
+
+
+// every payload on the path of a setter is copied if shared, the other owners see no change
+static void test_shared(void) {
+    var_t* gen = testgen_new("a", LONG_STR, BOXED, 2, 0.5, 3, var_new_nil());
+    var_t* orig = var_copy(gen);
+
+    var_t* shared = var_retain(gen);
+    testgen_set_1_1(shared, 5);
+    testgen_set_3_0(shared, 0.25);
+    testgen_set_0(shared, "b");
+    assert(var_equal(gen, orig) && testgen_get_1_1(shared) == 5 && testgen_get_3_0(shared) == 0.25);
+
+    // an inner array shared on its own
+    var_t* inner = var_retain(testgen_get_1(gen));
+    testgen_set_1_0(gen, "c");
+    assert(strcmp(testgen_get_1_0(gen), "c") == 0);
+    var_t* expected = var_news("(si)", LONG_STR, BOXED);
+    assert(var_equal(inner, expected));
+
+    var_delete(expected);
+    var_delete(inner);
+    var_delete(shared);
+    var_delete(orig);
+    var_delete(gen);
+}
+
+
+int main(void) {
+    test_check();
+    test_access();
+    test_shared();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,228 @@
+#define _POSIX_C_SOURCE 200809L     // fork
+
+#include "src/type.h"
+#include "testgen.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/*
+ * `var_hash` is random per process unless seeded, a seed gives the same hashes in every process.
+ * equal values hash the same however they were made.
+ * hashes of long strings and arrays are cached, every way of changing an element drops them:
+ * `var_set` on the array or on a handle of the element, plans, and generated setters.
+ * a cached hash always equals the hash of a fresh copy, which has no cache.
+ * `testgen.h` is written by `vargen` for the setters of generated code, see the `testhash` rule.
+ * build the library first, e.g. `make type && make testhash && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+
+
+static uint64_t hash(const var_t* var) {
+    uint64_t res;
+    assert(var_hash(var, &res));
+    return res;
+}
+
+
+// hash of `var`, cached or not, is the hash of its value
+static uint64_t fresh(const var_t* var) {
+    uint64_t res = hash(var);
+    var_t* copy = var_copy(var);
+    assert(hash(copy) == res);
+    var_delete(copy);
+    return res;
+}
+
+
+// values of every hashable type, new ones every time, cached hashes keep the seed they were made with
+static uint64_t sample(void) {
+    var_t* var = var_news("(iiufss(s))", (int64_t) 1, BOXED, UINT64_MAX, 0.5, "short", LONG_STR, LONG_STR);
+    uint64_t res = hash(var);
+    var_delete(var);
+    return res;
+}
+
+
+// `sample` in a new process, seeded if `seed` is not 0
+static uint64_t sample_in_child(uint64_t seed) {
+    int fd[2];
+    assert(pipe(fd) == 0);
+    fflush(stdout);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        if (seed != 0) var_hash_seed(seed);
+        uint64_t res = sample();
+        _exit(write(fd[1], &res, sizeof (res)) == sizeof (res) ? 0 : 1);
+    }
+    uint64_t res;
+    assert(read(fd[0], &res, sizeof (res)) == sizeof (res));
+    int status;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    close(fd[0]);
+    close(fd[1]);
+    return res;
+}
+
+
+static void test_seed(void) {
+    assert(sample_in_child(7) == sample_in_child(7));
+    assert(sample_in_child(7) != sample_in_child(8));
+    assert(sample_in_child(0) != sample_in_child(0));
+
+    var_hash_seed(7);
+    uint64_t h = sample();
+    assert(h == sample_in_child(7));
+    var_hash_seed(8);
+    assert(sample() != h);
+    var_hash_seed(7);
+    assert(sample() == h);
+}
+
+
+// equal values made in different ways
+static void test_equal(void) {
+    var_t* a[] = {
+        var_new_int(1), var_new_int(BOXED), var_new_uint(2), var_new_float(0.5), var_new_float(1e300),
+        var_new_string("short"), var_new_string(LONG_STR), var_news("(is)", BOXED, LONG_STR),
+    };
+    const char* text = "[1, 4611686018427387904, 2, 0.5, 1e300, \"short\"]";
+    var_t* json = var_from_json(text, strlen(text));
+    var_t* b[] = {
+        var_list_at(json, 0), var_list_at(json, 1), var_new_uint(2), var_list_at(json, 3), var_list_at(json, 4),
+        var_list_at(json, 5), var_new_string("%s", LONG_STR), var_new_array(var_new_int(BOXED), var_intern(LONG_STR, strlen(LONG_STR)), NULL),
+    };
+    for (size_t i = 0; i < sizeof (a) / sizeof (a[0]); i++) {
+        assert(var_equal(a[i], b[i]) && hash(a[i]) == hash(b[i]));
+        var_t* copy = var_copy(a[i]);
+        var_t* shared = var_retain(a[i]);
+        assert(hash(copy) == hash(a[i]) && hash(shared) == hash(a[i]));
+        var_delete(copy);
+        var_delete(shared);
+        var_delete(a[i]);
+    }
+    var_delete(b[2]);
+    var_delete(b[6]);
+    var_delete(b[7]);
+    var_delete(json);
+}
+
+
+// changes through the array itself
+static void test_set(void) {
+    var_t* arr = var_news("((is)sf)", (int64_t) 1, LONG_STR, LONG_STR, 0.5);
+    uint64_t h = fresh(arr);
+    assert(hash(arr) == h);
+
+    var_set(arr, "((i_)__)", BOXED);
+    assert(fresh(arr) != h);
+    var_set(arr, "((i_)__)", (int64_t) 1);
+    assert(fresh(arr) == h);
+
+    var_set(arr, "((_s)__)", "short");
+    assert(fresh(arr) != h);
+    var_set(arr, "((_s)__)", LONG_STR);
+    assert(fresh(arr) == h);
+
+    var_set(arr, "(__f)", 1e300);
+    assert(fresh(arr) != h);
+    var_set(arr, "(__f)", 0.5);
+    assert(fresh(arr) == h);
+
+    // arrays hashed before are not changed by another one
+    var_t* other = var_news("(ss)", LONG_STR, "b");
+    uint64_t o = fresh(other);
+    var_set(arr, "(_s_)", "changed");
+    assert(fresh(arr) != h && hash(other) == o);
+    var_delete(other);
+    var_delete(arr);
+}
+
+
+// changes through a handle of a nested element, its arrays do not see them
+static void test_handle(void) {
+    var_t* arr = var_news("(((s)i)s)", LONG_STR, BOXED, LONG_STR);
+    uint64_t h = fresh(arr);
+
+    var_t *inner, *str, *big;
+    var_get(arr, "(((v)v)_)", &str, &big);
+    var_get(arr, "((v_)_)", &inner);
+
+    // hashing a nested array on its own keeps the cache of the outer one
+    assert(hash(inner) == hash(inner) && hash(arr) == h);
+
+    var_set(str, "s", "short");
+    assert(fresh(arr) != h);
+    var_set(str, "s", LONG_STR);
+    assert(fresh(arr) == h);
+
+    var_set(big, "i", BOXED + 1);
+    assert(fresh(arr) != h);
+    var_set(big, "i", BOXED);
+    assert(fresh(arr) == h);
+
+    // the same through a shared payload, the other owner keeps its hash
+    var_t* shared = var_retain(arr);
+    var_set(shared, "(((s)_)_)", "short");
+    assert(hash(arr) == h && fresh(shared) != h);
+    var_delete(shared);
+    var_delete(arr);
+}
+
+
+// changes through a compiled format
+static void test_plan(void) {
+    var_plan_t* plan = var_format_compile("((_i)s)");
+    var_t* arr = var_news("((si)s)", LONG_STR, BOXED, LONG_STR);
+    uint64_t h = fresh(arr);
+
+    var_set_plan(arr, plan, (int64_t) 7, "short");
+    assert(fresh(arr) != h);
+    var_set_plan(arr, plan, BOXED, LONG_STR);
+    assert(fresh(arr) == h);
+
+    var_plan_delete(plan);
+    var_delete(arr);
+}
+
+
+// changes through generated setters, the whole schema has a list, its arrays are hashable
+static void test_gen(void) {
+    var_t* gen = testgen_new("a", LONG_STR, 1, 2, 0.5, 3, var_new_nil());
+    var_t* inner = testgen_get_1(gen);
+    uint64_t h = fresh(inner);
+
+    // an immediate is replaced in its slot, a boxed one is changed in place
+    testgen_set_1_1(gen, BOXED);
+    assert(fresh(inner) != h);
+    testgen_set_1_1(gen, BOXED + 1);
+    assert(fresh(inner) != h);
+    testgen_set_1_1(gen, 1);
+    assert(fresh(inner) == h);
+
+    testgen_set_1_0(gen, "short");
+    assert(fresh(inner) != h);
+    testgen_set_1_0(gen, LONG_STR);
+    assert(fresh(inner) == h);
+    var_delete(gen);
+}
+
+
+int main(void) {
+    test_seed();
+    test_equal();
+    test_set();
+    test_handle();
+    test_plan();
+    test_gen();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+
+
+/*
+ * every `var_intern` of the same bytes shares one payload, until `var_intern_clear`.
+ * threads intern at once, results are freed after they are joined, see `var_intern` for `TYPE_ATOMIC`.
+ * build the library first, e.g. `make type && make testintern && ./test`,
+ * or run it under the thread sanitizer with `make tsan TEST=testintern && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define STRS     2000
+#define THREADS  4
+
+
+static var_t* intern(const char* str) {
+    return var_intern(str, strlen(str));
+}
+
+
+static void test_same(void) {
+    var_t* a = intern(LONG_STR);
+    var_t* b = var_intern(LONG_STR "tail", strlen(LONG_STR));
+    var_t* c = intern(LONG_STR " other");
+    assert(a != b && a->data.s == b->data.s && var_equal(a, b));
+    assert(a->data.s != c->data.s && var_equal(a, c) == false);
+
+    // short strings are inside of `var_t`, bytes after `\0` count
+    var_t* s = intern("short");
+    var_t* t = var_intern("short\0x", 7);
+    var_t* expected = var_new_string("short");
+    assert(var_equal(s, expected) && var_len(t) == 7 && var_equal(s, t) == false);
+    var_delete(expected);
+
+    // on the heap while an arena is in use
+    var_arena_t* arena = var_arena_new(0);
+    var_arena_use(arena);
+    var_t* d = intern(LONG_STR);
+    var_arena_use(NULL);
+    assert((d->flag & VAR_FLAG_ARENA) == 0 && d->data.s == a->data.s);
+    var_arena_delete(arena);
+
+    // a change copies the string, the canonical one stays
+    var_set(b, "s", "changed");
+    var_t* e = intern(LONG_STR);
+    assert(e->data.s == a->data.s && b->data.s != a->data.s && var_equal(e, a));
+
+    var_t* vars[] = { a, b, c, s, t, d, e };
+    for (size_t i = 0; i < sizeof (vars) / sizeof (vars[0]); i++) var_delete(vars[i]);
+}
+
+
+// interned keys find keys made otherwise, and the other way around
+static void test_dict(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    char str[64];
+    for (int i = 0; i < STRS; i++) {
+        snprintf(str, sizeof (str), "%s %d", LONG_STR, i);
+        var_dict_put(dict, i % 2 ? intern(str) : var_new_string(str), var_new_int(i));
+    }
+    for (int i = 0; i < STRS; i++) {
+        snprintf(str, sizeof (str), "%s %d", LONG_STR, i);
+        var_t* key = i % 2 ? var_new_string(str) : intern(str);
+        int64_t v;
+        var_get(var_dict_get(dict, key), "i", &v);
+        assert(v == i);
+        var_delete(key);
+    }
+    var_delete(dict);
+}
+
+
+// strings interned before stay valid and equal, but are no longer shared with new ones
+static void test_clear(void) {
+    var_t* a = intern(LONG_STR);
+    var_intern_clear();
+    var_t* b = intern(LONG_STR);
+    assert(var_equal(a, b) && a->data.s != b->data.s);
+    var_intern_clear();
+    var_intern_clear();
+    var_delete(b);
+    var_t* c = intern(LONG_STR);
+    assert(var_equal(a, c));
+    var_delete(a);
+    var_delete(c);
+}
+
+
+static var_t* result[THREADS][STRS];
+
+
+// every thread interns the same strings in another order
+static int worker(void* arg) {
+    size_t t = (size_t) (uintptr_t) arg;
+    char str[64];
+    for (size_t k = 0; k < STRS; k++) {
+        size_t i = (k * 7 + t * 13) % STRS;
+        snprintf(str, sizeof (str), "%s %zu", LONG_STR, i);
+        result[t][i] = intern(str);
+    }
+    return 0;
+}
+
+
+static void test_threads(void) {
+    thrd_t thread[THREADS];
+    for (size_t i = 0; i < THREADS; i++) {
+        assert(thrd_create(&thread[i], worker, (void*) (uintptr_t) i) == thrd_success);
+    }
+    for (size_t i = 0; i < THREADS; i++) {
+        thrd_join(thread[i], NULL);
+    }
+
+    char str[64];
+    for (size_t i = 0; i < STRS; i++) {
+        snprintf(str, sizeof (str), "%s %zu", LONG_STR, i);
+        var_t* canonical = intern(str);
+        for (size_t t = 0; t < THREADS; t++) {
+            assert(result[t][i]->data.s == canonical->data.s);
+            var_delete(result[t][i]);
+        }
+        var_delete(canonical);
+    }
+}
+
+
+int main(void) {
+    test_same();
+    test_dict();
+    test_clear();
+    test_threads();
+    var_intern_clear();
+    puts("ok");
+    return 0;
+}
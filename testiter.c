@@ -0,0 +1,133 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+
+/*
+ * `var_iter_t` visits every element of arrays and lists in order, and every key of dicts once,
+ * one at a time or `n` at once, with both tables of a dict during incremental resize and every shard.
+ * build the library first, e.g. `make type && make testiter && ./test`
+ */
+
+
+#define N       1000
+#define BOXED   ((int64_t) 1 << 62)
+
+
+static int64_t int_of(const var_t* var) {
+    int64_t res;
+    var_get(var, "i", &res);
+    return res;
+}
+
+
+// elements of array and list are `BOXED + i` in order
+static void check_seq(const var_t* var, size_t len) {
+    var_iter_t iter;
+    var_iter_init(&iter, var);
+    for (size_t i = 0; i < len; i++) {
+        var_t* peek = var_iter_peek(&iter);
+        var_t* elem = var_iter_next(&iter);
+        assert(peek == elem && int_of(elem) == BOXED + (int64_t) i);
+    }
+    assert(var_iter_peek(&iter) == NULL && var_iter_next(&iter) == NULL);
+    assert(var_iter_next(&iter) == NULL);
+
+    // in steps of 7, mixed with single steps
+    var_t* buf[7];
+    var_iter_init(&iter, var);
+    size_t i = 0;
+    for (size_t n; (n = var_iter_next_n(&iter, buf, NULL, 7)) > 0;) {
+        assert(n == 7 || i + n == len);
+        for (size_t k = 0; k < n; k++, i++) assert(int_of(buf[k]) == BOXED + (int64_t) i);
+
+        var_t* elem = var_iter_next(&iter);
+        if (elem == NULL) break;
+        assert(int_of(elem) == BOXED + (int64_t) i++);
+    }
+    assert(i == len && var_iter_next_n(&iter, buf, NULL, 7) == 0);
+}
+
+
+static void test_seq(void) {
+    var_t* list = var_new_list(NULL);
+    check_seq(list, 0);
+    for (int64_t i = 0; i < N; i++) var_list_push(list, var_new_int(BOXED + i));
+    check_seq(list, N);
+
+    var_t* arr = var_news("()");
+    check_seq(arr, 0);
+    var_delete(arr);
+    arr = var_news("(iii)", BOXED, BOXED + 1, BOXED + 2);
+    check_seq(arr, 3);
+    var_delete(arr);
+    var_delete(list);
+}
+
+
+// keys of dicts are `0..len`, each with val `key * 3`
+static void check_dict(const var_t* dict, size_t len) {
+    int seen[N] = {0};
+    var_iter_t iter;
+    var_iter_init(&iter, dict);
+    for (var_t* key; (key = var_iter_next(&iter)) != NULL;) {
+        int64_t k = int_of(key);
+        assert(k >= 0 && k < (int64_t) len && int_of(var_iter_val(&iter)) == k * 3);
+        seen[k]++;
+    }
+    for (size_t i = 0; i < len; i++) assert(seen[i] == 1);
+
+    var_t *key[7], *val[7];
+    var_iter_init(&iter, dict);
+    size_t total = 0;
+    for (size_t n; (n = var_iter_next_n(&iter, key, val, 7)) > 0; total += n) {
+        for (size_t k = 0; k < n; k++) {
+            assert(int_of(val[k]) == int_of(key[k]) * 3 && --seen[int_of(key[k])] == 0);
+        }
+        assert(var_iter_val(&iter) == val[n - 1]);
+    }
+    assert(total == len);
+
+    // vals can be left out
+    var_iter_init(&iter, dict);
+    total = 0;
+    for (size_t n; (n = var_iter_next_n(&iter, key, NULL, 7)) > 0;) total += n;
+    assert(total == len);
+}
+
+
+static void test_dict(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    check_dict(dict, 0);
+    for (int64_t i = 0; i < N; i++) var_dict_put(dict, var_new_int(i), var_new_int(i * 3));
+    check_dict(dict, N);
+    var_delete(dict);
+
+    // stop in the middle of an incremental resize, elements are in both tables
+    dict = var_new_dict(NULL, NULL);
+    var_dict_incremental(dict, true);
+    int64_t len = 0;
+    do {
+        var_dict_put(dict, var_new_int(len), var_new_int(len * 3));
+        len++;
+    } while (dict->data.d->old.cap == 0 || dict->data.d->moved == 0);
+    assert(len < N);
+    check_dict(dict, len);
+    var_delete(dict);
+
+    var_t* sharded = var_new_dict_sharded(4);
+    check_dict(sharded, 0);
+    for (int64_t i = 0; i < N; i++) var_dict_put(sharded, var_new_int(i), var_new_int(i * 3));
+    check_dict(sharded, N);
+    var_delete(sharded);
+}
+
+
+int main(void) {
+    test_seq();
+    test_dict();
+    puts("ok");
+    return 0;
+}
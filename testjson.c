@@ -0,0 +1,548 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ * `var_from_json` reads exactly `len` bytes, the input is not terminated.
+ * every input is copied into a buffer of its own size, so the sanitizer catches reads past the end.
+ * the writer gives text that reads back to the same value, in a buffer, in chunks or to a file.
+ * the streaming reader gives the same events and records wherever its input is split into chunks.
+ * build the library first, e.g. `make type && make testjson && ./test`
+ */
+
+
+static var_t* parse(const char* json, size_t len) {
+    char* buf = malloc(len > 0 ? len : 1);
+    assert(buf != NULL);
+    memcpy(buf, json, len);
+    var_t* res = var_from_json(buf, len);
+    free(buf);
+    return res;
+}
+
+
+static bool accepts(const char* json) {
+    var_t* res = parse(json, strlen(json));
+    if (res == NULL) return false;
+    var_delete(res);
+    return true;
+}
+
+
+static void test_invalid(void) {
+    const char* bad[] = {
+        "", "  ", "[", "]", "{", "}", "[1,]", "[,1]", "{\"a\"}", "{\"a\":}", "{1:2}", "[1 2]",
+        "\"abc", "\"a\\x\"", "tru", "nul", "fals", "truex", "nulll", "[01]", "-", "1.", "1e",
+        "[1]]", "[[1]", "{\"a\":1,}", "\"\\ud800\"", "\"a\nb\"", "1 2", "[1,2]x", "+1", ".5",
+        NULL,
+    };
+    for (size_t i = 0; bad[i] != NULL; i++) {
+        if (accepts(bad[i])) {
+            printf("accepted: %s\n", bad[i]);
+            assert(false);
+        }
+    }
+}
+
+
+static void test_values(void) {
+    const char* json =
+        " { \"a\" : [1, -2, 3.5, \"x\\ty\\u00e9\\ud83d\\ude00\\\"\", true, false, null, {}, [] ],"
+        " \"b\": 18446744073709551615, \"c\": -9223372036854775808 } ";
+    var_t* res = parse(json, strlen(json));
+    assert(res != NULL);
+
+    int64_t i1, i2, t, f;
+    double d;
+    const char* s;
+    var_t *n, *e1, *e2;
+    var_t* key = var_new_string("a");
+    var_get(var_dict_get(res, key), "[iifsiivvv]", &i1, &i2, &d, &s, &t, &f, &n, &e1, &e2);
+    assert(i1 == 1 && i2 == -2 && d == 3.5 && t == 1 && f == 0);
+    assert(strcmp(s, "x\ty\xc3\xa9\xf0\x9f\x98\x80\"") == 0);
+    assert(n == var_new_nil() && var_len(e1) == 0 && var_len(e2) == 0);
+    var_delete(key);
+
+    uint64_t u;
+    key = var_new_string("b");
+    var_get(var_dict_get(res, key), "u", &u);
+    assert(u == UINT64_MAX);
+    var_delete(key);
+
+    int64_t i;
+    key = var_new_string("c");
+    var_get(var_dict_get(res, key), "i", &i);
+    assert(i == INT64_MIN);
+    var_delete(key);
+    var_delete(res);
+}
+
+
+// literals and documents with every prefix and every single bit flipped, none of them reads past the end
+static void test_bounds(void) {
+    const char* doc[] = {
+        "true", "false", "null", "[true,false,null]", "{\"k\":false}", "[1.5e3,-0,\"s\\n\"]", NULL,
+    };
+    char buf[64];
+    for (size_t d = 0; doc[d] != NULL; d++) {
+        size_t len = strlen(doc[d]);
+        assert(accepts(doc[d]));
+
+        for (size_t k = 0; k < len; k++) {
+            var_t* res = parse(doc[d], k);
+            if (res != NULL) var_delete(res);
+        }
+        for (size_t bit = 0; bit < len * 8; bit++) {
+            memcpy(buf, doc[d], len);
+            buf[bit / 8] ^= (char) (1 << (bit % 8));
+            var_t* res = parse(buf, len);
+            if (res != NULL) var_delete(res);
+        }
+    }
+}
+
+
+// numbers round the same as `strtod`
+static void test_numbers(void) {
+    srand(7);
+    char buf[64];
+    for (int i = 0; i < 20000; i++) {
+        double x = ldexp((double) rand(), rand() % 200 - 100);
+        snprintf(buf, sizeof (buf), "%.*g", 1 + rand() % 17, x);
+        if (strchr(buf, '.') == NULL && strchr(buf, 'e') == NULL) strcat(buf, ".0");
+
+        var_t* res = parse(buf, strlen(buf));
+        assert(res != NULL);
+        double y, z = strtod(buf, NULL);
+        var_get(res, "f", &y);
+        assert(memcmp(&y, &z, sizeof (double)) == 0);
+        var_delete(res);
+    }
+
+    const char* edge[] = { "9007199254740993.0", "2.2250738585072014e-308", "5e-324", "1e23", "-0.0", NULL };
+    for (size_t i = 0; edge[i] != NULL; i++) {
+        var_t* res = parse(edge[i], strlen(edge[i]));
+        assert(res != NULL);
+        double y, z = strtod(edge[i], NULL);
+        var_get(res, "f", &y);
+        assert(memcmp(&y, &z, sizeof (double)) == 0);
+        var_delete(res);
+    }
+}
+
+
+// `var_to_json` as a `\0` terminated string, `NULL` if it fails
+static char* to_json(const var_t* var, uint32_t flag) {
+    var_buf_t buf;
+    var_buf_init(&buf);
+    char* res = NULL;
+    if (var_to_json(var, &buf, flag)) {
+        res = malloc(buf.len + 1);
+        memcpy(res, buf.data, buf.len);
+        res[buf.len] = '\0';
+    }
+    var_buf_free(&buf);
+    return res;
+}
+
+
+static void writes(var_t* var, uint32_t flag, const char* json) {
+    char* res = to_json(var, flag);
+    if (strcmp(res, json) != 0) {
+        printf("wrote: %s\nexpected: %s\n", res, json);
+        assert(false);
+    }
+    free(res);
+    var_delete(var);
+}
+
+
+static void test_write(void) {
+    writes(var_news("[niiusf]", (int64_t) -1, (int64_t) 1, (uint64_t) 2, "x", 0.5), 0, "[null,-1,1,2,\"x\",0.5]");
+    writes(var_news("(()[])"), 0, "[[],[]]");
+    writes(var_new_dict(NULL, NULL), 0, "{}");
+    writes(var_new_string("\"\\/\b\f\n\r\t\x01\x1f\x7f\xc3\xa9"), 0, "\"\\\"\\\\/\\b\\f\\n\\r\\t\\u0001\\u001f\x7f\xc3\xa9\"");
+
+    // every integer as `printf` writes it
+    char expected[32];
+    for (int64_t p = 1, k = 0; k < 19; k++, p *= 10) {
+        int64_t edge[] = { p - 1, p, -p, -p + 1 };
+        for (size_t i = 0; i < 4; i++) {
+            snprintf(expected, sizeof (expected), "%lld", (long long) edge[i]);
+            writes(var_new_int(edge[i]), 0, expected);
+        }
+    }
+    writes(var_new_int(INT64_MIN), 0, "-9223372036854775808");
+    writes(var_new_uint(UINT64_MAX), 0, "18446744073709551615");
+
+    // keys are strings, numbers are quoted
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_dict_put(dict, var_new_int(-3), var_new_nil());
+    writes(dict, 0, "{\"-3\":null}");
+    dict = var_new_dict(NULL, NULL);
+    var_dict_put(dict, var_new_string("k"), var_news("[i]", (int64_t) 1));
+    writes(dict, 0, "{\"k\":[1]}");
+
+    // values that are not JSON leave the buffer as it was
+    var_t* bad[] = { var_news("[fi]", NAN, (int64_t) 1), var_new_float(INFINITY), var_new_dict(NULL, NULL) };
+    var_dict_put(bad[2], var_news("(i)", (int64_t) 1), var_new_int(1));
+    for (size_t i = 0; i < 3; i++) {
+        var_buf_t buf;
+        var_buf_init(&buf);
+        var_t* one = var_new_int(1);
+        assert(var_to_json(one, &buf, 0) && buf.len == 1);
+        assert(var_to_json(bad[i], &buf, 0) == false && buf.len == 1 && buf.data[0] == '1');
+        var_buf_free(&buf);
+        var_delete(bad[i]);
+    }
+}
+
+
+static void test_pretty(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_dict_put(dict, var_new_string("a"), var_news("[i[]()]", (int64_t) 1));
+    writes(dict, VAR_JSON_PRETTY, "{\n    \"a\": [\n        1,\n        [],\n        []\n    ]\n}");
+    writes(var_new_int(1), VAR_JSON_PRETTY, "1");
+
+    // the same value as without, arrays read back as lists
+    var_t* var = var_news("[s(if)[]]", "x", (int64_t) 1, 0.25);
+    char* res = to_json(var, VAR_JSON_PRETTY);
+    var_t* back = parse(res, strlen(res));
+    char* plain = to_json(back, 0);
+    char* orig = to_json(var, 0);
+    assert(strcmp(plain, orig) == 0 && strcmp(plain, "[\"x\",[1,0.25],[]]") == 0);
+    free(orig);
+    free(plain);
+    free(res);
+    var_delete(back);
+    var_delete(var);
+}
+
+
+// floats read back to the same bits, and always read back as floats
+static void test_write_floats(void) {
+    srand(11);
+    for (int i = 0; i < 100000; i++) {
+        uint64_t bits = 0;
+        for (int k = 0; k < 4; k++) bits = bits << 16 | (uint64_t) (rand() & 0xffff);
+        double x;
+        memcpy(&x, &bits, sizeof (double));
+        if (isfinite(x) == false) continue;
+        if (i % 2) x = (double) (rand() % 100000) / (1 << rand() % 10);
+
+        var_t* var = var_new_float(x);
+        char* json = to_json(var, 0);
+        assert(json != NULL && strpbrk(json, ".e") != NULL && strlen(json) < JSON_FLOAT_SIZE);
+        var_t* back = parse(json, strlen(json));
+        double y;
+        var_get(back, "f", &y);
+        assert(memcmp(&x, &y, sizeof (double)) == 0);
+
+        // never longer than the 17 digits that always read back
+        char digits[64];
+        snprintf(digits, sizeof (digits), "%.17g", x);
+        assert(strlen(json) <= strlen(digits) + 2);
+        free(json);
+        var_delete(back);
+        var_delete(var);
+    }
+
+    const double edge[] = { 0.0, -0.0, 1.0, 5e-324, DBL_MIN, DBL_MAX, 1e21, 1e-7, 123456789012345680.0 };
+    for (size_t i = 0; i < sizeof (edge) / sizeof (edge[0]); i++) {
+        var_t* var = var_new_float(edge[i]);
+        char* json = to_json(var, 0);
+        var_t* back = parse(json, strlen(json));
+        double y;
+        var_get(back, "f", &y);
+        assert(memcmp(&edge[i], &y, sizeof (double)) == 0);
+        free(json);
+        var_delete(back);
+        var_delete(var);
+    }
+    writes(var_new_float(0.1), 0, "0.1");
+    writes(var_new_float(-2.0), 0, "-2.0");
+}
+
+
+typedef struct chunks {
+    char*       data;
+    size_t      len;
+    size_t      calls;
+    size_t      large;      // chunks over `JSON_BUF_SIZE`
+    size_t      stop;       // calls before the callback fails, 0 for never
+} chunks_t;
+
+
+static bool collect(const char* data, size_t len, void* arg) {
+    chunks_t* c = arg;
+    assert(len > 0);
+    if (len > JSON_BUF_SIZE) c->large++;
+    c->data = realloc(c->data, c->len + len);
+    assert(c->data != NULL);
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    return ++c->calls != c->stop;
+}
+
+
+static void test_stream(void) {
+    // many chunks, and a string larger than one of them passed at once
+    var_t* list = var_new_list(NULL);
+    for (int i = 0; i < 20000; i++) var_list_push(list, var_new_string("element number %d", i));
+    char* big = malloc(JSON_BUF_SIZE * 2 + 1);
+    memset(big, 'x', JSON_BUF_SIZE * 2);
+    big[JSON_BUF_SIZE * 2] = '\0';
+    var_list_push(list, var_new_string(big));
+    var_list_push(list, var_new_float(0.5));
+    free(big);
+
+    for (uint32_t flag = 0; flag <= VAR_JSON_PRETTY; flag++) {
+        chunks_t c = { .data = NULL, .len = 0, .calls = 0, .large = 0, .stop = 0 };
+        assert(var_to_json_stream(list, collect, &c, flag));
+        assert(c.calls > 5 && c.large == 1);
+
+        var_buf_t buf;
+        var_buf_init(&buf);
+        assert(var_to_json(list, &buf, flag));
+        assert(buf.len == c.len && memcmp(buf.data, c.data, buf.len) == 0);
+        var_buf_free(&buf);
+        free(c.data);
+    }
+
+    // a failed callback stops the writer
+    chunks_t c = { .data = NULL, .len = 0, .calls = 0, .large = 0, .stop = 2 };
+    assert(var_to_json_stream(list, collect, &c, 0) == false && c.calls == 2);
+    free(c.data);
+
+    var_t* bad = var_new_float(NAN);
+    c = (chunks_t) { .data = NULL, .len = 0, .calls = 0, .large = 0, .stop = 0 };
+    assert(var_to_json_stream(bad, collect, &c, 0) == false && c.calls == 0);
+    var_delete(bad);
+
+    FILE* fp = tmpfile();
+    assert(var_to_json_file(list, fp, VAR_JSON_PRETTY));
+    long len = ftell(fp);
+    rewind(fp);
+    char* data = malloc((size_t) len);
+    assert(fread(data, 1, (size_t) len, fp) == (size_t) len);
+    var_t* back = parse(data, (size_t) len);
+    assert(var_equal(back, list));
+    free(data);
+    fclose(fp);
+
+    var_delete(back);
+    var_delete(list);
+}
+
+
+typedef struct trace {
+    char*   data;
+    size_t  len;
+    size_t  events;
+    size_t  stop;       // events before the callback fails, 0 for never
+} trace_t;
+
+
+static void append(trace_t* t, const char* str) {
+    size_t len = strlen(str);
+    t->data = realloc(t->data, t->len + len + 1);
+    assert(t->data != NULL);
+    memcpy(t->data + t->len, str, len + 1);
+    t->len += len;
+}
+
+
+static bool on_event(var_json_event_t event, const var_t* val, void* arg) {
+    trace_t* t = arg;
+    static const char* name[] = { "[", "]", "{", "}", "K", "V" };
+    append(t, name[event]);
+    if (val != NULL) {
+        char* json = to_json(val, 0);
+        append(t, json);
+        free(json);
+    }
+    append(t, " ");
+    return ++t->events != t->stop;
+}
+
+
+static bool on_record(var_t* record, void* arg) {
+    trace_t* t = arg;
+    char* json = to_json(record, 0);
+    append(t, json);
+    append(t, "\n");
+    free(json);
+    return ++t->events != t->stop;
+}
+
+
+// the trace of reading `json` in one chunk, in two at `split`, or one byte at a time for `SIZE_MAX`
+static char* read_split(const char* json, size_t split, bool record, bool* ok) {
+    trace_t t = { .data = NULL, .len = 0, .events = 0, .stop = 0 };
+    append(&t, "");
+    var_json_reader_t* r = record ? var_json_reader_new_record(on_record, &t) : var_json_reader_new(on_event, &t);
+    size_t len = strlen(json);
+
+    // exact sizes let the address sanitizer catch reads past the end of a chunk
+    *ok = true;
+    for (size_t at = 0; at < len;) {
+        size_t n = split == SIZE_MAX ? 1 : (at < split ? split - at : len - at);
+        if (at + n > len) n = len - at;
+        char* chunk = malloc(n);
+        memcpy(chunk, json + at, n);
+        *ok = var_json_reader_feed(r, chunk, n) && *ok;
+        free(chunk);
+        at += n;
+    }
+    *ok = var_json_reader_end(r) && *ok;
+    var_json_reader_delete(r);
+    return t.data;
+}
+
+
+static void reads_same(const char* json, bool record) {
+    bool ok, same;
+    char* whole = read_split(json, 0, record, &ok);
+    assert(ok);
+    for (size_t split = 1; split <= strlen(json); split++) {
+        char* res = read_split(json, split, record, &same);
+        assert(same && strcmp(res, whole) == 0);
+        free(res);
+    }
+    char* res = read_split(json, SIZE_MAX, record, &same);
+    assert(same && strcmp(res, whole) == 0);
+    free(res);
+    free(whole);
+}
+
+
+static void test_events(void) {
+    const char* json = " {\"a\\\"\u00e9\": [1, -2.5e3, \"x\\ny\", true, false, null, {}, []], \"b\": {\"c\": 18446744073709551615}} ";
+    bool ok;
+    char* res = read_split(json, 0, false, &ok);
+    assert(ok && strcmp(res, "{ K\"a\\\"\xc3\xa9\" [ V1 V-2500.0 V\"x\\ny\" V1 V0 Vnull { } [ ] ] K\"b\" { K\"c\" V18446744073709551615 } } ") == 0);
+    free(res);
+    reads_same(json, false);
+
+    // top level values one after another, a number at the end is read by `var_json_reader_end`
+    reads_same("1 \"a\"[2]{}\n3.5\ntrue null 42", false);
+    res = read_split("1 [2] 3", SIZE_MAX, false, &ok);
+    assert(ok && strcmp(res, "V1 [ V2 ] V3 ") == 0);
+    free(res);
+}
+
+
+static void test_records(void) {
+    // elements of a top level array, and top level values that are not arrays
+    const char* json = "[{\"id\": 1, \"tags\": [\"a\", \"b\"]}, 2, \"three\", [4, [5]], {}]\n{\"id\": 6}\n7";
+    bool ok;
+    char* res = read_split(json, 0, true, &ok);
+    assert(ok);
+    const char* all = "[{\"id\":1,\"tags\":[\"a\",\"b\"]},2,\"three\",[4,[5]],{},{\"id\":6},7]";
+    var_t* list = parse(all, strlen(all));
+    assert(list != NULL);
+
+    // the same values as `var_from_json`
+    char* line = res;
+    for (size_t i = 0; i < var_len(list); i++) {
+        char* end = strchr(line, '\n');
+        assert(end != NULL);
+        *end = '\0';
+        var_t* record = parse(line, strlen(line));
+        assert(var_equal(record, var_list_at(list, i)));
+        var_delete(record);
+        line = end + 1;
+    }
+    assert(*line == '\0');
+    var_delete(list);
+    free(res);
+    reads_same(json, true);
+}
+
+
+static void test_reader_errors(void) {
+    const char* bad[] = { "[1,]", "{\"a\" 1}", "{1: 2}", "[1 2]", "]", "\"abc", "[1", "{\"a\":", "tru", "nul x", "[01]", NULL };
+    for (size_t i = 0; bad[i] != NULL; i++) {
+        for (int record = 0; record < 2; record++) {
+            bool ok;
+            free(read_split(bad[i], 0, record, &ok));
+            assert(ok == false);
+            free(read_split(bad[i], SIZE_MAX, record, &ok));
+            assert(ok == false);
+        }
+    }
+
+    // a failed callback stops the reader, which is ready for another input after the end
+    trace_t t = { .data = NULL, .len = 0, .events = 0, .stop = 2 };
+    var_json_reader_t* r = var_json_reader_new_record(on_record, &t);
+    assert(var_json_reader_feed(r, "[1, 2, 3, 4]", 12) == false && t.events == 2);
+    assert(var_json_reader_feed(r, "5", 1) == false && var_json_reader_end(r) == false);
+    t.stop = 0;
+    assert(var_json_reader_feed(r, "[5]", 3) && var_json_reader_end(r) && t.events == 3);
+
+    // an incomplete input is dropped by the end
+    assert(var_json_reader_feed(r, "[{\"a\": [1", 10) && var_json_reader_end(r) == false);
+    assert(var_json_reader_feed(r, "6", 1) && var_json_reader_end(r) && t.events == 4);
+    assert(strcmp(t.data, "1\n2\n5\n6\n") == 0);
+    var_json_reader_delete(r);
+    free(t.data);
+}
+
+
+static bool count_record(var_t* record, void* arg) {
+    int64_t i;
+    var_get(record, "[i_]", &i);
+    assert(i == (int64_t) *(size_t*) arg);
+    (*(size_t*) arg)++;
+    return true;
+}
+
+
+// records larger than a chunk of the file
+static void test_read_file(void) {
+    var_t* list = var_new_list(NULL);
+    for (int64_t i = 0; i < 20000; i++) {
+        var_list_push(list, var_news("[is]", i, "a string long enough to split records across chunks"));
+    }
+    var_t* big = var_new_list(var_new_int(20000), NULL);
+    for (int i = 0; i < JSON_BUF_SIZE / 4; i++) var_list_push(big, var_new_string("%d", i));
+    var_list_push(list, big);
+
+    FILE* fp = tmpfile();
+    assert(var_to_json_file(list, fp, VAR_JSON_PRETTY));
+    rewind(fp);
+    size_t n = 0;
+    assert(var_json_read_file(fp, count_record, &n) && n == 20001);
+
+    fputs(",", fp);
+    rewind(fp);
+    n = 0;
+    assert(var_json_read_file(fp, count_record, &n) == false);
+    fclose(fp);
+    var_delete(list);
+}
+
+
+int main(void) {
+    test_invalid();
+    test_values();
+    test_bounds();
+    test_numbers();
+    test_write();
+    test_pretty();
+    test_write_floats();
+    test_stream();
+    test_events();
+    test_records();
+    test_reader_errors();
+    test_read_file();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,128 @@
+#define _POSIX_C_SOURCE 200809L     // fork
+
+#include "src/type.h"
+#include "src/varprivate.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/*
+ * `VAR_LIST` grows by doubling from `LIST_SIZE`, an empty list allocates no elements.
+ * indexes out of range exit the process.
+ * build the library first, e.g. `make type && make testlist && ./test`
+ */
+
+
+#define BOXED   ((int64_t) 1 << 62)
+
+
+// if `fn` exits the process, it runs in a child process
+static bool dies(void (*fn)(void* arg), void* arg) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        assert(freopen("/dev/null", "w", stderr) != NULL);
+        fn(arg);
+        _exit(0);
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    return WIFEXITED(status) && WEXITSTATUS(status) != 0;
+}
+
+
+static int64_t int_at(const var_t* list, size_t index) {
+    int64_t res;
+    var_get(var_list_at(list, index), "i", &res);
+    return res;
+}
+
+
+static void test_empty(void) {
+    var_t* list = var_new_list(NULL);
+    assert(var_len(list) == 0 && list->data.l->lv == NULL && list->data.l->cap == 0);
+    assert(var_list_pop(list) == NULL);
+
+    var_list_push(list, var_new_int(1));
+    assert(var_len(list) == 1 && list->data.l->cap == LIST_SIZE);
+    var_delete(var_list_pop(list));
+    assert(var_len(list) == 0 && var_list_pop(list) == NULL);
+    var_delete(list);
+}
+
+
+// elements stay in order as the list grows, boxed ones as well
+static void test_push(void) {
+    var_t* list = var_new_list(NULL);
+    for (int64_t i = 0; i < 10000; i++) {
+        var_list_push(list, var_new_int(i % 2 ? BOXED + i : i));
+        size_t cap = list->data.l->cap;
+        assert(cap >= var_len(list) && (cap == LIST_SIZE || cap / 2 < var_len(list)));
+    }
+    assert(var_len(list) == 10000);
+    for (int64_t i = 0; i < 10000; i++) assert(int_at(list, i) == (i % 2 ? BOXED + i : i));
+
+    for (int64_t i = 9999; i >= 5000; i--) {
+        var_t* elem = var_list_pop(list);
+        int64_t v;
+        var_get(elem, "i", &v);
+        assert(v == (i % 2 ? BOXED + i : i));
+        var_delete(elem);
+    }
+    assert(var_len(list) == 5000 && int_at(list, 4999) == BOXED + 4999);
+    var_delete(list);
+}
+
+
+// insert at the front, in the middle and at the end
+static void test_insert(void) {
+    var_t* list = var_new_list(NULL);
+    var_list_insert(list, 0, var_new_int(2));
+    var_list_insert(list, 0, var_new_int(0));
+    var_list_insert(list, 1, var_new_int(1));
+    var_list_insert(list, 3, var_new_int(3));
+    assert(var_len(list) == 4);
+    for (int64_t i = 0; i < 4; i++) assert(int_at(list, i) == i);
+
+    var_t* expected = var_news("[iiii]", (int64_t) 0, (int64_t) 1, (int64_t) 2, (int64_t) 3);
+    assert(var_equal(list, expected));
+    var_delete(expected);
+
+    // the list grows under an insert as under a push
+    for (int64_t i = 4; i < 100; i++) var_list_insert(list, var_len(list) / 2, var_new_int(i));
+    assert(var_len(list) == 100 && int_at(list, 0) == 0 && int_at(list, 99) == 3);
+    var_delete(list);
+}
+
+
+static void at_end(void* arg) {
+    var_list_at(arg, var_len(arg));
+}
+
+
+static void insert_past(void* arg) {
+    var_list_insert(arg, var_len(arg) + 1, var_new_nil());
+}
+
+
+static void test_range(void) {
+    var_t* list = var_new_list(var_new_int(1), NULL);
+    assert(dies(at_end, list));
+    assert(dies(insert_past, list));
+    var_delete(list);
+}
+
+
+int main(void) {
+    test_empty();
+    test_push();
+    test_insert();
+    test_range();
+    puts("ok");
+    return 0;
+}
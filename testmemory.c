@@ -0,0 +1,109 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+
+/*
+ * `var_memory_usage` counts every byte allocated for a tree by kind,
+ * with the headers, padding and blocks of `var_copy`.
+ * build the library first, e.g. `make type && make testmemory && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+
+
+static size_t string_size(const char* str) {
+    return sizeof (var_string_t) + strlen(str) + 1;
+}
+
+
+// bytes of block memory of an allocation of `var_copy`, see `varcopy.c`
+static size_t block_size(size_t size) {
+    return (BLOCK_HEAD + size + BLOCK_ALIGN - 1) & ~(size_t) (BLOCK_ALIGN - 1);
+}
+
+
+static void test_kinds(void) {
+    // immediates take nothing
+    assert(var_memory_usage(var_new_int(1), NULL) == 0);
+
+    var_memory_t m;
+    var_t* arr = var_news("(si[i])", LONG_STR, BOXED, (int64_t) 1);
+    size_t total = var_memory_usage(arr, &m);
+    assert(m.nodes == sizeof (var_t) * 4);
+    assert(m.strings == string_size(LONG_STR));
+    assert(m.slots == sizeof (var_array_t) + sizeof (var_t*) * 3 + sizeof (var_list_t) + sizeof (var_t*) * 1);
+    assert(m.buckets == 0 && m.elements == 0);
+    assert(total == m.nodes + m.strings + m.slots);
+
+    // unused capacity of lists is counted
+    var_t* list = var_new_list(NULL);
+    var_list_push(list, var_new_int(1));
+    var_memory_usage(list, &m);
+    assert(m.slots == sizeof (var_list_t) + sizeof (var_t*) * LIST_SIZE);
+
+    var_delete(arr);
+    var_delete(list);
+}
+
+
+// buckets are the dict and its control bytes, elements the slots of each bucket
+static void test_dict(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_memory_t m;
+    var_memory_usage(dict, &m);
+    assert(m.nodes == sizeof (var_t) && m.buckets == sizeof (var_dict_t) && m.elements == 0);
+
+    for (int64_t i = 0; i < 3; i++) var_dict_put(dict, var_new_int(i), var_new_string(LONG_STR));
+    var_memory_usage(dict, &m);
+    assert(m.buckets == sizeof (var_dict_t) + DICT_SIZE);
+    assert(m.elements == sizeof (var_dict_slot_t) * DICT_SIZE);
+    assert(m.nodes == sizeof (var_t) * 4 && m.strings == string_size(LONG_STR) * 3);
+    var_delete(dict);
+
+    // shards are dicts of their own inside of the payload
+    var_t* sharded = var_new_dict_sharded(4);
+    var_dict_put(sharded, var_new_int(1), var_new_int(2));
+    var_memory_usage(sharded, &m);
+    assert(m.buckets == sizeof (var_dict_t) * 5 + DICT_LINE + sizeof (var_dict_shard_t) * 4 + DICT_SIZE);
+    assert(m.elements == sizeof (var_dict_slot_t) * DICT_SIZE);
+    var_delete(sharded);
+}
+
+
+// a copy is one block, every allocation in it has a header and is padded, the block has one of its own
+static void test_copy(void) {
+    var_t* str = var_new_string(LONG_STR);
+    var_t* copy = var_copy(str);
+    var_memory_t m;
+    size_t total = var_memory_usage(copy, &m);
+    assert(m.nodes == block_size(sizeof (var_t)) + sizeof (var_block_t));
+    assert(m.strings == block_size(string_size(LONG_STR)));
+    assert(total == m.nodes + m.strings);
+
+    // memory a copy allocates as it grows is on the heap, with a header
+    var_t* list = var_new_list(var_new_int(1), NULL);
+    var_t* grown = var_copy(list);
+    for (int64_t i = 0; i < 100; i++) var_list_push(grown, var_new_int(i));
+    var_memory_usage(grown, &m);
+    assert(m.nodes == block_size(sizeof (var_t)) + sizeof (var_block_t));
+    assert(m.slots == block_size(sizeof (var_list_t)) + BLOCK_HEAD + sizeof (var_t*) * 128);
+
+    var_delete(str);
+    var_delete(copy);
+    var_delete(list);
+    var_delete(grown);
+}
+
+
+int main(void) {
+    test_kinds();
+    test_dict();
+    test_copy();
+    puts("ok");
+    return 0;
+}
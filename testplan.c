@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 200809L     // fork
+
+#include "src/type.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/*
+ * a compiled format does what `var_news`, `var_get` and `var_set` do with the same format string,
+ * once compiled it can be run any number of times. invalid formats exit the process in `var_format_compile`.
+ * build the library first, e.g. `make type && make testplan && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+
+
+// if `fn` exits the process, it runs in a child process
+static bool dies(void (*fn)(void* arg), void* arg) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        assert(freopen("/dev/null", "w", stderr) != NULL);
+        fn(arg);
+        _exit(0);
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    return WIFEXITED(status) && WEXITSTATUS(status) != 0;
+}
+
+
+static void test_news(void) {
+    var_plan_t* plan = var_format_compile(" ( i u [f s] v n ) ");
+    for (int64_t i = 0; i < 100; i++) {
+        var_t* a = var_news_plan(plan, BOXED + i, (uint64_t) i, 0.5, LONG_STR, var_new_int(i));
+        var_t* b = var_news("(iu[fs]vn)", BOXED + i, (uint64_t) i, 0.5, LONG_STR, var_new_int(i));
+        assert(var_equal(a, b));
+        var_delete(a);
+        var_delete(b);
+    }
+    var_plan_delete(plan);
+
+    // empty containers and single values
+    plan = var_format_compile("(()[])");
+    var_t* a = var_news_plan(plan);
+    var_t* b = var_news("(()[])");
+    assert(var_equal(a, b) && var_len(a) == 2);
+    var_delete(a);
+    var_delete(b);
+    var_plan_delete(plan);
+
+    plan = var_format_compile("s");
+    a = var_news_plan(plan, LONG_STR);
+    b = var_new_string(LONG_STR);
+    assert(var_equal(a, b));
+    var_delete(a);
+    var_delete(b);
+    var_plan_delete(plan);
+}
+
+
+// `_` skips elements, arrays and lists may be longer than the format
+static void test_get(void) {
+    var_t* var = var_news("((is)[fu]s)", BOXED, LONG_STR, 0.5, (uint64_t) 7, "extra");
+    var_plan_t* plan = var_format_compile("((i_)[_u])");
+    for (int i = 0; i < 3; i++) {
+        int64_t v;
+        uint64_t u;
+        var_get_plan(var, plan, &v, &u);
+        assert(v == BOXED && u == 7);
+    }
+    var_plan_delete(plan);
+
+    plan = var_format_compile("((_v)[fv]_)");
+    var_t *str, *elem;
+    double f;
+    var_get_plan(var, plan, &str, &f, &elem);
+    var_t* long_str = var_new_string(LONG_STR);
+    var_t* seven = var_new_uint(7);
+    assert(f == 0.5 && var_equal(str, long_str) && var_equal(elem, seven));
+    var_delete(long_str);
+    var_delete(seven);
+
+    // the same as `var_get`
+    var_t *str2, *elem2;
+    double f2;
+    var_get(var, "((_v)[fv]_)", &str2, &f2, &elem2);
+    assert(str == str2 && elem == elem2 && f == f2);
+    var_plan_delete(plan);
+    var_delete(var);
+}
+
+
+static void test_set(void) {
+    var_t* var = var_news("((is)[fu]s)", (int64_t) 1, "short", 0.5, (uint64_t) 7, LONG_STR);
+    var_t* expected = var_news("((is)[fu]s)", BOXED, LONG_STR, 1e300, (uint64_t) 7, LONG_STR);
+    var_plan_t* plan = var_format_compile("((is)[f_])");
+    var_set_plan(var, plan, BOXED, LONG_STR, 1e300);
+    assert(var_equal(var, expected));
+
+    // a shared payload is copied before it is changed
+    var_t* shared = var_retain(var);
+    var_set_plan(shared, plan, (int64_t) 2, "b", 0.25);
+    assert(var_equal(var, expected) && var_equal(shared, expected) == false);
+    var_delete(shared);
+
+    // the same as `var_set`
+    var_t* other = var_copy(var);
+    var_set_plan(var, plan, (int64_t) 3, "c", 2.0);
+    var_set(other, "((is)[f_])", (int64_t) 3, "c", 2.0);
+    assert(var_equal(var, other));
+
+    var_plan_delete(plan);
+    var_delete(other);
+    var_delete(expected);
+    var_delete(var);
+}
+
+
+static void compile(void* arg) {
+    var_plan_delete(var_format_compile(arg));
+}
+
+
+static void news_ignore(void* arg) {
+    var_news_plan(arg, (int64_t) 1);
+}
+
+
+static void get_short(void* arg) {
+    var_plan_t* plan = var_format_compile("(iii)");
+    int64_t a, b, c;
+    var_get_plan(arg, plan, &a, &b, &c);
+}
+
+
+static void test_errors(void) {
+    const char* invalid[] = { "", "   ", "(i", "[i)", "(i))", "x", "ii", "(i) s" };
+    for (size_t i = 0; i < sizeof (invalid) / sizeof (invalid[0]); i++) {
+        assert(dies(compile, (void*) invalid[i]));
+    }
+    assert(dies(compile, "(i _)") == false);
+
+    var_plan_t* plan = var_format_compile("(i_)");
+    assert(dies(news_ignore, plan));
+    var_plan_delete(plan);
+
+    var_t* var = var_news("(ii)", (int64_t) 1, (int64_t) 2);
+    assert(dies(get_short, var));
+    var_delete(var);
+}
+
+
+int main(void) {
+    test_news();
+    test_get();
+    test_set();
+    test_errors();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+#include "src/varutil.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <threads.h>
+
+
+/*
+ * with the pool, deep operations on large trees split into tasks, results are the same as without it.
+ * arrays are filled through `varprivate.h`, there is no public way to build a large one.
+ * build the library first, e.g. `make type && make testpool && ./test`,
+ * or run it under the thread sanitizer with `make tsan TEST=testpool && ./test`
+ */
+
+
+#define LEN     (POOL_GRAIN * 8)
+#define BOXED   ((int64_t) 1 << 62)
+
+
+// an array of `len` strings, boxed numbers and nested arrays, lists and dicts
+static var_t* tree(size_t len, int depth) {
+    var_t* arr = var_new_array_size(len);
+    for (size_t i = 0; i < len; i++) {
+        var_t* elem;
+        if (depth > 0 && i % 1000 == 0) {
+            elem = tree(len / 2, depth - 1);
+        } else if (i % 4 == 0) {
+            elem = var_new_string("a string long enough for the heap %zu", i);
+        } else if (i % 4 == 1) {
+            elem = var_new_float(i * 0.5 + 1e300);
+        } else {
+            elem = var_new_int(BOXED + (int64_t) i);
+        }
+        arr->data.a->av[i] = elem;
+    }
+    return arr;
+}
+
+
+// lists and dicts are not hashable, they are only deleted
+static var_t* containers(size_t len) {
+    var_t* list = var_new_list(NULL);
+    var_t* dict = var_new_dict(NULL, NULL);
+    for (size_t i = 0; i < len; i++) {
+        var_list_push(list, var_new_array(var_new_string("element string of a list %zu", i), NULL));
+        var_dict_put(dict, var_new_int((int64_t) i), tree(2, 0));
+    }
+    return var_new_array(list, dict, NULL);
+}
+
+
+static uint64_t hash(const var_t* var) {
+    uint64_t res;
+    assert(var_hash(var, &res));
+    return res;
+}
+
+
+static void test_same(uint64_t expect) {
+    var_t* arr = tree(LEN, 2);
+    assert(hash(arr) == expect);
+
+    // a change deep inside is seen by the cached hash, changing it back gives the same hash
+    var_t* inner = arr->data.a->av[0];
+    var_t* elem = inner->data.a->av[1];
+    var_set(elem, "f", 3.25);
+    assert(hash(arr) != expect);
+    var_set(elem, "f", 0.5 + 1e300);
+    assert(hash(arr) == expect);
+
+    // unhashable elements fail the whole hash
+    var_delete(inner->data.a->av[LEN / 2 - 7]);
+    inner->data.a->av[LEN / 2 - 7] = var_new_list(NULL);
+    uint64_t res;
+    assert(var_hash(arr, &res) == false);
+
+    var_delete(arr);
+    var_delete(containers(LEN));
+}
+
+
+// threads outside of the pool split their trees into it at the same time
+static int outside(void* arg) {
+    uint64_t expect = *(uint64_t*) arg;
+    for (int i = 0; i < 4; i++) {
+        var_t* arr = tree(LEN, 1);
+        var_t* copy = var_copy(arr);
+        assert(var_equal(arr, copy));
+        assert(hash(copy) == expect);
+        var_delete(arr);
+        var_delete(copy);
+    }
+    return 0;
+}
+
+
+int main(void) {
+    var_t* arr = tree(LEN, 2);
+    uint64_t expect = hash(arr);
+    var_delete(arr);
+    test_same(expect);
+
+    var_pool_start(4);
+    test_same(expect);
+    var_pool_stop();
+
+    // one per core, and again after stop
+    var_pool_start(0);
+    test_same(expect);
+    var_pool_stop();
+
+    arr = tree(LEN, 1);
+    uint64_t flat = hash(arr);
+    var_delete(arr);
+    var_pool_start(2);
+    thrd_t thread[3];
+    for (size_t i = 0; i < 3; i++) {
+        assert(thrd_create(&thread[i], outside, &flat) == thrd_success);
+    }
+    for (size_t i = 0; i < 3; i++) {
+        thrd_join(thread[i], NULL);
+    }
+    var_pool_stop();
+    puts("ok");
+    return 0;
+}
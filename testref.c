@@ -0,0 +1,127 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+
+/*
+ * `var_retain` shares a payload in O(1), the first owner that changes it copies one level of it.
+ * the address sanitizer of the default build catches payloads freed too early or never.
+ * build the library first, e.g. `make type && make testref && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+
+
+static void test_share(void) {
+    var_t* imm = var_new_int(1);
+    assert(var_retain(imm) == imm);
+
+    var_t* str = var_new_string(LONG_STR);
+    var_t* arr = var_news("(is)", BOXED, LONG_STR);
+    var_t* list = var_news("[is]", BOXED, LONG_STR);
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_dict_put(dict, var_new_int(1), var_new_string(LONG_STR));
+
+    var_t* s = var_retain(str);
+    var_t* a = var_retain(arr);
+    var_t* l = var_retain(list);
+    var_t* d = var_retain(dict);
+    assert(s != str && s->data.s == str->data.s && var_equal(s, str));
+    assert(a->data.a == arr->data.a && var_equal(a, arr));
+    assert(l->data.l == list->data.l && var_equal(l, list));
+    assert(d->data.d == dict->data.d && var_equal(d, dict));
+
+    // the payload lives on with the last owner, in either order
+    var_release(str);
+    var_release(arr);
+    var_release(l);
+    var_release(d);
+    assert(var_len(s) == sizeof (LONG_STR) - 1 && var_len(a) == 2);
+    assert(var_len(list) == 2 && var_len(dict) == 1);
+    var_release(s);
+    var_release(a);
+    var_release(list);
+    var_release(dict);
+}
+
+
+// each owner sees its own changes only
+static void test_cow(void) {
+    var_t* str = var_new_string(LONG_STR);
+    var_t* s = var_retain(str);
+    var_set(s, "s", "short");
+    var_t* expected = var_new_string(LONG_STR);
+    assert(var_equal(str, expected) && var_equal(s, expected) == false);
+    var_delete(expected);
+
+    var_t* list = var_news("[is]", BOXED, LONG_STR);
+    var_t* l = var_retain(list);
+    var_list_push(l, var_new_int(3));
+    assert(var_len(list) == 2 && var_len(l) == 3 && l->data.l != list->data.l);
+
+    // the copy of one level shares the elements of the original
+    assert(var_list_at(l, 1)->data.s == var_list_at(list, 1)->data.s);
+    var_delete(var_list_pop(list));
+    assert(var_len(list) == 1 && var_len(l) == 3);
+
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_dict_put(dict, var_new_int(1), var_new_int(1));
+    var_t* d = var_retain(dict);
+    var_dict_put(d, var_new_int(2), var_new_int(2));
+    var_t* key = var_new_int(1);
+    assert(var_dict_remove(dict, key));
+    assert(var_len(dict) == 0 && var_len(d) == 2 && var_dict_contains(d, key));
+    var_delete(key);
+
+    var_delete(str);
+    var_delete(s);
+    var_delete(list);
+    var_delete(l);
+    var_delete(dict);
+    var_delete(d);
+}
+
+
+// a change deep inside copies every shared payload on its path, and nothing beside it
+static void test_nested(void) {
+    var_t* arr = var_news("((s[i])s)", LONG_STR, BOXED, LONG_STR);
+    var_t* orig = var_copy(arr);
+    var_t* shared = var_retain(arr);
+
+    var_set(shared, "((_[i])_)", (int64_t) 5);
+    assert(var_equal(arr, orig));
+    var_t* expected = var_news("((s[i])s)", LONG_STR, (int64_t) 5, LONG_STR);
+    assert(var_equal(shared, expected));
+    var_delete(expected);
+
+    var_t *a0, *a1, *s0, *s1;
+    var_get(arr, "((v_)v)", &a0, &a1);
+    var_get(shared, "((v_)v)", &s0, &s1);
+    assert(a0->data.s == s0->data.s && a1->data.s == s1->data.s);
+
+    // a handle of a shared element changes only its own owner
+    var_t *list;
+    var_get(arr, "((_v)_)", &list);
+    var_list_push(list, var_new_nil());
+    assert(var_len(list) == 2);
+    var_get(shared, "((_v)_)", &list);
+    assert(var_len(list) == 1);
+
+    var_delete(arr);
+    assert(var_len(shared) == 2);
+    var_delete(shared);
+    var_delete(orig);
+}
+
+
+int main(void) {
+    test_share();
+    test_cow();
+    test_nested();
+    puts("ok");
+    return 0;
+}
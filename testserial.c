@@ -0,0 +1,160 @@
+#include "src/type.h"
+#include "src/varprivate.h"
+
+#include <assert.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * `var_deserialize` gives back what `var_serialize` wrote, from a buffer or a `FILE*`,
+ * truncated and malformed input gives `NULL` without reading past its end.
+ * build the library first, e.g. `make type && make testserial && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+
+
+// every type, immediate and boxed scalars, empty and nested containers
+static var_t* sample(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    var_dict_put(dict, var_new_string(LONG_STR), var_news("[is]", (int64_t) -1, "x"));
+    var_dict_put(dict, var_news("(iu)", BOXED, UINT64_MAX), var_new_nil());
+    var_dict_put(dict, var_new_float(-0.5), var_new_dict(NULL, NULL));
+    return var_news("(niiiuuffss()[](v)v)",
+        (int64_t) 0, INT64_MIN, INT64_MAX, (uint64_t) 0, UINT64_MAX,
+        DBL_MIN, 1e300, "", LONG_STR,
+        var_new_list(var_new_int(-BOXED), var_new_string("%s %d", LONG_STR, 2), NULL), dict);
+}
+
+
+static void test_buf(void) {
+    var_t* var = sample();
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_serialize(var, &buf);
+    size_t len = buf.len;
+
+    size_t used = 0;
+    var_t* res = var_deserialize(buf.data, buf.len, &used);
+    assert(res != NULL && used == len && var_equal(res, var));
+    var_delete(res);
+
+    // values written one after another are read one at a time
+    var_t* imm = var_new_int(7);
+    var_serialize(imm, &buf);
+    res = var_deserialize(buf.data, buf.len, &used);
+    assert(used == len && var_equal(res, var));
+    var_delete(res);
+    res = var_deserialize(buf.data + used, buf.len - used, &used);
+    assert(used == buf.len - len && var_equal(res, imm));
+
+    var_buf_free(&buf);
+    var_delete(var);
+}
+
+
+static void test_file(void) {
+    var_t* var = sample();
+    FILE* fp = tmpfile();
+    assert(fp != NULL);
+    assert(var_serialize_file(var, fp));
+    assert(var_serialize_file(var_new_int(7), fp));
+    long end = ftell(fp);
+    rewind(fp);
+
+    var_t* res = var_deserialize_file(fp);
+    assert(res != NULL && var_equal(res, var));
+    var_delete(res);
+
+    // read ahead is given back, the second value starts where the first one ended
+    res = var_deserialize_file(fp);
+    var_t* imm = var_new_int(7);
+    assert(var_equal(res, imm) && ftell(fp) == end);
+    assert(var_deserialize_file(fp) == NULL);
+
+    // the same bytes as a buffer
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_serialize(var, &buf);
+    var_serialize(imm, &buf);
+    assert((long) buf.len == end);
+    char* data = malloc(buf.len);
+    rewind(fp);
+    assert(fread(data, 1, buf.len, fp) == buf.len && memcmp(data, buf.data, buf.len) == 0);
+
+    free(data);
+    var_buf_free(&buf);
+    fclose(fp);
+    var_delete(var);
+}
+
+
+static void test_truncated(void) {
+    var_t* var = sample();
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_serialize(var, &buf);
+
+    // exact sizes let the address sanitizer catch reads past the end
+    for (size_t len = 0; len < buf.len; len++) {
+        char* data = malloc(len + 1);
+        memcpy(data, buf.data, len);
+        assert(var_deserialize(data, len, NULL) == NULL);
+        free(data);
+    }
+
+    FILE* fp = tmpfile();
+    fwrite(buf.data, 1, buf.len - 1, fp);
+    rewind(fp);
+    assert(var_deserialize_file(fp) == NULL);
+    fclose(fp);
+
+    var_buf_free(&buf);
+    var_delete(var);
+}
+
+
+static var_t* read_bytes(const char* data, size_t len) {
+    return var_deserialize(data, len, NULL);
+}
+
+
+static void test_malformed(void) {
+    // header and tags
+    assert(read_bytes("VAX\1n", 5) == NULL);
+    assert(read_bytes("VAR\7n", 5) == NULL);
+    assert(read_bytes("VAR\1x", 5) == NULL);
+    assert(read_bytes("VAR\1n", 5) == var_new_nil());
+
+    // counts larger than the input, varints longer than `SERIAL_VARINT`
+    assert(read_bytes("VAR\1a\xff\xff\xff\xff\x0f", 10) == NULL);
+    assert(read_bytes("VAR\1s\x05" "abc", 9) == NULL);
+    assert(read_bytes("VAR\1u\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01", 16) == NULL);
+
+    // a bad element deep inside frees what was read before it
+    assert(read_bytes("VAR\1a\x02" "s\x03" "abca\x01x", 15) == NULL);
+    assert(read_bytes("VAR\1d\x01" "l\x00" "n", 10) == NULL);
+
+    // nesting deeper than `SERIAL_DEPTH`
+    size_t len = 4 + (SERIAL_DEPTH + 1) * 2 + 1;
+    char* deep = malloc(len);
+    memcpy(deep, "VAR\1", 4);
+    for (size_t i = 0; i <= SERIAL_DEPTH; i++) memcpy(deep + 4 + i * 2, "a\x01", 2);
+    deep[len - 1] = 'n';
+    assert(read_bytes(deep, len) == NULL);
+    free(deep);
+}
+
+
+int main(void) {
+    test_buf();
+    test_file();
+    test_truncated();
+    test_malformed();
+    puts("ok");
+    return 0;
+}
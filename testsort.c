@@ -0,0 +1,162 @@
+#include "src/type.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*
+ * `var_compare` is a total order that agrees with `var_equal` and `var_hash`,
+ * `var_list_sort` and `var_array_sort` are stable with and without the pool.
+ * build the library first, e.g. `make type && make testsort && ./test`
+ */
+
+
+#define BIG     200000  // above `SORT_PARALLEL * 2`, halves and merges are forked
+#define BOXED   ((int64_t) 1 << 62)
+
+
+static var_t* random_var(int depth) {
+    switch (rand() % (depth > 2 ? 6 : 8)) {
+        case 0: return var_new_nil();
+        case 1: {
+            int64_t v[] = { 0, 1, -1, INT64_MAX, INT64_MIN, (int64_t) 1 << 53, ((int64_t) 1 << 53) + 1 };
+            return var_new_int(v[rand() % 7]);
+        }
+        case 2: {
+            uint64_t v[] = { 0, 1, UINT64_MAX, (uint64_t) 1 << 63, ((uint64_t) 1 << 53) + 1 };
+            return var_new_uint(v[rand() % 5]);
+        }
+        case 3: {
+            double v[] = { 0.0, -0.0, 1.0, 1.5, -1.0, NAN, INFINITY, -INFINITY, 9223372036854775808.0, 9007199254740992.0 };
+            return var_new_float(v[rand() % 10]);
+        }
+        case 4:
+        case 5: {
+            const char* v[] = { "", "a", "b", "ab", "a string longer than sixteen", "a string longer than sixteeo" };
+            return var_new_string(v[rand() % 6]);
+        }
+        case 6: {
+            if (rand() % 2) return var_new_array(random_var(depth + 1), NULL);
+            return var_new_array(random_var(depth + 1), random_var(depth + 1), NULL);
+        }
+        default: {
+            var_t* list = var_new_list(NULL);
+            for (int i = rand() % 3; i > 0; i--) {
+                var_list_push(list, random_var(depth + 1));
+            }
+            return list;
+        }
+    }
+}
+
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+
+// `var_compare` of two new `var_t*`, they are deleted
+static int compare_new(var_t* a, var_t* b) {
+    int res = var_compare(a, b);
+    var_delete(a);
+    var_delete(b);
+    return res;
+}
+
+
+static void test_order(void) {
+    enum { N = 2000 };
+    var_t* v[N];
+    for (int i = 0; i < N; i++) v[i] = random_var(0);
+
+    for (int k = 0; k < 100000; k++) {
+        var_t* a = v[rand() % N];
+        var_t* b = v[rand() % N];
+        var_t* c = v[rand() % N];
+        int ab = var_compare(a, b);
+        assert(sign(ab) == -sign(var_compare(b, a)));
+        assert((ab == 0) == var_equal(a, b));
+        if (ab <= 0 && var_compare(b, c) <= 0) assert(var_compare(a, c) <= 0);
+
+        uint64_t ha, hb;
+        if (ab == 0 && var_hash(a, &ha) && var_hash(b, &hb)) assert(ha == hb);
+    }
+    for (int i = 0; i < N; i++) var_delete(v[i]);
+
+    // numbers by value across types
+    assert(compare_new(var_new_int(-1), var_new_uint(0)) < 0);
+    assert(compare_new(var_new_int(3), var_new_float(2.5)) > 0);
+    assert(compare_new(var_new_int(-5), var_new_float(-4.5)) < 0);
+    assert(compare_new(var_new_float(-0.0), var_new_float(0.0)) < 0);
+    assert(compare_new(var_new_float(NAN), var_new_float(INFINITY)) > 0);
+}
+
+
+typedef struct origin {
+    const var_t*    var;
+    size_t          index;
+} origin_t;
+
+
+static int origin_cmp(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t) ((const origin_t*) a)->var;
+    uintptr_t y = (uintptr_t) ((const origin_t*) b)->var;
+    return (x > y) - (x < y);
+}
+
+
+// boxed ints with many duplicates, equal ones stay in the order they were pushed
+static void test_stable(void) {
+    var_t* list = var_new_list(NULL);
+    origin_t* origin = malloc(sizeof (origin_t) * BIG);
+    assert(origin != NULL);
+    for (size_t i = 0; i < BIG; i++) {
+        var_t* elem = var_new_int(BOXED + rand() % (BIG / 8));
+        var_list_push(list, elem);
+        origin[i] = (origin_t) { elem, i };
+    }
+    qsort(origin, BIG, sizeof (origin_t), origin_cmp);
+
+    var_list_sort(list);
+    size_t prev = 0;
+    for (size_t i = 0; i < BIG; i++) {
+        origin_t key = { var_list_at(list, i), 0 };
+        origin_t* found = bsearch(&key, origin, BIG, sizeof (origin_t), origin_cmp);
+        assert(found != NULL);
+        if (i > 0) {
+            int res = var_compare(var_list_at(list, i - 1), var_list_at(list, i));
+            assert(res <= 0);
+            if (res == 0) assert(found->index > prev);
+        }
+        prev = found->index;
+    }
+    free(origin);
+    var_delete(list);
+}
+
+
+static void test_array(void) {
+    var_t* arr = var_news("(isifs)", (int64_t) 3, "b", (int64_t) -1, 2.5, "a");
+    var_array_sort(arr);
+    var_t* expect = var_news("(ifiss)", (int64_t) -1, 2.5, (int64_t) 3, "a", "b");
+    assert(var_equal(arr, expect));
+    var_delete(arr);
+    var_delete(expect);
+}
+
+
+int main(void) {
+    srand(7);
+    test_order();
+    test_stable();
+    test_array();
+
+    // again on the pool
+    var_pool_start(4);
+    test_stable();
+    var_pool_stop();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,207 @@
+#define _POSIX_C_SOURCE 200809L     // mkstemp
+
+#include "src/type.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/*
+ * a view reads the output of `var_serialize_indexed` in place, from memory or a mapped file.
+ * every access checks bounds, a truncated or damaged buffer fails instead of being read past its end.
+ * build the library first, e.g. `make type && make testview && ./test`
+ */
+
+
+#define LONG_STR "a string that does not fit inside of `var_t`"
+#define BOXED    ((int64_t) 1 << 62)
+#define KEYS     100
+
+
+static var_t* sample(void) {
+    var_t* dict = var_new_dict(NULL, NULL);
+    for (int64_t i = 0; i < KEYS; i++) {
+        var_dict_put(dict, var_new_string("key %d", (int) i), var_new_int(i * 3));
+    }
+    var_dict_put(dict, var_new_int(-1), var_new_string(LONG_STR));
+    var_dict_put(dict, var_news("(is)", BOXED, "a"), var_new_nil());
+    return var_news("(iuf[sn]v)", BOXED, UINT64_MAX, 0.5, LONG_STR, dict);
+}
+
+
+static void check_sample(const var_view_t* root) {
+    assert(var_view_type(root) == VAR_ARRAY && var_view_len(root) == 5);
+
+    var_view_t elem;
+    int64_t i;
+    uint64_t u;
+    double f;
+    const char* str;
+    size_t len;
+    assert(var_view_at(root, 0, &elem) && var_view_int(&elem, &i) && i == BOXED);
+    assert(var_view_uint(&elem, &u) == false && var_view_len(&elem) == 0);
+    assert(var_view_at(root, 1, &elem) && var_view_uint(&elem, &u) && u == UINT64_MAX);
+    assert(var_view_at(root, 2, &elem) && var_view_float(&elem, &f) && f == 0.5);
+    assert(var_view_at(root, 5, &elem) == false);
+
+    var_view_t list;
+    assert(var_view_at(root, 3, &list) && var_view_type(&list) == VAR_LIST && var_view_len(&list) == 2);
+    assert(var_view_at(&list, 0, &elem) && var_view_str(&elem, &str, &len));
+    assert(len == strlen(LONG_STR) && strcmp(str, LONG_STR) == 0 && var_view_len(&elem) == len);
+    assert(var_view_at(&list, 1, &elem) && var_view_type(&elem) == VAR_NIL);
+    assert(var_view_str(&elem, &str, NULL) == false);
+
+    // dicts by position and by key
+    var_view_t dict, key, val;
+    assert(var_view_at(root, 4, &dict) && var_view_type(&dict) == VAR_DICT && var_view_len(&dict) == KEYS + 2);
+    size_t strs = 0;
+    for (size_t k = 0; k < KEYS + 2; k++) {
+        assert(var_view_dict_at(&dict, k, &key, &val));
+        if (var_view_type(&key) == VAR_STRING) strs++;
+    }
+    assert(strs == KEYS && var_view_dict_at(&dict, KEYS + 2, &key, &val) == false);
+
+    char name[32];
+    for (int k = 0; k < KEYS; k++) {
+        snprintf(name, sizeof (name), "key %d", k);
+        assert(var_view_dict_get_str(&dict, name, &val) && var_view_int(&val, &i) && i == k * 3);
+    }
+    assert(var_view_dict_get_str(&dict, "key 100", &val) == false);
+
+    var_t* k = var_new_int(-1);
+    assert(var_view_dict_get(&dict, k, &val) && var_view_str(&val, &str, NULL) && strcmp(str, LONG_STR) == 0);
+    var_delete(k);
+    k = var_news("(is)", BOXED, "a");
+    assert(var_view_dict_get(&dict, k, &val) && var_view_type(&val) == VAR_NIL);
+    var_delete(k);
+    k = var_new_uint(1);
+    assert(var_view_dict_get(&dict, k, &val) == false && var_view_dict_get(&list, k, &val) == false);
+    var_delete(k);
+
+    // formats, of the whole value or a part of it
+    var_view_t d;
+    assert(var_view_get(root, "(iuf[s_]d)", &i, &u, &f, &str, &d));
+    assert(i == BOXED && u == UINT64_MAX && f == 0.5 && strcmp(str, LONG_STR) == 0 && var_view_len(&d) == KEYS + 2);
+    assert(var_view_get(root, "(__f)", &f));
+    assert(var_view_get(root, "(u)", &u) == false);
+    assert(var_view_get(root, "(___[__n])") == false);
+    assert(var_view_get(root, "(___(__))") == false);
+}
+
+
+static void test_view(void) {
+    var_t* var = sample();
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_serialize_indexed(var, &buf);
+
+    var_view_t root;
+    assert(var_view_init(&root, buf.data, buf.len));
+    check_sample(&root);
+
+    var_t* res = var_view_materialize(&root);
+    assert(var_equal(res, var));
+    var_delete(res);
+
+    // `var_deserialize` reads both formats
+    size_t used;
+    res = var_deserialize(buf.data, buf.len, &used);
+    assert(var_equal(res, var) && used == buf.len);
+    var_delete(res);
+
+    var_buf_t plain;
+    var_buf_init(&plain);
+    var_serialize(var, &plain);
+    assert(var_view_init(&root, plain.data, plain.len) == false);
+    var_buf_free(&plain);
+
+    var_buf_free(&buf);
+    var_delete(var);
+}
+
+
+static void test_map(void) {
+    var_t* var = sample();
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_serialize_indexed(var, &buf);
+
+    char path[] = "/tmp/testviewXXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0 && write(fd, buf.data, buf.len) == (ssize_t) buf.len);
+    close(fd);
+
+    size_t len;
+    const void* data = var_map_file(path, &len);
+    assert(data != NULL && len == buf.len);
+    var_view_t root;
+    assert(var_view_init(&root, data, len));
+    check_sample(&root);
+    var_t* res = var_view_materialize(&root);
+    assert(var_equal(res, var));
+    var_delete(res);
+    var_unmap_file(data, len);
+
+    unlink(path);
+    assert(var_map_file(path, &len) == NULL);
+    var_buf_free(&buf);
+    var_delete(var);
+}
+
+
+// exact sizes let the address sanitizer catch reads past the end
+static void test_damaged(void) {
+    var_t* var = sample();
+    var_buf_t buf;
+    var_buf_init(&buf);
+    var_serialize_indexed(var, &buf);
+
+    var_view_t root;
+    for (size_t len = 0; len < buf.len; len++) {
+        char* data = malloc(len + 1);
+        memcpy(data, buf.data, len);
+        assert(var_view_init(&root, data, len) == false || var_view_materialize(&root) == NULL);
+        assert(var_deserialize(data, len, NULL) == NULL);
+        free(data);
+    }
+
+    // any byte changed, every access stays inside of the buffer
+    unsigned seed = 1;
+    char* data = malloc(buf.len);
+    for (int round = 0; round < 2000; round++) {
+        memcpy(data, buf.data, buf.len);
+        seed = seed * 1103515245 + 12345;
+        data[4 + (seed >> 8) % (buf.len - 4)] ^= (char) (1 + (seed >> 4) % 255);
+
+        if (var_view_init(&root, data, buf.len) == false) continue;
+        var_t* res = var_view_materialize(&root);
+        if (res != NULL) var_delete(res);
+        var_view_t dict, val;
+        int64_t i;
+        uint64_t u;
+        double f;
+        const char* str;
+        if (var_view_at(&root, 4, &dict)) {
+            var_view_dict_get_str(&dict, "key 7", &val);
+            var_view_dict_get_str(&dict, "missing", &val);
+            for (size_t k = 0; var_view_dict_at(&dict, k, NULL, &val); k++) var_view_int(&val, &i);
+        }
+        var_view_get(&root, "(iuf[sn]d)", &i, &u, &f, &str, &val);
+    }
+    free(data);
+
+    var_buf_free(&buf);
+    var_delete(var);
+}
+
+
+int main(void) {
+    test_view();
+    test_map();
+    test_damaged();
+    puts("ok");
+    return 0;
+}
@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 200809L     // recursive mutexes
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <threads.h>
+
+
+/*
+ * C11 threads of glibc call pthreads inside of libc, the thread sanitizer never sees them
+ * and reports every access between threads as a race.
+ * `make tsan` links these in front of libc, they call pthreads through the ones it intercepts.
+ * the types of both are the same in glibc.
+ */
+
+
+typedef struct tsan_start {
+    thrd_start_t    fn;
+    void*           arg;
+} tsan_start_t;
+
+
+static void* tsan_run(void* arg) {
+    tsan_start_t start = *(tsan_start_t*) arg;
+    free(arg);
+    return (void*) (intptr_t) start.fn(start.arg);
+}
+
+
+int thrd_create(thrd_t* thr, thrd_start_t fn, void* arg) {
+    tsan_start_t* start = malloc(sizeof (tsan_start_t));
+    if (start == NULL) return thrd_nomem;
+    start->fn = fn;
+    start->arg = arg;
+    if (pthread_create((pthread_t*) thr, NULL, tsan_run, start) != 0) {
+        free(start);
+        return thrd_error;
+    }
+    return thrd_success;
+}
+
+
+int thrd_join(thrd_t thr, int* res) {
+    void* ret;
+    if (pthread_join((pthread_t) thr, &ret) != 0) return thrd_error;
+    if (res != NULL) *res = (int) (intptr_t) ret;
+    return thrd_success;
+}
+
+
+int thrd_detach(thrd_t thr) {
+    return pthread_detach((pthread_t) thr) == 0 ? thrd_success : thrd_error;
+}
+
+
+void thrd_yield(void) {
+    sched_yield();
+}
+
+
+int mtx_init(mtx_t* mtx, int type) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if (type & mtx_recursive) pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    int res = pthread_mutex_init((pthread_mutex_t*) mtx, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return res == 0 ? thrd_success : thrd_error;
+}
+
+
+int mtx_lock(mtx_t* mtx) {
+    return pthread_mutex_lock((pthread_mutex_t*) mtx) == 0 ? thrd_success : thrd_error;
+}
+
+
+int mtx_unlock(mtx_t* mtx) {
+    return pthread_mutex_unlock((pthread_mutex_t*) mtx) == 0 ? thrd_success : thrd_error;
+}
+
+
+void mtx_destroy(mtx_t* mtx) {
+    pthread_mutex_destroy((pthread_mutex_t*) mtx);
+}
+
+
+int cnd_init(cnd_t* cnd) {
+    return pthread_cond_init((pthread_cond_t*) cnd, NULL) == 0 ? thrd_success : thrd_error;
+}
+
+
+int cnd_wait(cnd_t* cnd, mtx_t* mtx) {
+    return pthread_cond_wait((pthread_cond_t*) cnd, (pthread_mutex_t*) mtx) == 0 ? thrd_success : thrd_error;
+}
+
+
+int cnd_signal(cnd_t* cnd) {
+    return pthread_cond_signal((pthread_cond_t*) cnd) == 0 ? thrd_success : thrd_error;
+}
+
+
+int cnd_broadcast(cnd_t* cnd) {
+    return pthread_cond_broadcast((pthread_cond_t*) cnd) == 0 ? thrd_success : thrd_error;
+}
+
+
+void cnd_destroy(cnd_t* cnd) {
+    pthread_cond_destroy((pthread_cond_t*) cnd);
+}
+
+
+void call_once(once_flag* flag, void (*fn)(void)) {
+    pthread_once((pthread_once_t*) flag, fn);
+}